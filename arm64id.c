@@ -32,414 +32,773 @@
 
 #include <sys/cdefs.h>
 #include <sys/param.h>
-#if !defined(__APPLE__) && !defined(__NetBSD__)
-#include <sys/auxv.h>
-#endif
 
 #include <err.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
-#include <setjmp.h>
-#include <signal.h>
-#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
-#include "hwcaps.h"
-#include "linker_set.h"
+#include "arm64id.h"
+#include "extern.h"
 
-typedef int (*special_reg_read)(uint64_t *);
+static void
+print_hwcap(const struct arm64id_snapshot *snap, u_int word, const char *name)
+{
+	const struct arm64id_hwcap *cap_list;
+	size_t ncaps;
+	uint64_t caps;
 
-struct special_reg {
-	const char *reg_name;
-	special_reg_read reader;
-};
+	if (!arm64id_hwcap_valid(snap, word))
+		return;
+
+	cap_list = arm64id_hwcap_list(word, &ncaps);
+	caps = snap->hwcaps[word];
+	printf("%s: %016"PRIx64"\n", name, caps);
+	for (size_t i = 0; i < ncaps; i++) {
+		if ((caps & cap_list[i].cap) != 0) {
+			printf("  %s\n", cap_list[i].name);
+			caps &= ~cap_list[i].cap;
+		}
+	}
+	if (caps != 0)
+		printf("Unknown caps: %"PRIx64"\n", caps);
+}
+
+static void
+print_hwcaps(const struct arm64id_snapshot *snap)
+{
+	print_hwcap(snap, 0, " HWCAP");
+	print_hwcap(snap, 1, "HWCAP2");
+	print_hwcap(snap, 2, "HWCAP3");
+	print_hwcap(snap, 3, "HWCAP4");
+}
 
-LS_SET_DECLARE(special_reg, struct special_reg);
-
-static sigjmp_buf jmpbuf;
-
-#define SPECIAL_REGISTER(name)					\
-static int							\
-get_##name(uint64_t *res)					\
-{								\
-	uint64_t tmp;						\
-	int ret;						\
-								\
-	ret = sigsetjmp(jmpbuf, 1);				\
-	if (ret == 0) {						\
-		asm(						\
-		"	mrs	%0, "__STRING(name)"	\n"	\
-		"	str	%0, [%1]		\n"	\
-		: "+r"(tmp): "r"(res): "memory");		\
-	}							\
-	return (ret);						\
-}								\
-static struct special_reg name ## _entry = {			\
-	.reg_name = LS_XSTRING(name),				\
-	.reader = get_ ## name,					\
-};								\
-LS_DATA_SET(special_reg, name ## _entry)
-
-#define SPECIAL_REGISTER_GROUP(op1, n, m)				\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _0);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _1);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _2);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _3);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _4);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _5);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _6);		\
-SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _7)
-
-SPECIAL_REGISTER_GROUP(0, 0, 0);
-SPECIAL_REGISTER_GROUP(0, 0, 1);
-SPECIAL_REGISTER_GROUP(0, 0, 2);
-SPECIAL_REGISTER_GROUP(0, 0, 3);
-SPECIAL_REGISTER_GROUP(0, 0, 4);
-SPECIAL_REGISTER_GROUP(0, 0, 5);
-SPECIAL_REGISTER_GROUP(0, 0, 6);
-SPECIAL_REGISTER_GROUP(0, 0, 7);
-
-SPECIAL_REGISTER_GROUP(3, 0, 0);
-SPECIAL_REGISTER_GROUP(3, 2, 4);
-SPECIAL_REGISTER_GROUP(3, 4, 2);
-SPECIAL_REGISTER_GROUP(3, 14, 0);
-SPECIAL_REGISTER_GROUP(3, 14, 2);
-SPECIAL_REGISTER_GROUP(3, 14, 3);
-
-static struct special_register_alias {
+static void
+print_fields(const struct arm64id_snapshot *snap, u_int idx)
+{
+	const struct arm64id_field_desc *desc;
 	const char *name;
-	const char *alias;
-} reg_aliases[] = {
-	{ "S3_0_C0_C0_0", "midr_el1" },
-	{ "S3_0_C0_C0_5", "mpidr_el1" },
-	{ "S3_0_C0_C0_6", "revidr_el1" },
-
-	{ "S3_0_C0_C1_0", "id_pfr0_el1" },
-	{ "S3_0_C0_C1_1", "id_pfr1_el1" },
-	{ "S3_0_C0_C1_2", "id_dfr0_el1" },
-	{ "S3_0_C0_C1_3", "id_afr0_el1" },
-	{ "S3_0_C0_C1_4", "id_mmfr0_el1" },
-	{ "S3_0_C0_C1_5", "id_mmfr1_el1" },
-	{ "S3_0_C0_C1_6", "id_mmfr2_el1" },
-	{ "S3_0_C0_C1_7", "id_mmfr3_el1" },
-
-	{ "S3_0_C0_C2_0", "id_isar0_el1" },
-	{ "S3_0_C0_C2_1", "id_isar1_el1" },
-	{ "S3_0_C0_C2_2", "id_isar2_el1" },
-	{ "S3_0_C0_C2_3", "id_isar3_el1" },
-	{ "S3_0_C0_C2_4", "id_isar4_el1" },
-	{ "S3_0_C0_C2_5", "id_isar5_el1" },
-	{ "S3_0_C0_C2_6", "id_mmfr4_el1" },
-	{ "S3_0_C0_C2_7", "id_isar6_el1" },
-
-	{ "S3_0_C0_C3_0", "mvfr0_el1" },
-	{ "S3_0_C0_C3_1", "mvfr1_el1" },
-	{ "S3_0_C0_C3_2", "mvfr2_el1" },
-	{ "S3_0_C0_C3_4", "id_pfr2_el1" },
-	{ "S3_0_C0_C3_5", "id_dfr1_el1" },
-	{ "S3_0_C0_C3_6", "id_mmfr5_el1" },
-
-	{ "S3_0_C0_C4_0", "id_aa64pfr0_el1" },
-	{ "S3_0_C0_C4_1", "id_aa64pfr1_el1" },
-	{ "S3_0_C0_C4_2", "id_aa64pfr2_el1" },
-	{ "S3_0_C0_C4_4", "id_aa64zfr0_el1" },
-	{ "S3_0_C0_C4_5", "id_aa64smfr0_el1" },
-	{ "S3_0_C0_C4_7", "id_aa64fpfr0_el1" },
-
-	{ "S3_0_C0_C5_0", "id_aa64dfr0_el1" },
-	{ "S3_0_C0_C5_1", "id_aa64dfr1_el1" },
-	{ "S3_0_C0_C5_2", "id_aa64dfr2_el1" },
-	{ "S3_0_C0_C5_4", "id_aa64afr0_el1" },
-	{ "S3_0_C0_C5_5", "id_aa64afr1_el1" },
-
-	{ "S3_0_C0_C6_0", "id_aa64isar0_el1" },
-	{ "S3_0_C0_C6_1", "id_aa64isar1_el1" },
-	{ "S3_0_C0_C6_2", "id_aa64isar2_el1" },
-	{ "S3_0_C0_C6_3", "id_aa64isar3_el1" },
-
-	{ "S3_0_C0_C7_0", "id_aa64mmfr0_el1" },
-	{ "S3_0_C0_C7_1", "id_aa64mmfr1_el1" },
-	{ "S3_0_C0_C7_2", "id_aa64mmfr2_el1" },
-	{ "S3_0_C0_C7_3", "id_aa64mmfr3_el1" },
-	{ "S3_0_C0_C7_4", "id_aa64mmfr4_el1" },
-
-	{ "S3_3_C0_C0_1", "ctr_el0" },
-	{ "S3_3_C0_C0_7", "dczid_el0" },
-
-	{ "S3_3_C2_C4_0", "rndr" },
-	{ "S3_3_C2_C4_1", "rndrrs" },
-
-	{ "S3_3_C4_C2_0", "nzcv" },
-	{ "S3_3_C4_C2_1", "daif" },
-	{ "S3_3_C4_C2_2", "svcr" },
-	{ "S3_3_C4_C2_5", "dit" },
-	{ "S3_3_C4_C2_6", "ssbs" },
-	{ "S3_3_C4_C2_7", "tco" },
-
-	{ "S3_3_C14_C0_0", "cntfrq_el0" },
-	{ "S3_3_C14_C0_1", "cntpct_el0" },
-	{ "S3_3_C14_C0_2", "cntvct_el0" },
-	{ "S3_3_C14_C0_5", "cntpctss_el0" },
-	{ "S3_3_C14_C0_6", "cntvctss_el0" },
-
-	{ "S3_3_C14_C2_0", "cntp_tval_el0" },
-	{ "S3_3_C14_C2_1", "cntp_ctl_el0" },
-	{ "S3_3_C14_C2_2", "cntp_cval_el0" },
-
-	{ "S3_3_C14_C3_0", "cntv_tval_el0" },
-	{ "S3_3_C14_C3_1", "cntv_ctl_el0" },
-	{ "S3_3_C14_C3_2", "cntv_cval_el0" },
-};
+	uint32_t enc;
+	int64_t val;
+
+	enc = arm64id_reg_encoding(idx);
+	for (u_int f = 0; f < ARM64ID_NFIELDS; f++) {
+		desc = arm64id_field_desc(f);
+		if (desc->enc != enc || !arm64id_field_get(snap, f, &val))
+			continue;
+
+		printf("%24s: 0b", desc->name);
+		for (int b = desc->width - 1; b >= 0; b--)
+			putchar((val >> b) & 1 ? '1' : '0');
+		name = arm64id_field_value_name(f, val);
+		if (name != NULL)
+			printf(" (%s)", name);
+		printf("\n");
+	}
+}
+
+/* Print the core, tuning and errata from the MIDR_EL1 database */
+static void
+print_midr(uint32_t midr)
+{
+	const struct arm64id_erratum *errata;
+	const struct arm64id_core *core;
+	const char *impl;
+	size_t nerrata;
+
+	impl = arm64id_implementer_name(ARM64ID_MIDR_IMPLEMENTER(midr));
+	core = arm64id_core_lookup(midr);
+	printf("%24s: ", "core");
+	if (impl != NULL)
+		printf("%s ", impl);
+	else
+		printf("implementer 0x%02x ", ARM64ID_MIDR_IMPLEMENTER(midr));
+	if (core != NULL)
+		printf("%s ", core->name);
+	else
+		printf("part 0x%03x ", ARM64ID_MIDR_PART(midr));
+	printf("r%up%u\n", ARM64ID_MIDR_VARIANT(midr),
+	    ARM64ID_MIDR_REVISION(midr));
+	if (core != NULL && core->tune != NULL)
+		printf("%24s: -mtune=%s\n", "tune", core->tune);
+
+	errata = arm64id_core_errata(midr, &nerrata);
+	for (size_t i = 0; i < nerrata; i++) {
+		if (arm64id_erratum_applies(&errata[i], midr))
+			printf("%24s: %s: %s\n", "erratum", errata[i].id,
+			    errata[i].impact);
+	}
+}
 
 static void
-sigill(int signo, siginfo_t *info, void *ctx)
+print_reg(const struct arm64id_snapshot *snap, u_int idx, bool decode)
 {
-	(void)info;
-	(void)ctx;
+	printf("%20s = ", arm64id_reg_name(idx));
 
-	siglongjmp(jmpbuf, 1);
+	if (!arm64id_reg_valid(snap, idx)) {
+		printf("<invalid>\n");
+		return;
+	}
+	printf("0x%"PRIx64"\n", snap->regs[idx]);
+	if (decode)
+		print_fields(snap, idx);
+	if (decode && idx == (u_int)arm64id_reg_lookup("midr_el1"))
+		print_midr(snap->regs[idx]);
 }
 
-#ifndef nitems
-#define	nitems(x)	(sizeof(x)/sizeof(x[0]))
-#endif
+static void
+print_regs(const struct arm64id_snapshot *snap, bool decode)
+{
+	for (u_int i = 0; i < snap->nregs; i++)
+		print_reg(snap, i, decode);
+}
 
-/* No HWCAP support on Mac or NetBSD (at least not in 2026) */
-#if !defined(__APPLE__) && !defined(__NetBSD__)
+/*
+ * Print a snapshot in the text format input_parse_text reads back. The
+ * blank line ends the snapshot so the output of several runs can be
+ * concatenated.
+ */
+void
+print_snapshot(const struct arm64id_snapshot *snap, bool decode)
+{
+	print_regs(snap, decode);
+	print_hwcaps(snap);
+	printf("\n");
+}
 
-struct hwcaps {
+static void
+print_cpu_list(const struct arm64id_cpu *cpus, u_int ncpus, u_int cpu_class)
+{
+	const char *sep;
+	int start, last;
+
+	sep = "";
+	start = last = -1;
+	for (u_int i = 0; i <= ncpus; i++) {
+		if (i < ncpus && cpus[i].cpu_class != cpu_class)
+			continue;
+		if (i < ncpus && start != -1 && cpus[i].cpu == last + 1) {
+			last = cpus[i].cpu;
+			continue;
+		}
+		if (start != -1) {
+			if (start == last)
+				printf("%s%d", sep, start);
+			else
+				printf("%s%d-%d", sep, start, last);
+			sep = ",";
+		}
+		if (i < ncpus)
+			start = last = cpus[i].cpu;
+	}
+}
+
+/*
+ * Print a table with one column per class of CPU. Only registers that
+ * differ between the classes are listed, along with the MIDR_EL1 and
+ * REVIDR_EL1 values identifying the core.
+ */
+static void
+print_classes(struct arm64id_cpu *cpus, u_int ncpus, u_int nclasses)
+{
+	const struct arm64id_snapshot *snaps[nclasses];
 	const char *name;
-	unsigned long cap;
-};
+	u_int c, count, same;
+	int midr;
+	bool differ;
+
+	for (c = 0; c < nclasses; c++) {
+		snaps[c] = NULL;
+		count = 0;
+		for (u_int i = 0; i < ncpus; i++) {
+			if (cpus[i].cpu_class != c)
+				continue;
+			if (snaps[c] == NULL)
+				snaps[c] = &cpus[i].snap;
+			count++;
+		}
+		printf("class %u: %u cpu%s: ", c, count, count == 1 ? "" : "s");
+		print_cpu_list(cpus, ncpus, c);
+		printf("\n");
+	}
+	for (u_int i = 0; i < ncpus; i++) {
+		if (cpus[i].error != 0)
+			printf("cpu %d: not probed: %s\n", cpus[i].cpu,
+			    strerror(cpus[i].error));
+	}
+	if (nclasses == 0)
+		return;
 
-static struct hwcaps hwcaps[] = {
-#define	HWCAP(cap) { LS_XSTRING(cap), HWCAP_ ## cap }
-	HWCAP(FP),
-	HWCAP(ASIMD),
-	HWCAP(EVTSTRM),
-	HWCAP(AES),
-	HWCAP(PMULL),
-	HWCAP(SHA1),
-	HWCAP(SHA2),
-	HWCAP(CRC32),
-	HWCAP(ATOMICS),
-	HWCAP(FPHP),
-	HWCAP(ASIMDHP),
-	HWCAP(CPUID),
-	HWCAP(ASIMDRDM),
-	HWCAP(JSCVT),
-	HWCAP(FCMA),
-	HWCAP(LRCPC),
-	HWCAP(DCPOP),
-	HWCAP(SHA3),
-	HWCAP(SM3),
-	HWCAP(SM4),
-	HWCAP(ASIMDDP),
-	HWCAP(SHA512),
-	HWCAP(SVE),
-	HWCAP(ASIMDFHM),
-	HWCAP(DIT),
-	HWCAP(USCAT),
-	HWCAP(ILRCPC),
-	HWCAP(FLAGM),
-	HWCAP(SSBS),
-	HWCAP(SB),
-	HWCAP(PACA),
-	HWCAP(PACG),
-	HWCAP(GCS),
-	HWCAP(CMPBR),
-	HWCAP(FPRCVT),
-	HWCAP(F8MM8),
-	HWCAP(F8MM4),
-	HWCAP(SVE_F16MM),
-	HWCAP(SVE_ELTPERM),
-	HWCAP(SVE_AES2),
-	HWCAP(SVE_BFSCALE),
-	HWCAP(SVE2P2),
-	HWCAP(SME2P2),
-	HWCAP(SME_SBITPERM),
-	HWCAP(SME_AES),
-	HWCAP(SME_SFEXPA),
-	HWCAP(SME_STMOP),
-	HWCAP(SME_SMOP4),
-#undef HWCAP
-};
+	printf("\n%20s  ", "");
+	for (c = 0; c < nclasses; c++)
+		printf(" class %-12u", c);
+	printf("\n");
+
+	same = 0;
+	for (u_int r = 0; r < snaps[0]->nregs; r++) {
+		name = arm64id_reg_name(r);
+		differ = strcmp(name, "midr_el1") == 0 ||
+		    strcmp(name, "revidr_el1") == 0;
+		for (c = 1; c < nclasses && !differ &&
+		    !arm64id_reg_volatile(r); c++) {
+			if (arm64id_reg_valid(snaps[0], r) !=
+			    arm64id_reg_valid(snaps[c], r) ||
+			    snaps[0]->regs[r] != snaps[c]->regs[r])
+				differ = true;
+		}
+		if (!differ) {
+			same++;
+			continue;
+		}
 
-static struct hwcaps hwcaps2[] = {
-#define	HWCAP(cap) { LS_XSTRING(cap), HWCAP2_ ## cap }
-	HWCAP(DCPODP),
-	HWCAP(SVE2),
-	HWCAP(SVEAES),
-	HWCAP(SVEPMULL),
-	HWCAP(SVEBITPERM),
-	HWCAP(SVESHA3),
-	HWCAP(SVESM4),
-	HWCAP(FLAGM2),
-	HWCAP(FRINT),
-	HWCAP(SVEI8MM),
-	HWCAP(SVEF32MM),
-	HWCAP(SVEF64MM),
-	HWCAP(SVEBF16),
-	HWCAP(I8MM),
-	HWCAP(BF16),
-	HWCAP(DGH),
-	HWCAP(RNG),
-	HWCAP(BTI),
-	HWCAP(MTE),
-	HWCAP(ECV),
-	HWCAP(AFP),
-	HWCAP(RPRES),
-	HWCAP(MTE3),
-	HWCAP(SME),
-	HWCAP(SME_I16I64),
-	HWCAP(SME_F64F64),
-	HWCAP(SME_I8I32),
-	HWCAP(SME_F16F32),
-	HWCAP(SME_B16F32),
-	HWCAP(SME_F32F32),
-	HWCAP(SME_FA64),
-	HWCAP(WFXT),
-	HWCAP(EBF16),
-	HWCAP(SVE_EBF16),
-	HWCAP(CSSC),
-	HWCAP(RPRFM),
-	HWCAP(SVE2P1),
-	HWCAP(SME2),
-	HWCAP(SME2P1),
-	HWCAP(SME_I16I32),
-	HWCAP(SME_BI32I32),
-	HWCAP(SME_B16B16),
-	HWCAP(SME_F16F16),
-	HWCAP(MOPS),
-	HWCAP(HBC),
-	HWCAP(SVE_B16B16),
-	HWCAP(LRCPC3),
-	HWCAP(LSE128),
-	HWCAP(FPMR),
-	HWCAP(LUT),
-	HWCAP(FAMINMAX),
-	HWCAP(F8CVT),
-	HWCAP(F8FMA),
-	HWCAP(F8DP4),
-	HWCAP(F8DP2),
-	HWCAP(F8E4M3),
-	HWCAP(F8E5M2),
-	HWCAP(SME_LUTV2),
-	HWCAP(SME_F8F16),
-	HWCAP(SME_F8F32),
-	HWCAP(SME_SF8FMA),
-	HWCAP(SME_SF8DP4),
-	HWCAP(SME_SF8DP2),
-	HWCAP(POE),
-#undef HWCAP
-};
+		printf("%20s =", name);
+		for (c = 0; c < nclasses; c++) {
+			if (!arm64id_reg_valid(snaps[c], r))
+				printf(" %-18s", "<invalid>");
+			else
+				printf(" 0x%-16"PRIx64, snaps[c]->regs[r]);
+		}
+		printf("\n");
+	}
+	printf("%u registers are the same in all classes\n\n", same);
+
+	midr = arm64id_reg_lookup("midr_el1");
+	for (c = 0; c < nclasses; c++) {
+		if (midr < 0 || !arm64id_reg_valid(snaps[c], midr))
+			continue;
+		printf("class %u:\n", c);
+		print_midr(snaps[c]->regs[midr]);
+	}
+	printf("\n");
 
-#ifdef AT_HWCAP3
-static struct hwcaps hwcaps3[] = {
-#define	HWCAP(cap) { LS_XSTRING(cap), HWCAP3_ ## cap }
-	HWCAP(MTE_FAR),
-	HWCAP(MTE_STORE_ONLY),
-	HWCAP(LSFE),
-	HWCAP(LS64),
-#undef HWCAP
-};
-#endif
+	print_hwcaps(snaps[0]);
+}
+
+static void
+write_records(const char *path, const struct arm64id_record *recs,
+    size_t nrecs)
+{
+	int error, fd;
+
+	if (strcmp(path, "-") == 0) {
+		fd = STDOUT_FILENO;
+	} else {
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			err(1, "%s", path);
+	}
 
-#ifdef AT_HWCAP4
-static struct hwcaps hwcaps4[] = {
+	error = arm64id_record_write(fd, recs, nrecs);
+	if (error != 0) {
+		errno = error;
+		err(1, "%s", path);
+	}
+	if (fd != STDOUT_FILENO && close(fd) != 0)
+		err(1, "%s", path);
+}
+
+static void
+write_classes(const char *path, const struct arm64id_cpu *cpus, u_int ncpus,
+    u_int nclasses)
+{
+	struct arm64id_record *recs;
+	u_int count;
+
+	recs = calloc(nclasses, sizeof(*recs));
+	if (recs == NULL)
+		err(1, "calloc");
+
+	for (u_int c = 0; c < nclasses; c++) {
+		const struct arm64id_snapshot *snap;
+
+		snap = NULL;
+		count = 0;
+		for (u_int i = 0; i < ncpus; i++) {
+			if (cpus[i].cpu_class != c)
+				continue;
+			if (snap == NULL)
+				snap = &cpus[i].snap;
+			count++;
+		}
+		arm64id_record_init(&recs[c], snap, c, nclasses, count);
+	}
+
+	write_records(path, recs, nclasses);
+	free(recs);
+}
+
+static void
+print_archive(const char *path, bool decode)
+{
+	struct arm64id_archive ar;
+	const struct arm64id_record *rec;
+	int error;
+
+	error = arm64id_archive_open(path, &ar);
+	if (error != 0) {
+		errno = error;
+		err(1, "%s", path);
+	}
+
+	ARM64ID_ARCHIVE_FOREACH(rec, &ar) {
+		if (!arm64id_record_valid(rec)) {
+			warnx("%s: invalid record %zu", path,
+			    (size_t)(rec - ar.records));
+			continue;
+		}
+		printf("host %.*s class %u/%u (%u cpus)\n",
+		    (int)sizeof(rec->hostname), rec->hostname, rec->cpu_class,
+		    rec->nclasses, rec->ncpus);
+		print_snapshot(&rec->snap, decode);
+	}
+
+	arm64id_archive_close(&ar);
+}
+
+struct load_one {
+	struct arm64id_snapshot snap;
+	size_t		count;
 };
-#endif
 
-static bool
-get_caps(int cap, unsigned long *caps)
+static void
+load_one_cb(const struct arm64id_snapshot *snap, void *arg)
 {
-#if defined(__FreeBSD__) || defined(__OpenBSD__)
-	return (elf_aux_info(cap, caps, sizeof(*caps)) == 0);
-#elif defined(__linux__)
-	*caps = getauxval(cap);
-	return (true);
-#else
-#error Unknown OS
-#endif
+	struct load_one *lo;
+
+	lo = arg;
+	if (lo->count++ == 0)
+		memcpy(&lo->snap, snap, sizeof(lo->snap));
 }
 
+/* Load a file that must hold a single snapshot */
 static void
-print_hwcap(int cap, const char *name, struct hwcaps *cap_list, int ncaps)
+load_snapshot(const char *path, struct arm64id_snapshot *snap)
+{
+	struct load_one lo;
+	int error;
+
+	memset(&lo, 0, sizeof(lo));
+	error = input_load(path, load_one_cb, &lo);
+	if (error != 0) {
+		errno = error;
+		err(1, "%s", path);
+	}
+	if (lo.count != 1)
+		errx(1, "%s: expected one snapshot, found %zu", path, lo.count);
+	memcpy(snap, &lo.snap, sizeof(*snap));
+}
+
+/*
+ * The per-boot cache is shared in ARM64ID_CACHE_PATH when we can write
+ * there. Other users, e.g. health checks that don't run as root, fall back
+ * to $XDG_RUNTIME_DIR, which is private to the user and also cleared on
+ * reboot.
+ */
+static bool
+cache_user_path(char *path, size_t len)
+{
+	const char *dir;
+
+	dir = getenv("XDG_RUNTIME_DIR");
+	if (dir == NULL || dir[0] != '/')
+		return (false);
+	return (snprintf(path, len, "%s/arm64id.cache", dir) < (int)len);
+}
+
+/* The errors from a cache directory we aren't allowed to write to */
+static bool
+cache_denied(int error)
+{
+	return (error == EACCES || error == EPERM || error == EROFS);
+}
+
+int
+cache_load(int flags, struct arm64id_snapshot *snap)
 {
-	unsigned long caps;
+	char path[PATH_MAX];
+	int error;
 
-	if (!get_caps(cap, &caps))
+	error = arm64id_cache_load(ARM64ID_CACHE_PATH, flags, snap);
+	if (error != 0 && cache_user_path(path, sizeof(path)))
+		error = arm64id_cache_load(path, flags, snap);
+	return (error);
+}
+
+/*
+ * Store the snapshot in the first cache we can write to. Not being allowed
+ * to write either is expected so is silent, the next run probes again.
+ */
+void
+cache_store(int flags, const struct arm64id_snapshot *snap)
+{
+	char path[PATH_MAX];
+	int error;
+
+	error = arm64id_cache_store(ARM64ID_CACHE_PATH, flags, snap);
+	if (!cache_denied(error)) {
+		if (error != 0) {
+			errno = error;
+			warn("%s", ARM64ID_CACHE_PATH);
+		}
 		return;
+	}
+	if (!cache_user_path(path, sizeof(path)))
+		return;
+	error = arm64id_cache_store(path, flags, snap);
+	if (error != 0 && !cache_denied(error)) {
+		errno = error;
+		warn("%s", path);
+	}
+}
 
-	printf("%s: %016lx\n", name, caps);
-	for (int i = 0; i < ncaps; i++) {
-		if ((caps & cap_list[i].cap) != 0) {
-			printf("  %s\n", cap_list[i].name);
-			caps &= ~cap_list[i].cap;
+/*
+ * Only read and print the registers and HWCAPs named on the command line.
+ * Other registers are never read, and with -c the per-boot cache is used
+ * if it's valid, but is never written. The exit status is 0 when all the
+ * registers could be read and all the HWCAPs are set, 1 when they aren't,
+ * and 2 on error, so scripts can check for features without parsing the
+ * output.
+ */
+static int
+select_main(int argc, char *argv[], bool cache, bool decode, bool fast,
+    bool quiet)
+{
+	struct arm64id_snapshot snap;
+	struct arm64id_regset set;
+	const struct arm64id_hwcap *caps[argc];
+	u_int words[argc];
+	int error, flags, ncaps, ret;
+	bool present;
+
+	memset(&set, 0, sizeof(set));
+	ncaps = 0;
+	for (int i = 0; i < argc; i++) {
+		caps[ncaps] = arm64id_hwcap_lookup(argv[i], &words[ncaps]);
+		if (caps[ncaps] != NULL) {
+			ncaps++;
+			continue;
 		}
+		if (arm64id_regset_add(&set, argv[i]) == 0)
+			errx(2, "%s: unknown register or HWCAP", argv[i]);
 	}
-	if (caps != 0)
-		printf("Unknown caps: %lx\n", caps);
+
+	/* A valid cache avoids reading any registers */
+	flags = fast ? ARM64ID_PROBE_FAST : 0;
+	error = ENOENT;
+	if (cache)
+		error = cache_load(flags, &snap);
+	if (error != 0)
+		error = arm64id_probe_regs(&snap, &set, flags, NULL);
+	if (error != 0) {
+		errno = error;
+		err(2, "unable to read the ID registers");
+	}
+
+	ret = 0;
+	for (u_int i = 0; i < snap.nregs; i++) {
+		if (!arm64id_regset_isset(&set, i))
+			continue;
+		if (!arm64id_reg_valid(&snap, i))
+			ret = 1;
+		if (!quiet)
+			print_reg(&snap, i, decode);
+	}
+	for (int i = 0; i < ncaps; i++) {
+		present = arm64id_hwcap_valid(&snap, words[i]) &&
+		    (snap.hwcaps[words[i]] & caps[i]->cap) != 0;
+		if (!present)
+			ret = 1;
+		if (!quiet)
+			printf("%20s = %s\n", caps[i]->name,
+			    present ? "yes" : "no");
+	}
+
+	return (ret);
 }
 
 static void
-print_hwcaps(void)
+usage(void)
 {
-	print_hwcap(AT_HWCAP,  " HWCAP", hwcaps,  nitems(hwcaps));
-	print_hwcap(AT_HWCAP2, "HWCAP2", hwcaps2, nitems(hwcaps2));
-#ifdef AT_HWCAP3
-	print_hwcap(AT_HWCAP3, "HWCAP3", hwcaps3, nitems(hwcaps));
-#endif
-#ifdef AT_HWCAP4
-	print_hwcap(AT_HWCAP4, "HWCAP4", hwcaps4, nitems(hwcaps));
-#endif
+	fprintf(stderr, "usage: arm64id [-acdf] [-o file]\n"
+	    "       arm64id [-cdfq] register | hwcap ...\n"
+	    "       arm64id [-d] -i file\n"
+	    "       arm64id -H [-cf | -i file]\n"
+	    "       arm64id -m [-cf | file ...]\n"
+	    "       arm64id -M midr ...\n"
+	    "       arm64id -A [-j threads] file ...\n"
+	    "       arm64id -T [-f] [-j workers] [-o file]\n"
+	    "       arm64id -W interval [-f] [-o file]\n"
+	    "       arm64id -P [-f] [-W interval] [-l port | -o file]\n"
+	    "       arm64id -b benchmark\n");
+	exit(1);
 }
-#endif /* !__APPLE__ && !__NetBSD__ */
 
 int
 main(int argc, char *argv[])
 {
-	struct sigaction act;
-	struct special_reg **sr, *cursr;
-	uint64_t reg;
-
-	memset(&act, 0, sizeof(act));
-	sigemptyset(&act.sa_mask);
-	act.sa_sigaction = sigill;
-	act.sa_flags = SA_SIGINFO;
-
-	if (sigaction(SIGILL, &act, NULL) != 0)
-		err(1, "sigaction failed");
-	/* Reading SME registers may raise SIGBUS on FreeBSD 14 */
-	if (sigaction(SIGBUS, &act, NULL) != 0)
-		err(1, "sigaction failed");
-
-	LS_SET_FOREACH(sr, special_reg) {
-		const char *name;
-		int i;
-
-		cursr = *sr;
-
-		name = cursr->reg_name;
-		for (i = 0; i < nitems(reg_aliases); i++) {
-			if (strcmp(name, reg_aliases[i].name) == 0) {
-				name = reg_aliases[i].alias;
-				break;
+	struct arm64id_snapshot local_snap;
+	struct arm64id_probe_stats stats;
+	struct arm64id_record rec;
+	const struct arm64id_snapshot *snap;
+	struct arm64id_cpu *cpus;
+	struct march_state *ms;
+	const char *bench, *input, *output;
+	u_int ncpus, nclasses, nthreads, port;
+	double interval;
+	long val;
+	int ch, error, flags;
+	bool aggregate, all_cpus, cache, cached, decode, fast, header, march;
+	bool midr, prom, quiet, topology;
+	char *end, *prog;
+
+	aggregate = false;
+	all_cpus = false;
+	cache = false;
+	decode = false;
+	fast = false;
+	header = false;
+	march = false;
+	midr = false;
+	ms = NULL;
+	port = 0;
+	prom = false;
+	quiet = false;
+	topology = false;
+	bench = input = output = NULL;
+	prog = argv[0];
+	interval = 0;
+	val = sysconf(_SC_NPROCESSORS_ONLN);
+	nthreads = val > 0 ? val : 1;
+	while ((ch = getopt(argc, argv, "AHMPTW:ab:cdfi:j:l:mo:q")) != -1) {
+		switch (ch) {
+		case 'A':
+			aggregate = true;
+			break;
+		case 'H':
+			header = true;
+			break;
+		case 'M':
+			midr = true;
+			break;
+		case 'P':
+			prom = true;
+			break;
+		case 'T':
+			topology = true;
+			break;
+		case 'W':
+			interval = strtod(optarg, &end);
+			if (*end != '\0' || !(interval >= 0.01) ||
+			    interval > 86400)
+				errx(1, "invalid interval: %s", optarg);
+			break;
+		case 'j':
+			val = strtol(optarg, &end, 10);
+			if (*end != '\0' || val <= 0 || val > 1024)
+				errx(1, "invalid thread count: %s", optarg);
+			nthreads = val;
+			break;
+		case 'a':
+			all_cpus = true;
+			break;
+		case 'b':
+			bench = optarg;
+			break;
+		case 'c':
+			cache = true;
+			break;
+		case 'd':
+			decode = true;
+			break;
+		case 'f':
+			fast = true;
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'l':
+			val = strtol(optarg, &end, 10);
+			if (*end != '\0' || val <= 0 || val > 65535)
+				errx(1, "invalid port: %s", optarg);
+			port = val;
+			break;
+		case 'm':
+			march = true;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	if (port != 0 && !prom)
+		usage();
+
+	if (bench != NULL) {
+		if (argc != 0 || aggregate || all_cpus || cache || fast ||
+		    header || march || midr || prom || quiet || topology ||
+		    interval != 0 || input != NULL || output != NULL)
+			usage();
+		return (bench_main(bench, prog));
+	}
+
+	if (midr) {
+		if (argc == 0 || aggregate || all_cpus || cache || fast ||
+		    header || march || prom || quiet || topology ||
+		    interval != 0 || input != NULL || output != NULL)
+			usage();
+		for (int i = 0; i < argc; i++) {
+			errno = 0;
+			val = strtoul(argv[i], &end, 16);
+			if (errno != 0 || *end != '\0' || end == argv[i] ||
+			    (unsigned long)val > UINT32_MAX)
+				errx(1, "invalid MIDR_EL1 value: %s", argv[i]);
+			printf("%20s = 0x%lx\n", "midr_el1", (unsigned long)val);
+			print_midr(val);
+		}
+		return (0);
+	}
+
+	if (aggregate) {
+		if (argc == 0 || all_cpus || cache || fast || header || march ||
+		    midr || prom || quiet || topology || interval != 0 ||
+		    input != NULL || output != NULL)
+			usage();
+		return (fleet_main(argc, argv, nthreads));
+	}
+
+	if (prom) {
+		if (argc != 0 || all_cpus || cache || decode || header ||
+		    march || quiet || topology || input != NULL ||
+		    (port != 0 && output != NULL))
+			usage();
+		return (prom_main(interval, fast, port, output));
+	}
+
+	if (topology) {
+		if (argc != 0 || all_cpus || cache || decode || header ||
+		    march || quiet || interval != 0 || input != NULL)
+			usage();
+		return (topo_main(nthreads, fast, output));
+	}
+
+	if (interval != 0) {
+		if (argc != 0 || all_cpus || cache || decode || header ||
+		    march || quiet || input != NULL)
+			usage();
+		return (watch_main(interval, fast, output));
+	}
+
+	if (march) {
+		if (all_cpus || decode || header || quiet || input != NULL ||
+		    output != NULL || (argc != 0 && (cache || fast)))
+			usage();
+		ms = march_alloc();
+		for (int i = 0; i < argc; i++) {
+			error = input_load(argv[i], march_add, ms);
+			if (error != 0) {
+				errno = error;
+				err(1, "%s", argv[i]);
 			}
 		}
-		printf("%20s = ", name);
+		if (argc != 0) {
+			march_print(ms);
+			return (0);
+		}
+	}
 
-		if (cursr->reader(&reg))
-			printf("<invalid>\n");
+	if (argc != 0) {
+		if (all_cpus || header || input != NULL || output != NULL)
+			usage();
+		return (select_main(argc, argv, cache, decode, fast, quiet));
+	}
+	if (quiet)
+		usage();
+
+	if (header) {
+		if (all_cpus || decode || output != NULL ||
+		    (input != NULL && (cache || fast)))
+			usage();
+		if (input != NULL) {
+			load_snapshot(input, &local_snap);
+			print_header(&local_snap);
+			return (0);
+		}
+	}
+
+	if (input != NULL) {
+		if (all_cpus || cache || fast || output != NULL)
+			usage();
+		print_archive(input, decode);
+		return (0);
+	}
+
+	if (all_cpus) {
+		if (cache)
+			usage();
+		error = arm64id_probe_cpus(&cpus, &ncpus,
+		    fast ? ARM64ID_PROBE_FAST : 0);
+		if (error != 0) {
+			errno = error;
+			err(1, "unable to probe all CPUs");
+		}
+		nclasses = arm64id_classify_cpus(cpus, ncpus);
+		if (output != NULL)
+			write_classes(output, cpus, ncpus, nclasses);
 		else
-			printf("0x%"PRIx64"\n", reg);
+			print_classes(cpus, ncpus, nclasses);
+		free(cpus);
+		return (0);
+	}
+
+	flags = fast ? ARM64ID_PROBE_FAST : 0;
+	cached = cache && cache_load(flags, &local_snap) == 0;
+	if (cached) {
+		snap = &local_snap;
+	} else if (fast) {
+		error = arm64id_probe_flags(&local_snap, flags, &stats);
+		if (error != 0) {
+			errno = error;
+			err(1, "unable to read the ID registers");
+		}
+		snap = &local_snap;
+	} else {
+		snap = arm64id_snapshot_get();
+		if (snap == NULL)
+			err(1, "unable to read the ID registers");
+	}
+
+	if (cache && !cached)
+		cache_store(flags, snap);
+
+	if (header) {
+		print_header(snap);
+	} else if (march) {
+		march_add(snap, ms);
+		march_print(ms);
+	} else if (output != NULL) {
+		arm64id_record_init(&rec, snap, 0, 1, 0);
+		write_records(output, &rec, 1);
+	} else {
+		print_snapshot(snap, decode);
 	}
 
-#if !defined(__APPLE__) && !defined(__NetBSD__)
-	print_hwcaps();
-#endif
+	if (fast && !cached)
+		fprintf(stderr, "%u traps avoided (%u from sysfs, %u skipped), "
+		    "%u mrs reads, %u faulted\n", stats.sysfs + stats.skipped,
+		    stats.sysfs, stats.skipped, stats.mrs, stats.faulted);
 
 	return (0);
 }
@@ -0,0 +1,383 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef	_ARM64ID_H_
+#define	_ARM64ID_H_
+
+#include <sys/cdefs.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arm64id_fields.h"
+
+/*
+ * Number of registers in the special_reg linker set. This is the number of
+ * SPECIAL_REGISTER_GROUP expansions in libarm64id.c times 8.
+ */
+#define	ARM64ID_NREGS		112
+/* AT_HWCAP .. AT_HWCAP4 */
+#define	ARM64ID_NHWCAPS		4
+
+/*
+ * The layout of struct arm64id_snapshot. It is separate from
+ * ARM64ID_RECORD_VERSION as snapshots are also stored outside records,
+ * e.g. in the per-boot cache.
+ */
+#define	ARM64ID_SNAPSHOT_VERSION	1
+
+/* Decode the value from arm64id_reg_encoding */
+#define	ARM64ID_ENC_OP1(enc)	(((enc) >> 11) & 0x7)
+#define	ARM64ID_ENC_CRN(enc)	(((enc) >> 7) & 0xf)
+#define	ARM64ID_ENC_CRM(enc)	(((enc) >> 3) & 0xf)
+#define	ARM64ID_ENC_OP2(enc)	((enc) & 0x7)
+/* The ID registers, op0 == 3, op1 == 0, CRn == 0 */
+#define	ARM64ID_ENC_IS_ID(enc)	(ARM64ID_ENC_OP1(enc) == 0 &&		\
+				 ARM64ID_ENC_CRN(enc) == 0)
+
+/*
+ * A snapshot of the ID registers and HWCAP words. Registers are stored
+ * sorted by their op1/CRn/CRm/op2 encoding, use arm64id_reg_name() to map
+ * an index to a name.
+ */
+struct arm64id_snapshot {
+	uint32_t	version;
+	uint32_t	nregs;
+	/* Bit n is set when regs[n] was read successfully */
+	uint64_t	reg_valid[(ARM64ID_NREGS + 63) / 64];
+	uint64_t	regs[ARM64ID_NREGS];
+	/* Bit n is set when hwcaps[n] (AT_HWCAP{,2,3,4}) is available */
+	uint32_t	hwcap_valid;
+	uint32_t	_pad;
+	uint64_t	hwcaps[ARM64ID_NHWCAPS];
+};
+
+/*
+ * A set of registers, bit n selects regs[n] in a snapshot. Used to limit
+ * arm64id_probe_regs to the registers the caller needs.
+ */
+struct arm64id_regset {
+	uint64_t	bits[(ARM64ID_NREGS + 63) / 64];
+};
+
+/* Flags for arm64id_probe_flags */
+#define	ARM64ID_PROBE_FAST	0x0001	/* Use sysfs and HWCAPs to avoid traps */
+
+struct arm64id_probe_stats {
+	uint32_t	sysfs;		/* Registers read from sysfs */
+	uint32_t	skipped;	/* Registers skipped as they would fault */
+	uint32_t	mrs;		/* Registers read with mrs */
+	uint32_t	faulted;	/* mrs reads that raised a signal */
+};
+
+/* One entry per online CPU from arm64id_probe_cpus */
+struct arm64id_cpu {
+	int		cpu;
+	int		error;		/* Non-zero if the CPU wasn't probed */
+	unsigned int	cpu_class;	/* Set by arm64id_classify_cpus */
+	struct arm64id_snapshot snap;
+};
+
+/*
+ * The binary record format. A record holds a snapshot along with the host
+ * it was taken on. Records are a fixed size so files of records can be
+ * concatenated into an archive and indexed directly. All fields are little
+ * endian.
+ */
+#define	ARM64ID_RECORD_MAGIC	0x49343641	/* "A64I" */
+#define	ARM64ID_RECORD_VERSION	1	/* The header, not the snapshot */
+
+struct arm64id_record {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	size;		/* sizeof(struct arm64id_record) */
+	uint16_t	cpu_class;
+	uint16_t	nclasses;	/* Number of classes on the host */
+	uint32_t	ncpus;		/* CPUs in this class, 0 if unknown */
+	char		hostname[64];
+	struct arm64id_snapshot snap;
+};
+
+struct arm64id_archive {
+	const struct arm64id_record *records;
+	size_t		nrecords;
+	size_t		map_size;
+};
+
+/* Iterate over the records in an archive without copying them */
+#define	ARM64ID_ARCHIVE_FOREACH(rec, ar)				\
+	for ((rec) = (ar)->records; (rec) < (ar)->records + (ar)->nrecords; \
+	    (rec)++)
+
+/*
+ * The default location of the per-boot snapshot cache, arm64id -c falls
+ * back to $XDG_RUNTIME_DIR when it can't write here.
+ */
+#define	ARM64ID_CACHE_PATH	"/run/arm64id.cache"
+
+/* Decoded ID register fields, see arm64id_fields.h */
+enum arm64id_field {
+#define	FIELD(reg, name, shift, width, sign, values)	\
+	ARM64ID_##reg##_##name,
+	ARM64ID_FIELD_TABLE
+#undef FIELD
+	ARM64ID_NFIELDS
+};
+
+struct arm64id_field_value {
+	int64_t		 value;
+	const char	*name;
+};
+
+struct arm64id_field_desc {
+	const char	*reg;
+	const char	*name;
+	uint32_t	 enc;		/* Encoding of the register */
+	uint8_t		 shift;
+	uint8_t		 width;
+	bool		 is_signed;
+	const struct arm64id_field_value *values; /* NULL name terminated */
+};
+
+/* Events counted by arm64id_perf_start and arm64id_perf_stop */
+enum arm64id_perf_event {
+	ARM64ID_PERF_CYCLES,
+	ARM64ID_PERF_INSTRUCTIONS,
+	ARM64ID_PERF_L1D_MISSES,
+	ARM64ID_PERF_LLC_MISSES,
+	ARM64ID_PERF_BRANCH_MISSES,
+	ARM64ID_PERF_NEVENTS
+};
+
+struct arm64id_perf {
+	int		fds[ARM64ID_PERF_NEVENTS];	/* -1 if not counted */
+	int		errors[ARM64ID_PERF_NEVENTS];	/* From opening fds */
+	uint64_t	timer_freq;	/* CNTFRQ_EL0 */
+	uint64_t	timer_start;
+};
+
+struct arm64id_perf_counts {
+	uint64_t	ticks;		/* Of the generic timer */
+	uint64_t	nsec;
+	/* Bit n is set when counts[n] is valid */
+	uint32_t	valid;
+	uint64_t	counts[ARM64ID_PERF_NEVENTS];
+};
+
+/* MIDR_EL1 fields */
+#define	ARM64ID_MIDR_IMPLEMENTER(midr)	(((midr) >> 24) & 0xff)
+#define	ARM64ID_MIDR_VARIANT(midr)	(((midr) >> 20) & 0xf)
+#define	ARM64ID_MIDR_PART(midr)		(((midr) >> 4) & 0xfff)
+#define	ARM64ID_MIDR_REVISION(midr)	((midr) & 0xf)
+
+struct arm64id_core {
+	uint8_t		 implementer;
+	uint16_t	 part;
+	const char	*name;
+	const char	*tune;		/* -mcpu/-mtune name, or NULL */
+};
+
+struct arm64id_erratum {
+	uint8_t		 implementer;
+	uint16_t	 part;
+	uint8_t		 rev_min;	/* (variant << 4) | revision */
+	uint8_t		 rev_max;
+	const char	*id;
+	const char	*impact;
+};
+
+struct arm64id_hwcap {
+	const char	*name;
+	uint64_t	 cap;
+};
+
+/*
+ * Runtime dispatch. An implementation of a function with the features it
+ * needs, see arm64id_requires for the format. Lists of implementations are
+ * ordered best first and should end with one with no requirements.
+ */
+typedef void (*arm64id_func_t)(void);
+
+struct arm64id_impl {
+	const char	*requires;
+	arm64id_func_t	 func;
+};
+
+/* A function pointer to resolve with arm64id_dispatch_init */
+struct arm64id_dispatch {
+	arm64id_func_t	*funcp;
+	const struct arm64id_impl *impls;
+	size_t		 nimpls;
+};
+
+#define	ARM64ID_IMPL(req, fn)	{ (req), (arm64id_func_t)(fn) }
+#define	ARM64ID_NIMPLS(impls)	(sizeof(impls) / sizeof((impls)[0]))
+
+/*
+ * The second argument to IFUNC resolvers on Linux and FreeBSD, the first is
+ * AT_HWCAP with ARM64ID_IFUNC_ARG_HWCAP set when this is valid.
+ */
+#define	ARM64ID_IFUNC_ARG_HWCAP	(1ULL << 62)
+
+struct arm64id_ifunc_arg {
+	uint64_t	size;
+	uint64_t	hwcap;
+	uint64_t	hwcap2;
+};
+
+#if defined(__aarch64__) && defined(__ELF__) &&				\
+    (defined(__linux__) || defined(__FreeBSD__))
+#define	ARM64ID_HAVE_IFUNC	1
+/*
+ * Define name as an IFUNC resolved from the impls array when the object is
+ * loaded, e.g.
+ *   ARM64ID_IFUNC(size_t, my_strlen, (const char *), strlen_impls);
+ * Only HWCAP requirements are checked. The implementations and libarm64id
+ * need to be linked into the same object as the IFUNC.
+ */
+#define	ARM64ID_IFUNC(ret, name, params, impls)				\
+static ret								\
+(*name##_resolve(uint64_t _hwcap, const struct arm64id_ifunc_arg *_arg)) \
+    params								\
+{									\
+	return ((ret (*) params)arm64id_ifunc_resolve(_hwcap, _arg,	\
+	    (impls), ARM64ID_NIMPLS(impls)));				\
+}									\
+ret name params __attribute__((__ifunc__(#name "_resolve")))
+#endif
+
+/*
+ * Define name as a function pointer that resolves itself from the process
+ * snapshot on the first call, e.g.
+ *   ARM64ID_DISPATCH(size_t, my_strlen, (const char *s), (s), strlen_impls);
+ */
+#define	ARM64ID_DISPATCH(ret, name, params, args, impls)		\
+static ret name##_first params;						\
+static ret (*name) params = name##_first;				\
+static ret								\
+name##_first params							\
+{									\
+	arm64id_func_t _func;						\
+									\
+	_func = arm64id_resolve(arm64id_snapshot_get(), (impls),	\
+	    ARM64ID_NIMPLS(impls));					\
+	__atomic_store_n(&name, (ret (*) params)_func,			\
+	    __ATOMIC_RELAXED);						\
+	return (name args);						\
+}
+
+__BEGIN_DECLS
+int	arm64id_probe(struct arm64id_snapshot *);
+int	arm64id_probe_flags(struct arm64id_snapshot *, int,
+	    struct arm64id_probe_stats *);
+int	arm64id_probe_regs(struct arm64id_snapshot *,
+	    const struct arm64id_regset *, int, struct arm64id_probe_stats *);
+int	arm64id_snapshot(struct arm64id_snapshot *);
+const struct arm64id_snapshot *arm64id_snapshot_get(void);
+
+int	arm64id_probe_cpus(struct arm64id_cpu **, unsigned int *, int);
+unsigned int arm64id_classify_cpus(struct arm64id_cpu *, unsigned int);
+bool	arm64id_snapshot_same_class(const struct arm64id_snapshot *,
+	    const struct arm64id_snapshot *);
+
+void	arm64id_record_init(struct arm64id_record *,
+	    const struct arm64id_snapshot *, unsigned int, unsigned int,
+	    unsigned int);
+bool	arm64id_record_valid(const struct arm64id_record *);
+int	arm64id_record_write(int, const struct arm64id_record *, size_t);
+int	arm64id_archive_open(const char *, struct arm64id_archive *);
+void	arm64id_archive_close(struct arm64id_archive *);
+
+int	arm64id_cache_load(const char *, int, struct arm64id_snapshot *);
+int	arm64id_cache_store(const char *, int, const struct arm64id_snapshot *);
+
+const struct arm64id_field_desc *arm64id_field_desc(enum arm64id_field);
+bool	arm64id_field_get(const struct arm64id_snapshot *, enum arm64id_field,
+	    int64_t *);
+const char *arm64id_field_value_name(enum arm64id_field, int64_t);
+
+const char *arm64id_reg_name(unsigned int);
+const char *arm64id_reg_sysname(unsigned int);
+uint32_t arm64id_reg_encoding(unsigned int);
+int	arm64id_reg_index(uint32_t);
+int	arm64id_reg_lookup(const char *);
+bool	arm64id_reg_volatile(unsigned int);
+unsigned int arm64id_regset_add(struct arm64id_regset *, const char *);
+
+const char *arm64id_implementer_name(uint8_t);
+const struct arm64id_core *arm64id_core_lookup(uint32_t);
+const struct arm64id_erratum *arm64id_core_errata(uint32_t, size_t *);
+bool	arm64id_erratum_applies(const struct arm64id_erratum *, uint32_t);
+
+bool	arm64id_requires(const struct arm64id_snapshot *, const char *);
+arm64id_func_t arm64id_resolve(const struct arm64id_snapshot *,
+	    const struct arm64id_impl *, size_t);
+int	arm64id_dispatch_init(const struct arm64id_snapshot *,
+	    const struct arm64id_dispatch *, size_t);
+void	arm64id_snapshot_hwcaps(struct arm64id_snapshot *, const uint64_t *,
+	    unsigned int);
+arm64id_func_t arm64id_ifunc_resolve(uint64_t,
+	    const struct arm64id_ifunc_arg *, const struct arm64id_impl *, size_t);
+
+int	arm64id_perf_open(struct arm64id_perf *);
+void	arm64id_perf_close(struct arm64id_perf *);
+void	arm64id_perf_start(struct arm64id_perf *);
+void	arm64id_perf_stop(struct arm64id_perf *, struct arm64id_perf_counts *);
+int	arm64id_perf_event_open(enum arm64id_perf_event, int, uint64_t);
+const char *arm64id_perf_event_name(enum arm64id_perf_event);
+
+const struct arm64id_hwcap *arm64id_hwcap_list(unsigned int, size_t *);
+const struct arm64id_hwcap *arm64id_hwcap_lookup(const char *, unsigned int *);
+
+static inline bool
+arm64id_reg_valid(const struct arm64id_snapshot *snap, unsigned int idx)
+{
+	return ((snap->reg_valid[idx / 64] & ((uint64_t)1 << (idx % 64))) != 0);
+}
+
+static inline bool
+arm64id_regset_isset(const struct arm64id_regset *set, unsigned int idx)
+{
+	return ((set->bits[idx / 64] & ((uint64_t)1 << (idx % 64))) != 0);
+}
+
+static inline bool
+arm64id_hwcap_valid(const struct arm64id_snapshot *snap, unsigned int word)
+{
+	return ((snap->hwcap_valid & (1u << word)) != 0);
+}
+
+static inline bool
+arm64id_perf_valid(const struct arm64id_perf_counts *c,
+    enum arm64id_perf_event ev)
+{
+	return ((c->valid & (1u << ev)) != 0);
+}
+__END_DECLS
+
+#endif /* !_ARM64ID_H_ */
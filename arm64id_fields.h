@@ -0,0 +1,609 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef	_ARM64ID_FIELDS_H_
+#define	_ARM64ID_FIELDS_H_
+
+/*
+ * The ID, cache type and affinity register fields decoded by arm64id.
+ * This is the single table the field enum, the field descriptors and their
+ * value names are generated from.
+ *
+ * FIELD(register, name, shift, width, U or S for unsigned or signed, values)
+ * VAL(value, meaning)
+ *
+ * Field and value names follow the Arm ARM, values with no VAL entry are
+ * printed as a number only.
+ */
+
+#define	ARM64ID_ENC(op1, crn, crm, op2)					\
+	((uint32_t)(op1) << 11 | (uint32_t)(crn) << 7 |			\
+	 (uint32_t)(crm) << 3 | (uint32_t)(op2))
+
+#define	ARM64ID_ENC_ID_AA64PFR0_EL1	ARM64ID_ENC(0, 0, 4, 0)
+#define	ARM64ID_ENC_ID_AA64PFR1_EL1	ARM64ID_ENC(0, 0, 4, 1)
+#define	ARM64ID_ENC_ID_AA64ZFR0_EL1	ARM64ID_ENC(0, 0, 4, 4)
+#define	ARM64ID_ENC_ID_AA64SMFR0_EL1	ARM64ID_ENC(0, 0, 4, 5)
+#define	ARM64ID_ENC_ID_AA64DFR0_EL1	ARM64ID_ENC(0, 0, 5, 0)
+#define	ARM64ID_ENC_ID_AA64ISAR0_EL1	ARM64ID_ENC(0, 0, 6, 0)
+#define	ARM64ID_ENC_ID_AA64ISAR1_EL1	ARM64ID_ENC(0, 0, 6, 1)
+#define	ARM64ID_ENC_ID_AA64ISAR2_EL1	ARM64ID_ENC(0, 0, 6, 2)
+#define	ARM64ID_ENC_ID_AA64MMFR0_EL1	ARM64ID_ENC(0, 0, 7, 0)
+#define	ARM64ID_ENC_ID_AA64MMFR1_EL1	ARM64ID_ENC(0, 0, 7, 1)
+#define	ARM64ID_ENC_ID_AA64MMFR2_EL1	ARM64ID_ENC(0, 0, 7, 2)
+#define	ARM64ID_ENC_ID_AA64MMFR3_EL1	ARM64ID_ENC(0, 0, 7, 3)
+#define	ARM64ID_ENC_ID_AA64MMFR4_EL1	ARM64ID_ENC(0, 0, 7, 4)
+#define	ARM64ID_ENC_MPIDR_EL1		ARM64ID_ENC(0, 0, 0, 5)
+#define	ARM64ID_ENC_CTR_EL0		ARM64ID_ENC(3, 0, 0, 1)
+#define	ARM64ID_ENC_DCZID_EL0		ARM64ID_ENC(3, 0, 0, 7)
+
+#define	ARM64ID_FIELD_TABLE						\
+FIELD(ID_AA64PFR0_EL1, CSV3, 60, 4, U,					\
+    VAL(0x1, "CSV3"))							\
+FIELD(ID_AA64PFR0_EL1, CSV2, 56, 4, U,					\
+    VAL(0x1, "CSV2")							\
+    VAL(0x2, "CSV2_2")							\
+    VAL(0x3, "CSV2_3"))							\
+FIELD(ID_AA64PFR0_EL1, RME, 52, 4, U,					\
+    VAL(0x1, "RME"))							\
+FIELD(ID_AA64PFR0_EL1, DIT, 48, 4, U,					\
+    VAL(0x1, "DIT"))							\
+FIELD(ID_AA64PFR0_EL1, AMU, 44, 4, U,					\
+    VAL(0x1, "AMUv1")							\
+    VAL(0x2, "AMUv1p1"))						\
+FIELD(ID_AA64PFR0_EL1, MPAM, 40, 4, U,					\
+    VAL(0x1, "MPAM"))							\
+FIELD(ID_AA64PFR0_EL1, SEL2, 36, 4, U,					\
+    VAL(0x1, "SEL2"))							\
+FIELD(ID_AA64PFR0_EL1, SVE, 32, 4, U,					\
+    VAL(0x1, "SVE"))							\
+FIELD(ID_AA64PFR0_EL1, RAS, 28, 4, U,					\
+    VAL(0x1, "RAS")							\
+    VAL(0x2, "RASv1p1")							\
+    VAL(0x3, "RASv2"))							\
+FIELD(ID_AA64PFR0_EL1, GIC, 24, 4, U,					\
+    VAL(0x1, "GICv3")							\
+    VAL(0x3, "GICv4p1"))						\
+FIELD(ID_AA64PFR0_EL1, AdvSIMD, 20, 4, S,				\
+    VAL(-1, "None")							\
+    VAL(0x0, "AdvSIMD")							\
+    VAL(0x1, "AdvSIMD+FP16"))						\
+FIELD(ID_AA64PFR0_EL1, FP, 16, 4, S,					\
+    VAL(-1, "None")							\
+    VAL(0x0, "FP")							\
+    VAL(0x1, "FP+FP16"))						\
+FIELD(ID_AA64PFR0_EL1, EL3, 12, 4, U,					\
+    VAL(0x0, "None")							\
+    VAL(0x1, "AArch64")							\
+    VAL(0x2, "AArch64+AArch32"))					\
+FIELD(ID_AA64PFR0_EL1, EL2, 8, 4, U,					\
+    VAL(0x0, "None")							\
+    VAL(0x1, "AArch64")							\
+    VAL(0x2, "AArch64+AArch32"))					\
+FIELD(ID_AA64PFR0_EL1, EL1, 4, 4, U,					\
+    VAL(0x1, "AArch64")							\
+    VAL(0x2, "AArch64+AArch32"))					\
+FIELD(ID_AA64PFR0_EL1, EL0, 0, 4, U,					\
+    VAL(0x1, "AArch64")							\
+    VAL(0x2, "AArch64+AArch32"))					\
+FIELD(ID_AA64PFR1_EL1, PFAR, 60, 4, U,					\
+    VAL(0x1, "PFAR"))							\
+FIELD(ID_AA64PFR1_EL1, DF2, 56, 4, U,					\
+    VAL(0x1, "DoubleFault2"))						\
+FIELD(ID_AA64PFR1_EL1, MTEX, 52, 4, U,					\
+    VAL(0x1, "MTE_NO_ADDRESS_TAGS"))					\
+FIELD(ID_AA64PFR1_EL1, THE, 48, 4, U,					\
+    VAL(0x1, "THE"))							\
+FIELD(ID_AA64PFR1_EL1, GCS, 44, 4, U,					\
+    VAL(0x1, "GCS"))							\
+FIELD(ID_AA64PFR1_EL1, MTE_frac, 40, 4, U,				\
+    VAL(0x0, "MTE_ASYNC")						\
+    VAL(0xf, "None"))							\
+FIELD(ID_AA64PFR1_EL1, NMI, 36, 4, U,					\
+    VAL(0x1, "NMI"))							\
+FIELD(ID_AA64PFR1_EL1, CSV2_frac, 32, 4, U,				\
+    VAL(0x1, "CSV2_1p1")						\
+    VAL(0x2, "CSV2_1p2"))						\
+FIELD(ID_AA64PFR1_EL1, RNDR_trap, 28, 4, U,				\
+    VAL(0x1, "RNG_TRAP"))						\
+FIELD(ID_AA64PFR1_EL1, SME, 24, 4, U,					\
+    VAL(0x1, "SME")							\
+    VAL(0x2, "SME2"))							\
+FIELD(ID_AA64PFR1_EL1, MPAM_frac, 16, 4, U, )				\
+FIELD(ID_AA64PFR1_EL1, RAS_frac, 12, 4, U,				\
+    VAL(0x1, "RASv1p1"))						\
+FIELD(ID_AA64PFR1_EL1, MTE, 8, 4, U,					\
+    VAL(0x1, "MTE")							\
+    VAL(0x2, "MTE2")							\
+    VAL(0x3, "MTE3"))							\
+FIELD(ID_AA64PFR1_EL1, SSBS, 4, 4, U,					\
+    VAL(0x1, "SSBS")							\
+    VAL(0x2, "SSBS2"))							\
+FIELD(ID_AA64PFR1_EL1, BT, 0, 4, U,					\
+    VAL(0x1, "BTI"))							\
+FIELD(ID_AA64ZFR0_EL1, F64MM, 56, 4, U,					\
+    VAL(0x1, "F64MM"))							\
+FIELD(ID_AA64ZFR0_EL1, F32MM, 52, 4, U,					\
+    VAL(0x1, "F32MM"))							\
+FIELD(ID_AA64ZFR0_EL1, F16MM, 48, 4, U,					\
+    VAL(0x1, "SVE_F16MM"))						\
+FIELD(ID_AA64ZFR0_EL1, I8MM, 44, 4, U,					\
+    VAL(0x1, "I8MM"))							\
+FIELD(ID_AA64ZFR0_EL1, SM4, 40, 4, U,					\
+    VAL(0x1, "SVE_SM4"))						\
+FIELD(ID_AA64ZFR0_EL1, SHA3, 32, 4, U,					\
+    VAL(0x1, "SVE_SHA3"))						\
+FIELD(ID_AA64ZFR0_EL1, B16B16, 24, 4, U,				\
+    VAL(0x1, "SVE_B16B16")						\
+    VAL(0x2, "SVE_BFSCALE"))						\
+FIELD(ID_AA64ZFR0_EL1, BF16, 20, 4, U,					\
+    VAL(0x1, "BF16")							\
+    VAL(0x2, "EBF16"))							\
+FIELD(ID_AA64ZFR0_EL1, BitPerm, 16, 4, U,				\
+    VAL(0x1, "SVE_BitPerm"))						\
+FIELD(ID_AA64ZFR0_EL1, EltPerm, 12, 4, U,				\
+    VAL(0x1, "SVE_ELTPERM"))						\
+FIELD(ID_AA64ZFR0_EL1, AES, 4, 4, U,					\
+    VAL(0x1, "SVE_AES")							\
+    VAL(0x2, "SVE_PMULL128")						\
+    VAL(0x3, "SVE_AES2"))						\
+FIELD(ID_AA64ZFR0_EL1, SVEver, 0, 4, U,					\
+    VAL(0x0, "SVE")							\
+    VAL(0x1, "SVE2")							\
+    VAL(0x2, "SVE2p1")							\
+    VAL(0x3, "SVE2p2"))							\
+FIELD(ID_AA64SMFR0_EL1, FA64, 63, 1, U,					\
+    VAL(0x1, "SME_FA64"))						\
+FIELD(ID_AA64SMFR0_EL1, LUTv2, 60, 1, U,				\
+    VAL(0x1, "SME_LUTv2"))						\
+FIELD(ID_AA64SMFR0_EL1, SMEver, 56, 4, U,				\
+    VAL(0x0, "SME")							\
+    VAL(0x1, "SME2")							\
+    VAL(0x2, "SME2p1")							\
+    VAL(0x3, "SME2p2"))							\
+FIELD(ID_AA64SMFR0_EL1, I16I64, 52, 4, U,				\
+    VAL(0xf, "SME_I16I64"))						\
+FIELD(ID_AA64SMFR0_EL1, F64F64, 48, 1, U,				\
+    VAL(0x1, "SME_F64F64"))						\
+FIELD(ID_AA64SMFR0_EL1, I16I32, 44, 4, U,				\
+    VAL(0x5, "SME_I16I32"))						\
+FIELD(ID_AA64SMFR0_EL1, B16B16, 43, 1, U,				\
+    VAL(0x1, "SME_B16B16"))						\
+FIELD(ID_AA64SMFR0_EL1, F16F16, 42, 1, U,				\
+    VAL(0x1, "SME_F16F16"))						\
+FIELD(ID_AA64SMFR0_EL1, F8F16, 41, 1, U,				\
+    VAL(0x1, "SME_F8F16"))						\
+FIELD(ID_AA64SMFR0_EL1, F8F32, 40, 1, U,				\
+    VAL(0x1, "SME_F8F32"))						\
+FIELD(ID_AA64SMFR0_EL1, I8I32, 36, 4, U,				\
+    VAL(0xf, "SME_I8I32"))						\
+FIELD(ID_AA64SMFR0_EL1, F16F32, 35, 1, U,				\
+    VAL(0x1, "SME_F16F32"))						\
+FIELD(ID_AA64SMFR0_EL1, B16F32, 34, 1, U,				\
+    VAL(0x1, "SME_B16F32"))						\
+FIELD(ID_AA64SMFR0_EL1, BI32I32, 33, 1, U,				\
+    VAL(0x1, "SME_BI32I32"))						\
+FIELD(ID_AA64SMFR0_EL1, F32F32, 32, 1, U,				\
+    VAL(0x1, "SME_F32F32"))						\
+FIELD(ID_AA64SMFR0_EL1, SF8FMA, 30, 1, U,				\
+    VAL(0x1, "SSVE_FP8FMA"))						\
+FIELD(ID_AA64SMFR0_EL1, SF8DP4, 29, 1, U,				\
+    VAL(0x1, "SSVE_FP8DOT4"))						\
+FIELD(ID_AA64SMFR0_EL1, SF8DP2, 28, 1, U,				\
+    VAL(0x1, "SSVE_FP8DOT2"))						\
+FIELD(ID_AA64DFR0_EL1, HPMN0, 60, 4, U,					\
+    VAL(0x1, "HPMN0"))							\
+FIELD(ID_AA64DFR0_EL1, ExtTrcBuff, 56, 4, U,				\
+    VAL(0x1, "TRBE_EXT"))						\
+FIELD(ID_AA64DFR0_EL1, BRBE, 52, 4, U,					\
+    VAL(0x1, "BRBE")							\
+    VAL(0x2, "BRBEv1p1"))						\
+FIELD(ID_AA64DFR0_EL1, MTPMU, 48, 4, S,					\
+    VAL(-1, "None")							\
+    VAL(0x0, "None")							\
+    VAL(0x1, "MTPMU"))							\
+FIELD(ID_AA64DFR0_EL1, TraceBuffer, 44, 4, U,				\
+    VAL(0x1, "TRBE")							\
+    VAL(0x2, "TRBE_MPAM"))						\
+FIELD(ID_AA64DFR0_EL1, TraceFilt, 40, 4, U,				\
+    VAL(0x1, "TRF"))							\
+FIELD(ID_AA64DFR0_EL1, DoubleLock, 36, 4, S,				\
+    VAL(-1, "None")							\
+    VAL(0x0, "DoubleLock"))						\
+FIELD(ID_AA64DFR0_EL1, PMSVer, 32, 4, U,				\
+    VAL(0x1, "SPE")							\
+    VAL(0x2, "SPEv1p1")							\
+    VAL(0x3, "SPEv1p2")							\
+    VAL(0x4, "SPEv1p3")							\
+    VAL(0x5, "SPEv1p4"))						\
+FIELD(ID_AA64DFR0_EL1, CTX_CMPs, 28, 4, U, )				\
+FIELD(ID_AA64DFR0_EL1, SEBEP, 24, 4, U,					\
+    VAL(0x1, "SEBEP"))							\
+FIELD(ID_AA64DFR0_EL1, WRPs, 20, 4, U, )				\
+FIELD(ID_AA64DFR0_EL1, PMSS, 16, 4, U,					\
+    VAL(0x1, "PMUv3_SS"))						\
+FIELD(ID_AA64DFR0_EL1, BRPs, 12, 4, U, )				\
+FIELD(ID_AA64DFR0_EL1, PMUVer, 8, 4, U,					\
+    VAL(0x0, "None")							\
+    VAL(0x1, "PMUv3")							\
+    VAL(0x4, "PMUv3p1")							\
+    VAL(0x5, "PMUv3p4")							\
+    VAL(0x6, "PMUv3p5")							\
+    VAL(0x7, "PMUv3p7")							\
+    VAL(0x8, "PMUv3p8")							\
+    VAL(0x9, "PMUv3p9")							\
+    VAL(0xf, "IMPDEF"))							\
+FIELD(ID_AA64DFR0_EL1, TraceVer, 4, 4, U,				\
+    VAL(0x1, "ETE"))							\
+FIELD(ID_AA64DFR0_EL1, DebugVer, 0, 4, U,				\
+    VAL(0x6, "Debugv8")							\
+    VAL(0x7, "VHE")							\
+    VAL(0x8, "Debugv8p2")						\
+    VAL(0x9, "Debugv8p4")						\
+    VAL(0xa, "Debugv8p8")						\
+    VAL(0xb, "Debugv8p9"))						\
+FIELD(ID_AA64ISAR0_EL1, RNDR, 60, 4, U,					\
+    VAL(0x1, "RNG"))							\
+FIELD(ID_AA64ISAR0_EL1, TLB, 56, 4, U,					\
+    VAL(0x1, "TLBIOS")							\
+    VAL(0x2, "TLBIRANGE"))						\
+FIELD(ID_AA64ISAR0_EL1, TS, 52, 4, U,					\
+    VAL(0x1, "FlagM")							\
+    VAL(0x2, "FlagM2"))							\
+FIELD(ID_AA64ISAR0_EL1, FHM, 48, 4, U,					\
+    VAL(0x1, "FHM"))							\
+FIELD(ID_AA64ISAR0_EL1, DP, 44, 4, U,					\
+    VAL(0x1, "DotProd"))						\
+FIELD(ID_AA64ISAR0_EL1, SM4, 40, 4, U,					\
+    VAL(0x1, "SM4"))							\
+FIELD(ID_AA64ISAR0_EL1, SM3, 36, 4, U,					\
+    VAL(0x1, "SM3"))							\
+FIELD(ID_AA64ISAR0_EL1, SHA3, 32, 4, U,					\
+    VAL(0x1, "SHA3"))							\
+FIELD(ID_AA64ISAR0_EL1, RDM, 28, 4, U,					\
+    VAL(0x1, "RDM"))							\
+FIELD(ID_AA64ISAR0_EL1, TME, 24, 4, U,					\
+    VAL(0x1, "TME"))							\
+FIELD(ID_AA64ISAR0_EL1, Atomic, 20, 4, U,				\
+    VAL(0x2, "LSE")							\
+    VAL(0x3, "LSE128"))							\
+FIELD(ID_AA64ISAR0_EL1, CRC32, 16, 4, U,				\
+    VAL(0x1, "CRC32"))							\
+FIELD(ID_AA64ISAR0_EL1, SHA2, 12, 4, U,					\
+    VAL(0x1, "SHA256")							\
+    VAL(0x2, "SHA512"))							\
+FIELD(ID_AA64ISAR0_EL1, SHA1, 8, 4, U,					\
+    VAL(0x1, "SHA1"))							\
+FIELD(ID_AA64ISAR0_EL1, AES, 4, 4, U,					\
+    VAL(0x1, "AES")							\
+    VAL(0x2, "PMULL"))							\
+FIELD(ID_AA64ISAR1_EL1, LS64, 60, 4, U,					\
+    VAL(0x1, "LS64")							\
+    VAL(0x2, "LS64_V")							\
+    VAL(0x3, "LS64_ACCDATA"))						\
+FIELD(ID_AA64ISAR1_EL1, XS, 56, 4, U,					\
+    VAL(0x1, "XS"))							\
+FIELD(ID_AA64ISAR1_EL1, I8MM, 52, 4, U,					\
+    VAL(0x1, "I8MM"))							\
+FIELD(ID_AA64ISAR1_EL1, DGH, 48, 4, U,					\
+    VAL(0x1, "DGH"))							\
+FIELD(ID_AA64ISAR1_EL1, BF16, 44, 4, U,					\
+    VAL(0x1, "BF16")							\
+    VAL(0x2, "EBF16"))							\
+FIELD(ID_AA64ISAR1_EL1, SPECRES, 40, 4, U,				\
+    VAL(0x1, "SPECRES")							\
+    VAL(0x2, "SPECRES2"))						\
+FIELD(ID_AA64ISAR1_EL1, SB, 36, 4, U,					\
+    VAL(0x1, "SB"))							\
+FIELD(ID_AA64ISAR1_EL1, FRINTTS, 32, 4, U,				\
+    VAL(0x1, "FRINTTS"))						\
+FIELD(ID_AA64ISAR1_EL1, GPI, 28, 4, U,					\
+    VAL(0x1, "PACIMP"))							\
+FIELD(ID_AA64ISAR1_EL1, GPA, 24, 4, U,					\
+    VAL(0x1, "PACQARMA5"))						\
+FIELD(ID_AA64ISAR1_EL1, LRCPC, 20, 4, U,				\
+    VAL(0x1, "LRCPC")							\
+    VAL(0x2, "LRCPC2")							\
+    VAL(0x3, "LRCPC3"))							\
+FIELD(ID_AA64ISAR1_EL1, FCMA, 16, 4, U,					\
+    VAL(0x1, "FCMA"))							\
+FIELD(ID_AA64ISAR1_EL1, JSCVT, 12, 4, U,				\
+    VAL(0x1, "JSCVT"))							\
+FIELD(ID_AA64ISAR1_EL1, API, 8, 4, U,					\
+    VAL(0x1, "PAuth")							\
+    VAL(0x2, "EPAC")							\
+    VAL(0x3, "PAuth2")							\
+    VAL(0x4, "FPAC")							\
+    VAL(0x5, "FPACCOMBINE"))						\
+FIELD(ID_AA64ISAR1_EL1, APA, 4, 4, U,					\
+    VAL(0x1, "PAuth")							\
+    VAL(0x2, "EPAC")							\
+    VAL(0x3, "PAuth2")							\
+    VAL(0x4, "FPAC")							\
+    VAL(0x5, "FPACCOMBINE"))						\
+FIELD(ID_AA64ISAR1_EL1, DPB, 0, 4, U,					\
+    VAL(0x1, "DPB")							\
+    VAL(0x2, "DPB2"))							\
+FIELD(ID_AA64ISAR2_EL1, ATS1A, 60, 4, U,				\
+    VAL(0x1, "ATS1A"))							\
+FIELD(ID_AA64ISAR2_EL1, LUT, 56, 4, U,					\
+    VAL(0x1, "LUT"))							\
+FIELD(ID_AA64ISAR2_EL1, CSSC, 52, 4, U,					\
+    VAL(0x1, "CSSC"))							\
+FIELD(ID_AA64ISAR2_EL1, RPRFM, 48, 4, U,				\
+    VAL(0x1, "RPRFM"))							\
+FIELD(ID_AA64ISAR2_EL1, PRFMSLC, 40, 4, U,				\
+    VAL(0x1, "PRFMSLC"))						\
+FIELD(ID_AA64ISAR2_EL1, SYSINSTR_128, 36, 4, U,				\
+    VAL(0x1, "SYSINSTR128"))						\
+FIELD(ID_AA64ISAR2_EL1, SYSREG_128, 32, 4, U,				\
+    VAL(0x1, "SYSREG128"))						\
+FIELD(ID_AA64ISAR2_EL1, CLRBHB, 28, 4, U,				\
+    VAL(0x1, "CLRBHB"))							\
+FIELD(ID_AA64ISAR2_EL1, PAC_frac, 24, 4, U,				\
+    VAL(0x1, "CONSTPACFIELD"))						\
+FIELD(ID_AA64ISAR2_EL1, BC, 20, 4, U,					\
+    VAL(0x1, "HBC"))							\
+FIELD(ID_AA64ISAR2_EL1, MOPS, 16, 4, U,					\
+    VAL(0x1, "MOPS"))							\
+FIELD(ID_AA64ISAR2_EL1, APA3, 12, 4, U,					\
+    VAL(0x1, "PAuth")							\
+    VAL(0x2, "EPAC")							\
+    VAL(0x3, "PAuth2")							\
+    VAL(0x4, "FPAC")							\
+    VAL(0x5, "FPACCOMBINE"))						\
+FIELD(ID_AA64ISAR2_EL1, GPA3, 8, 4, U,					\
+    VAL(0x1, "PACQARMA3"))						\
+FIELD(ID_AA64ISAR2_EL1, RPRES, 4, 4, U,					\
+    VAL(0x1, "RPRES"))							\
+FIELD(ID_AA64ISAR2_EL1, WFxT, 0, 4, U,					\
+    VAL(0x2, "WFxT"))							\
+FIELD(ID_AA64MMFR0_EL1, ECV, 60, 4, U,					\
+    VAL(0x1, "ECV")							\
+    VAL(0x2, "ECV_POFF"))						\
+FIELD(ID_AA64MMFR0_EL1, FGT, 56, 4, U,					\
+    VAL(0x1, "FGT")							\
+    VAL(0x2, "FGT2"))							\
+FIELD(ID_AA64MMFR0_EL1, ExS, 44, 4, U,					\
+    VAL(0x1, "ExS"))							\
+FIELD(ID_AA64MMFR0_EL1, TGran4_2, 40, 4, U, )				\
+FIELD(ID_AA64MMFR0_EL1, TGran64_2, 36, 4, U, )				\
+FIELD(ID_AA64MMFR0_EL1, TGran16_2, 32, 4, U, )				\
+FIELD(ID_AA64MMFR0_EL1, TGran4, 28, 4, S,				\
+    VAL(-1, "None")							\
+    VAL(0x0, "4K")							\
+    VAL(0x1, "4K_52bit"))						\
+FIELD(ID_AA64MMFR0_EL1, TGran64, 24, 4, S,				\
+    VAL(-1, "None")							\
+    VAL(0x0, "64K"))							\
+FIELD(ID_AA64MMFR0_EL1, TGran16, 20, 4, U,				\
+    VAL(0x0, "None")							\
+    VAL(0x1, "16K")							\
+    VAL(0x2, "16K_52bit"))						\
+FIELD(ID_AA64MMFR0_EL1, BigEndEL0, 16, 4, U,				\
+    VAL(0x1, "MixedEndianEL0"))						\
+FIELD(ID_AA64MMFR0_EL1, SNSMem, 12, 4, U,				\
+    VAL(0x1, "SNSMem"))							\
+FIELD(ID_AA64MMFR0_EL1, BigEnd, 8, 4, U,				\
+    VAL(0x1, "MixedEndian"))						\
+FIELD(ID_AA64MMFR0_EL1, ASIDBits, 4, 4, U,				\
+    VAL(0x0, "8bit")							\
+    VAL(0x2, "16bit"))							\
+FIELD(ID_AA64MMFR0_EL1, PARange, 0, 4, U,				\
+    VAL(0x0, "32bit")							\
+    VAL(0x1, "36bit")							\
+    VAL(0x2, "40bit")							\
+    VAL(0x3, "42bit")							\
+    VAL(0x4, "44bit")							\
+    VAL(0x5, "48bit")							\
+    VAL(0x6, "52bit")							\
+    VAL(0x7, "56bit"))							\
+FIELD(ID_AA64MMFR1_EL1, ECBHB, 60, 4, U,				\
+    VAL(0x1, "ECBHB"))							\
+FIELD(ID_AA64MMFR1_EL1, CMOW, 56, 4, U,					\
+    VAL(0x1, "CMOW"))							\
+FIELD(ID_AA64MMFR1_EL1, TIDCP1, 52, 4, U,				\
+    VAL(0x1, "TIDCP1"))							\
+FIELD(ID_AA64MMFR1_EL1, nTLBPA, 48, 4, U,				\
+    VAL(0x1, "nTLBPA"))							\
+FIELD(ID_AA64MMFR1_EL1, AFP, 44, 4, U,					\
+    VAL(0x1, "AFP"))							\
+FIELD(ID_AA64MMFR1_EL1, HCX, 40, 4, U,					\
+    VAL(0x1, "HCX"))							\
+FIELD(ID_AA64MMFR1_EL1, ETS, 36, 4, U,					\
+    VAL(0x2, "ETS2")							\
+    VAL(0x3, "ETS3"))							\
+FIELD(ID_AA64MMFR1_EL1, TWED, 32, 4, U,					\
+    VAL(0x1, "TWED"))							\
+FIELD(ID_AA64MMFR1_EL1, XNX, 28, 4, U,					\
+    VAL(0x1, "XNX"))							\
+FIELD(ID_AA64MMFR1_EL1, SpecSEI, 24, 4, U,				\
+    VAL(0x1, "SpecSEI"))						\
+FIELD(ID_AA64MMFR1_EL1, PAN, 20, 4, U,					\
+    VAL(0x1, "PAN")							\
+    VAL(0x2, "PAN2")							\
+    VAL(0x3, "PAN3"))							\
+FIELD(ID_AA64MMFR1_EL1, LO, 16, 4, U,					\
+    VAL(0x1, "LOR"))							\
+FIELD(ID_AA64MMFR1_EL1, HPDS, 12, 4, U,					\
+    VAL(0x1, "HPDS")							\
+    VAL(0x2, "HPDS2"))							\
+FIELD(ID_AA64MMFR1_EL1, VH, 8, 4, U,					\
+    VAL(0x1, "VHE"))							\
+FIELD(ID_AA64MMFR1_EL1, VMIDBits, 4, 4, U,				\
+    VAL(0x0, "8bit")							\
+    VAL(0x2, "16bit"))							\
+FIELD(ID_AA64MMFR1_EL1, HAFDBS, 0, 4, U,				\
+    VAL(0x1, "HAF")							\
+    VAL(0x2, "HAFDBS")							\
+    VAL(0x3, "HAFT")							\
+    VAL(0x4, "HDBSS"))							\
+FIELD(ID_AA64MMFR2_EL1, E0PD, 60, 4, U,					\
+    VAL(0x1, "E0PD"))							\
+FIELD(ID_AA64MMFR2_EL1, EVT, 56, 4, U,					\
+    VAL(0x1, "EVT")							\
+    VAL(0x2, "EVT_TTLBxS"))						\
+FIELD(ID_AA64MMFR2_EL1, BBM, 52, 4, U,					\
+    VAL(0x0, "BBML0")							\
+    VAL(0x1, "BBML1")							\
+    VAL(0x2, "BBML2"))							\
+FIELD(ID_AA64MMFR2_EL1, TTL, 48, 4, U,					\
+    VAL(0x1, "TTL"))							\
+FIELD(ID_AA64MMFR2_EL1, FWB, 40, 4, U,					\
+    VAL(0x1, "S2FWB"))							\
+FIELD(ID_AA64MMFR2_EL1, IDS, 36, 4, U,					\
+    VAL(0x1, "IDST"))							\
+FIELD(ID_AA64MMFR2_EL1, AT, 32, 4, U,					\
+    VAL(0x1, "LSE2"))							\
+FIELD(ID_AA64MMFR2_EL1, ST, 28, 4, U,					\
+    VAL(0x1, "TTST"))							\
+FIELD(ID_AA64MMFR2_EL1, NV, 24, 4, U,					\
+    VAL(0x1, "NV")							\
+    VAL(0x2, "NV2"))							\
+FIELD(ID_AA64MMFR2_EL1, CCIDX, 20, 4, U,				\
+    VAL(0x1, "CCIDX"))							\
+FIELD(ID_AA64MMFR2_EL1, VARange, 16, 4, U,				\
+    VAL(0x0, "48bit")							\
+    VAL(0x1, "52bit")							\
+    VAL(0x2, "56bit"))							\
+FIELD(ID_AA64MMFR2_EL1, IESB, 12, 4, U,					\
+    VAL(0x1, "IESB"))							\
+FIELD(ID_AA64MMFR2_EL1, LSM, 8, 4, U,					\
+    VAL(0x1, "LSMAOC"))							\
+FIELD(ID_AA64MMFR2_EL1, UAO, 4, 4, U,					\
+    VAL(0x1, "UAO"))							\
+FIELD(ID_AA64MMFR2_EL1, CnP, 0, 4, U,					\
+    VAL(0x1, "TTCNP"))							\
+FIELD(ID_AA64MMFR3_EL1, Spec_FPACC, 60, 4, U,				\
+    VAL(0x1, "FPACC_SPEC"))						\
+FIELD(ID_AA64MMFR3_EL1, ADERR, 56, 4, U, )				\
+FIELD(ID_AA64MMFR3_EL1, SDERR, 52, 4, U, )				\
+FIELD(ID_AA64MMFR3_EL1, ANERR, 44, 4, U, )				\
+FIELD(ID_AA64MMFR3_EL1, SNERR, 40, 4, U, )				\
+FIELD(ID_AA64MMFR3_EL1, D128_2, 36, 4, U,				\
+    VAL(0x1, "D128"))							\
+FIELD(ID_AA64MMFR3_EL1, D128, 32, 4, U,					\
+    VAL(0x1, "D128"))							\
+FIELD(ID_AA64MMFR3_EL1, MEC, 28, 4, U,					\
+    VAL(0x1, "MEC"))							\
+FIELD(ID_AA64MMFR3_EL1, AIE, 24, 4, U,					\
+    VAL(0x1, "AIE"))							\
+FIELD(ID_AA64MMFR3_EL1, S2POE, 20, 4, U,				\
+    VAL(0x1, "S2POE"))							\
+FIELD(ID_AA64MMFR3_EL1, S1POE, 16, 4, U,				\
+    VAL(0x1, "S1POE"))							\
+FIELD(ID_AA64MMFR3_EL1, S2PIE, 12, 4, U,				\
+    VAL(0x1, "S2PIE"))							\
+FIELD(ID_AA64MMFR3_EL1, S1PIE, 8, 4, U,					\
+    VAL(0x1, "S1PIE"))							\
+FIELD(ID_AA64MMFR3_EL1, SCTLRX, 4, 4, U,				\
+    VAL(0x1, "SCTLR2"))							\
+FIELD(ID_AA64MMFR3_EL1, TCRX, 0, 4, U,					\
+    VAL(0x1, "TCR2"))							\
+FIELD(ID_AA64MMFR4_EL1, E3DSE, 36, 4, U,				\
+    VAL(0x1, "E3DSE"))							\
+FIELD(ID_AA64MMFR4_EL1, E2H0, 24, 4, S,					\
+    VAL(0x0, "E2H0")							\
+    VAL(-1, "None")							\
+    VAL(-2, "None_NV1"))						\
+FIELD(ID_AA64MMFR4_EL1, NV_frac, 20, 4, U,				\
+    VAL(0x1, "NV2p1"))							\
+FIELD(ID_AA64MMFR4_EL1, FGWTE3, 16, 4, U,				\
+    VAL(0x1, "FGWTE3"))							\
+FIELD(ID_AA64MMFR4_EL1, HACDBS, 12, 4, U,				\
+    VAL(0x1, "HACDBS"))							\
+FIELD(ID_AA64MMFR4_EL1, ASID2, 8, 4, U,					\
+    VAL(0x1, "ASID2"))							\
+FIELD(ID_AA64MMFR4_EL1, EIESB, 4, 4, U,					\
+    VAL(0x1, "IESB_EXC")						\
+    VAL(0x2, "IESB_EXC_ALWAYS"))					\
+FIELD(CTR_EL0, TminLine, 32, 6, U,					\
+    VAL(0x2, "16 bytes")						\
+    VAL(0x3, "32 bytes")						\
+    VAL(0x4, "64 bytes")						\
+    VAL(0x5, "128 bytes")						\
+    VAL(0x6, "256 bytes"))						\
+FIELD(CTR_EL0, DIC, 29, 1, U,						\
+    VAL(0x1, "DIC"))							\
+FIELD(CTR_EL0, IDC, 28, 1, U,						\
+    VAL(0x1, "IDC"))							\
+FIELD(CTR_EL0, CWG, 24, 4, U,						\
+    VAL(0x0, "Unknown")							\
+    VAL(0x4, "64 bytes")						\
+    VAL(0x5, "128 bytes")						\
+    VAL(0x6, "256 bytes")						\
+    VAL(0x7, "512 bytes")						\
+    VAL(0x8, "1024 bytes")						\
+    VAL(0x9, "2048 bytes"))						\
+FIELD(CTR_EL0, ERG, 20, 4, U,						\
+    VAL(0x0, "Unknown")							\
+    VAL(0x4, "64 bytes")						\
+    VAL(0x5, "128 bytes")						\
+    VAL(0x6, "256 bytes")						\
+    VAL(0x7, "512 bytes")						\
+    VAL(0x8, "1024 bytes")						\
+    VAL(0x9, "2048 bytes"))						\
+FIELD(CTR_EL0, DminLine, 16, 4, U,					\
+    VAL(0x2, "16 bytes")						\
+    VAL(0x3, "32 bytes")						\
+    VAL(0x4, "64 bytes")						\
+    VAL(0x5, "128 bytes")						\
+    VAL(0x6, "256 bytes")						\
+    VAL(0x7, "512 bytes"))						\
+FIELD(CTR_EL0, L1Ip, 14, 2, U,						\
+    VAL(0x0, "VPIPT")							\
+    VAL(0x1, "AIVIVT")							\
+    VAL(0x2, "VIPT")							\
+    VAL(0x3, "PIPT"))							\
+FIELD(CTR_EL0, IminLine, 0, 4, U,					\
+    VAL(0x2, "16 bytes")						\
+    VAL(0x3, "32 bytes")						\
+    VAL(0x4, "64 bytes")						\
+    VAL(0x5, "128 bytes")						\
+    VAL(0x6, "256 bytes")						\
+    VAL(0x7, "512 bytes"))						\
+FIELD(DCZID_EL0, DZP, 4, 1, U,						\
+    VAL(0x1, "Prohibited"))						\
+FIELD(DCZID_EL0, BS, 0, 4, U,						\
+    VAL(0x2, "16 bytes")						\
+    VAL(0x3, "32 bytes")						\
+    VAL(0x4, "64 bytes")						\
+    VAL(0x5, "128 bytes")						\
+    VAL(0x6, "256 bytes")						\
+    VAL(0x7, "512 bytes")						\
+    VAL(0x8, "1024 bytes")						\
+    VAL(0x9, "2048 bytes"))						\
+FIELD(MPIDR_EL1, Aff3, 32, 8, U,)					\
+FIELD(MPIDR_EL1, U, 30, 1, U,						\
+    VAL(0x1, "Uniprocessor"))						\
+FIELD(MPIDR_EL1, MT, 24, 1, U,						\
+    VAL(0x1, "Multithreaded"))						\
+FIELD(MPIDR_EL1, Aff2, 16, 8, U,)					\
+FIELD(MPIDR_EL1, Aff1, 8, 8, U,)					\
+FIELD(MPIDR_EL1, Aff0, 0, 8, U,)
+
+#endif /* !_ARM64ID_FIELDS_H_ */
@@ -0,0 +1,470 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Compare LSE atomics with load/store exclusive loops under contention.
+ * Each variant is run with 1 to N pinned threads, all on one shared cache
+ * line and then each on its own line. This is the "atomics" benchmark.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+/* How long to run each variant for */
+#define	ATOMIC_USEC	(100 * 1000)
+/* Operations between timestamps, latency is per operation in a batch */
+#define	ATOMIC_BATCH	64
+/* Batch times kept per thread for the latency percentiles */
+#define	ATOMIC_SAMPLES	8192
+#define	ATOMIC_MAXCPUS	1024
+#define	ATOMIC_LINE	128
+
+#ifdef __aarch64__
+enum atomic_variant {
+	ATOMIC_LLSC,
+	ATOMIC_CAS,
+	ATOMIC_LDADD,
+	ATOMIC_SWP,
+	ATOMIC_LLSC_PAIR,
+	ATOMIC_CASP,
+	ATOMIC_LDCLRP,
+	ATOMIC_LDSETP,
+	ATOMIC_SWPP,
+	ATOMIC_NVARIANTS
+};
+
+static const struct {
+	const char	*name;
+	const char	*requires;	/* For arm64id_requires */
+} atomic_variants[ATOMIC_NVARIANTS] = {
+	[ATOMIC_LLSC] = { "ldxr_stxr", NULL },
+	[ATOMIC_CAS] = { "cas", "ATOMICS" },
+	[ATOMIC_LDADD] = { "ldadd", "ATOMICS" },
+	[ATOMIC_SWP] = { "swp", "ATOMICS" },
+	[ATOMIC_LLSC_PAIR] = { "ldxp_stxp", NULL },
+	[ATOMIC_CASP] = { "casp", "ATOMICS" },
+	[ATOMIC_LDCLRP] = { "ldclrp", "LSE128" },
+	[ATOMIC_LDSETP] = { "ldsetp", "LSE128" },
+	[ATOMIC_SWPP] = { "swpp", "LSE128" },
+};
+
+struct atomic_slot {
+	volatile uint64_t v[2];
+} __attribute__((__aligned__(ATOMIC_LINE)));
+
+struct atomic_thread {
+	pthread_t	 thread;
+	enum atomic_variant variant;
+	struct atomic_slot *slot;
+	volatile u_int	*state;		/* 0 wait, 1 run, 2 stop */
+	volatile u_int	*ready;
+	int		 cpu;
+	bool		 pinned;
+	uint64_t	 ops;
+	u_int		 nsamples;
+	uint32_t	 samples[ATOMIC_SAMPLES];	/* ns per batch */
+};
+
+struct atomic_result {
+	double		mops;		/* Million operations per second */
+	double		p50;		/* ns per operation */
+	double		p99;
+	double		max;
+};
+
+/*
+ * One atomic operation. The variant is a constant in the callers so this
+ * becomes a single sequence. All operations are relaxed. The LSE128
+ * instructions are emitted with .inst as not all assemblers know them,
+ * they use x0 and x1 for the data and x2 for the address.
+ */
+static inline __attribute__((__always_inline__)) void
+atomic_op(enum atomic_variant variant, volatile uint64_t *p)
+{
+	uint64_t cmp, hi, lo, tmp;
+	uint32_t fail;
+
+	switch (variant) {
+	case ATOMIC_LLSC:
+		__asm __volatile(
+		    "1:	ldxr	%0, [%2]\n"
+		    "	add	%0, %0, #1\n"
+		    "	stxr	%w1, %0, [%2]\n"
+		    "	cbnz	%w1, 1b\n"
+		    : "=&r"(tmp), "=&r"(fail) : "r"(p) : "memory");
+		break;
+	case ATOMIC_CAS:
+		tmp = p[0];
+		for (;;) {
+			cmp = tmp;
+			__asm __volatile(
+			    ".arch_extension lse\n"
+			    "	cas	%0, %2, [%1]\n"
+			    : "+r"(cmp) : "r"(p), "r"(tmp + 1) : "memory");
+			if (cmp == tmp)
+				break;
+			tmp = cmp;
+		}
+		break;
+	case ATOMIC_LDADD:
+		__asm __volatile(
+		    ".arch_extension lse\n"
+		    "	ldadd	%1, %0, [%2]\n"
+		    : "=r"(tmp) : "r"((uint64_t)1), "r"(p) : "memory");
+		break;
+	case ATOMIC_SWP:
+		__asm __volatile(
+		    ".arch_extension lse\n"
+		    "	swp	%1, %0, [%2]\n"
+		    : "=r"(tmp) : "r"((uint64_t)1), "r"(p) : "memory");
+		break;
+	case ATOMIC_LLSC_PAIR:
+		__asm __volatile(
+		    "1:	ldxp	%0, %1, [%3]\n"
+		    "	add	%0, %0, #1\n"
+		    "	stxp	%w2, %0, %1, [%3]\n"
+		    "	cbnz	%w2, 1b\n"
+		    : "=&r"(lo), "=&r"(hi), "=&r"(fail) : "r"(p) : "memory");
+		break;
+	case ATOMIC_CASP:
+		lo = p[0];
+		hi = p[1];
+		for (;;) {
+			register uint64_t x0 __asm("x0") = lo;
+			register uint64_t x1 __asm("x1") = hi;
+			register uint64_t x2 __asm("x2") = lo + 1;
+			register uint64_t x3 __asm("x3") = hi;
+
+			__asm __volatile(
+			    ".arch_extension lse\n"
+			    "	casp	x0, x1, x2, x3, [%4]\n"
+			    : "+r"(x0), "+r"(x1) : "r"(x2), "r"(x3), "r"(p)
+			    : "memory");
+			if (x0 == lo && x1 == hi)
+				break;
+			lo = x0;
+			hi = x1;
+		}
+		break;
+	case ATOMIC_LDCLRP:
+	case ATOMIC_LDSETP:
+	case ATOMIC_SWPP: {
+		register uint64_t x0 __asm("x0") = 1;
+		register uint64_t x1 __asm("x1") = 0;
+		register volatile uint64_t *x2 __asm("x2") = p;
+
+		if (variant == ATOMIC_LDCLRP)
+			/* ldclrp x0, x1, [x2] */
+			__asm __volatile(".inst 0x19211040"
+			    : "+r"(x0), "+r"(x1) : "r"(x2) : "memory");
+		else if (variant == ATOMIC_LDSETP)
+			/* ldsetp x0, x1, [x2] */
+			__asm __volatile(".inst 0x19213040"
+			    : "+r"(x0), "+r"(x1) : "r"(x2) : "memory");
+		else
+			/* swpp x0, x1, [x2] */
+			__asm __volatile(".inst 0x19218040"
+			    : "+r"(x0), "+r"(x1) : "r"(x2) : "memory");
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static inline __attribute__((__always_inline__)) void
+atomic_loop(struct atomic_thread *at, enum atomic_variant variant)
+{
+	volatile uint64_t *p;
+	uint64_t start;
+
+	p = at->slot->v;
+	while (*at->state == 1) {
+		start = bench_nsec();
+		for (u_int i = 0; i < ATOMIC_BATCH; i++)
+			atomic_op(variant, p);
+		at->samples[at->nsamples++ % ATOMIC_SAMPLES] =
+		    MIN(bench_nsec() - start, UINT32_MAX);
+		at->ops += ATOMIC_BATCH;
+	}
+}
+
+static void *
+atomic_thread(void *arg)
+{
+	struct atomic_thread *at;
+
+	at = arg;
+	at->pinned = bench_pin(at->cpu);
+	__atomic_fetch_add(at->ready, 1, __ATOMIC_RELEASE);
+	while (*at->state == 0)
+		;
+
+	switch (at->variant) {
+	case ATOMIC_LLSC:
+		atomic_loop(at, ATOMIC_LLSC);
+		break;
+	case ATOMIC_CAS:
+		atomic_loop(at, ATOMIC_CAS);
+		break;
+	case ATOMIC_LDADD:
+		atomic_loop(at, ATOMIC_LDADD);
+		break;
+	case ATOMIC_SWP:
+		atomic_loop(at, ATOMIC_SWP);
+		break;
+	case ATOMIC_LLSC_PAIR:
+		atomic_loop(at, ATOMIC_LLSC_PAIR);
+		break;
+	case ATOMIC_CASP:
+		atomic_loop(at, ATOMIC_CASP);
+		break;
+	case ATOMIC_LDCLRP:
+		atomic_loop(at, ATOMIC_LDCLRP);
+		break;
+	case ATOMIC_LDSETP:
+		atomic_loop(at, ATOMIC_LDSETP);
+		break;
+	case ATOMIC_SWPP:
+		atomic_loop(at, ATOMIC_SWPP);
+		break;
+	default:
+		break;
+	}
+	return (NULL);
+}
+
+static int
+atomic_cmp(const void *a, const void *b)
+{
+	uint32_t x, y;
+
+	x = *(const uint32_t *)a;
+	y = *(const uint32_t *)b;
+	return (x < y ? -1 : x > y);
+}
+
+/*
+ * Run a variant on the first nthreads CPUs. With shared set all threads
+ * use the same cache line, otherwise each has its own.
+ */
+static bool
+atomic_run(enum atomic_variant variant, const int *cpus, u_int nthreads,
+    bool shared, struct atomic_result *res)
+{
+	struct atomic_thread *threads;
+	struct atomic_slot *slots;
+	volatile u_int ready, state;
+	uint32_t *samples;
+	uint64_t begin, ns, ops;
+	size_t n;
+	bool pinned;
+
+	threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL)
+		err(1, "calloc");
+	if (posix_memalign((void **)&slots, ATOMIC_LINE,
+	    nthreads * sizeof(*slots)) != 0)
+		err(1, "posix_memalign");
+	memset(slots, 0, nthreads * sizeof(*slots));
+
+	ready = state = 0;
+	for (u_int i = 0; i < nthreads; i++) {
+		threads[i].variant = variant;
+		threads[i].slot = &slots[shared ? 0 : i];
+		threads[i].state = &state;
+		threads[i].ready = &ready;
+		threads[i].cpu = cpus[i];
+		if (pthread_create(&threads[i].thread, NULL, atomic_thread,
+		    &threads[i]) != 0)
+			errx(1, "pthread_create");
+	}
+	while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) != nthreads)
+		;
+	begin = bench_nsec();
+	state = 1;
+	usleep(ATOMIC_USEC);
+	state = 2;
+	for (u_int i = 0; i < nthreads; i++)
+		pthread_join(threads[i].thread, NULL);
+	ns = bench_nsec() - begin;
+
+	ops = n = 0;
+	pinned = true;
+	for (u_int i = 0; i < nthreads; i++) {
+		ops += threads[i].ops;
+		n += MIN(threads[i].nsamples, ATOMIC_SAMPLES);
+		pinned &= threads[i].pinned;
+	}
+	samples = malloc(MAX(n, 1) * sizeof(*samples));
+	if (samples == NULL)
+		err(1, "malloc");
+	n = 0;
+	for (u_int i = 0; i < nthreads; i++) {
+		memcpy(&samples[n], threads[i].samples,
+		    MIN(threads[i].nsamples, ATOMIC_SAMPLES) *
+		    sizeof(*samples));
+		n += MIN(threads[i].nsamples, ATOMIC_SAMPLES);
+	}
+	qsort(samples, n, sizeof(*samples), atomic_cmp);
+
+	memset(res, 0, sizeof(*res));
+	res->mops = (double)ops * 1000 / ns;
+	if (n != 0) {
+		res->p50 = (double)samples[n / 2] / ATOMIC_BATCH;
+		res->p99 = (double)samples[n * 99 / 100] / ATOMIC_BATCH;
+		res->max = (double)samples[n - 1] / ATOMIC_BATCH;
+	}
+
+	free(samples);
+	free(slots);
+	free(threads);
+	return (pinned);
+}
+
+/* Print a result in the "name = value" form of the snapshot output */
+static void
+atomic_print(enum atomic_variant variant, u_int padded, u_int nthreads,
+    const char *what, double val)
+{
+	printf("atomics.%s.%s.%u.%s = %.2f\n", atomic_variants[variant].name,
+	    padded ? "padded" : "shared", nthreads, what, val);
+}
+#endif
+
+void
+bench_atomics(void)
+{
+#ifdef __aarch64__
+	struct atomic_result (*results)[2];
+	const struct arm64id_snapshot *snap;
+	u_int counts[sizeof(u_int) * NBBY + 1], ncounts, ncpus;
+	int *cpus;
+	bool run[ATOMIC_NVARIANTS], unpinned;
+
+	snap = arm64id_snapshot_get();
+	if (snap == NULL)
+		errx(1, "unable to read the ID registers");
+	cpus = calloc(ATOMIC_MAXCPUS, sizeof(*cpus));
+	if (cpus == NULL)
+		err(1, "calloc");
+	ncpus = bench_cpus(cpus, ATOMIC_MAXCPUS);
+	if (ncpus == 0) {
+		/* Unpinned, let the scheduler place a single thread */
+		cpus[0] = -1;
+		ncpus = 1;
+	}
+
+	/* 1, 2, 4, ... threads and then all of the CPUs */
+	ncounts = 0;
+	for (u_int n = 1; n < ncpus; n *= 2)
+		counts[ncounts++] = n;
+	counts[ncounts++] = ncpus;
+
+	results = calloc(ATOMIC_NVARIANTS * ncounts, sizeof(*results));
+	if (results == NULL)
+		err(1, "calloc");
+
+	unpinned = false;
+	printf("%-10s %7s %10s %10s %8s %8s %8s\n", "variant", "threads",
+	    "line", "Mops/s", "p50 ns", "p99 ns", "max ns");
+	for (u_int v = 0; v < ATOMIC_NVARIANTS; v++) {
+		run[v] = atomic_variants[v].requires == NULL ||
+		    arm64id_requires(snap, atomic_variants[v].requires);
+		if (!run[v]) {
+			printf("%-10s needs %s\n", atomic_variants[v].name,
+			    atomic_variants[v].requires);
+			continue;
+		}
+		for (u_int c = 0; c < ncounts; c++) {
+			for (u_int s = 0; s < 2; s++) {
+				struct atomic_result *res;
+
+				/* One thread is the same on either layout */
+				if (counts[c] == 1 && s == 1)
+					continue;
+				res = &results[v * ncounts + c][s];
+				if (!atomic_run(v, cpus, counts[c], s == 0,
+				    res))
+					unpinned = true;
+				printf("%-10s %7u %10s %10.2f %8.2f %8.2f "
+				    "%8.2f\n", atomic_variants[v].name,
+				    counts[c], s == 0 ? "shared" : "padded",
+				    res->mops, res->p50, res->p99, res->max);
+			}
+		}
+	}
+	if (unpinned)
+		printf("some threads couldn't be pinned\n");
+
+	/*
+	 * Print the snapshot with the results so the output can be read back
+	 * as a text snapshot, e.g. with -m. The result names aren't registers
+	 * so are skipped when parsing.
+	 */
+	printf("\n");
+	print_snapshot(snap, false);
+	for (u_int v = 0; v < ATOMIC_NVARIANTS; v++) {
+		if (!run[v])
+			continue;
+		for (u_int c = 0; c < ncounts; c++) {
+			for (u_int s = 0; s < 2; s++) {
+				const struct atomic_result *res;
+
+				if (counts[c] == 1 && s == 1)
+					continue;
+				res = &results[v * ncounts + c][s];
+				atomic_print(v, s, counts[c], "mops",
+				    res->mops);
+				atomic_print(v, s, counts[c], "p50_ns",
+				    res->p50);
+				atomic_print(v, s, counts[c], "p99_ns",
+				    res->p99);
+				atomic_print(v, s, counts[c], "max_ns",
+				    res->max);
+			}
+		}
+	}
+
+	free(results);
+	free(cpus);
+#else
+	printf("atomics: needs arm64\n");
+#endif
+}
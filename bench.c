@@ -0,0 +1,621 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Benchmarks, run with arm64id -b name.
+ */
+
+#ifdef __linux__
+#define	_GNU_SOURCE	/* For sched_setaffinity */
+#endif
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/wait.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "hwcaps.h"
+#include "extern.h"
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#define	HAVE_SCHED_AFFINITY
+#endif
+
+/* Dependent adds to time to estimate the clock */
+#define	BENCH_ADDS	(100 * 1000 * 1000)
+/* The probe check runs two threads per CPU, each probing this many times */
+#define	BENCH_PROBE_CPUS	256
+#define	BENCH_PROBE_ITERS	200
+/* Runs of arm64id timed by the cache benchmark */
+#define	BENCH_SPAWNS	200
+
+struct bench {
+	const char	*name;
+	const char	*desc;
+	void		(*run)(void);
+};
+
+extern char **environ;
+
+/* argv[0], to run arm64id again */
+static char *bench_prog;
+
+uint64_t
+bench_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/*
+ * Find the CPU clock in GHz while running a chain of dependent adds. This
+ * is only used to turn times into cycles. The PMU cycle counter is used
+ * when the kernel lets us count it, otherwise each add is assumed to take
+ * a cycle. Returns 0 when unknown.
+ */
+double
+bench_ghz(void)
+{
+#ifdef __aarch64__
+	struct arm64id_perf perf;
+	struct arm64id_perf_counts c;
+	uint64_t x;
+
+	x = 0;
+	arm64id_perf_open(&perf);
+	arm64id_perf_start(&perf);
+	for (u_int i = 0; i < BENCH_ADDS / 100; i++)
+		__asm __volatile(".rept 100\n add %0, %0, #1\n .endr"
+		    : "+r"(x));
+	arm64id_perf_stop(&perf, &c);
+	arm64id_perf_close(&perf);
+	if (c.nsec == 0)
+		return (0);
+	if (arm64id_perf_valid(&c, ARM64ID_PERF_CYCLES))
+		return ((double)c.counts[ARM64ID_PERF_CYCLES] / c.nsec);
+	return ((double)x / c.nsec);
+#else
+	return (0);
+#endif
+}
+
+/*
+ * Fill in the CPUs this process may run on, returns how many there are, or
+ * 0 if they are unknown and threads can't be pinned.
+ */
+u_int
+bench_cpus(int *cpus, u_int max)
+{
+#ifdef HAVE_SCHED_AFFINITY
+	cpu_set_t set;
+	u_int n;
+
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		return (0);
+	n = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE && n < max; cpu++) {
+		if (CPU_ISSET(cpu, &set))
+			cpus[n++] = cpu;
+	}
+	return (n);
+#else
+	(void)cpus;
+	(void)max;
+	return (0);
+#endif
+}
+
+/* Pin the calling thread to a CPU */
+bool
+bench_pin(int cpu)
+{
+#ifdef HAVE_SCHED_AFFINITY
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return (sched_setaffinity(0, sizeof(set), &set) == 0);
+#else
+	(void)cpu;
+	return (false);
+#endif
+}
+
+/*
+ * Compare probing the registers with loading them from the per-boot cache.
+ * The cache is written to a temporary file so this doesn't need to be able
+ * to write to ARM64ID_CACHE_PATH.
+ */
+/*
+ * Run argv n times, waiting for each to exit, and return the average ns
+ * per run. The output is discarded.
+ */
+static double
+bench_spawn(char *const argv[], u_int n)
+{
+	posix_spawn_file_actions_t fa;
+	uint64_t start;
+	pid_t pid;
+	int error, status;
+
+	posix_spawn_file_actions_init(&fa);
+	posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null",
+	    O_WRONLY, 0);
+
+	start = bench_nsec();
+	for (u_int i = 0; i < n; i++) {
+		if (strchr(argv[0], '/') != NULL)
+			error = posix_spawn(&pid, argv[0], &fa, NULL, argv,
+			    environ);
+		else
+			error = posix_spawnp(&pid, argv[0], &fa, NULL, argv,
+			    environ);
+		if (error != 0) {
+			errno = error;
+			err(1, "%s", argv[0]);
+		}
+		while (waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR)
+				err(1, "waitpid");
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			errx(1, "%s %s failed", argv[0],
+			    argv[1] != NULL ? argv[1] : "");
+	}
+	posix_spawn_file_actions_destroy(&fa);
+	return ((double)(bench_nsec() - start) / n);
+}
+
+/*
+ * Compare running arm64id with and without -c, as a health check would,
+ * so the fork/exec and process setup is included. The probe and the cache
+ * load are also timed in-process to show how much of a run they are.
+ */
+static void
+bench_cache(void)
+{
+	struct arm64id_snapshot snap;
+	char path[] = "/tmp/arm64id-bench.XXXXXX";
+	char copt[] = "-c";
+	char *cold_argv[] = { bench_prog, NULL };
+	char *cached_argv[] = { bench_prog, copt, NULL };
+	uint64_t start, cold, cached;
+	double cold_run, cached_run;
+	u_int ncold, ncached;
+	int error, fd;
+
+	cold_run = bench_spawn(cold_argv, BENCH_SPAWNS);
+	/* The first run with -c fills the cache */
+	bench_spawn(cached_argv, 1);
+	cached_run = bench_spawn(cached_argv, BENCH_SPAWNS);
+	printf("%-12s %10.2f us/run (%u runs)\n", "arm64id",
+	    cold_run / 1000, BENCH_SPAWNS);
+	printf("%-12s %10.2f us/run (%u runs)%s\n", "arm64id -c",
+	    cached_run / 1000, BENCH_SPAWNS,
+	    cache_load(0, &snap) == 0 ? "" : ", the cache isn't writable");
+	printf("%-12s %10.1fx\n\n", "speedup", cold_run / cached_run);
+
+	ncold = 1000;
+	ncached = 100000;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		err(1, "mkstemp");
+	close(fd);
+
+	start = bench_nsec();
+	for (u_int i = 0; i < ncold; i++) {
+		error = arm64id_probe(&snap);
+		if (error != 0) {
+			unlink(path);
+			errno = error;
+			err(1, "unable to read the ID registers");
+		}
+	}
+	cold = bench_nsec() - start;
+
+	error = arm64id_cache_store(path, 0, &snap);
+	if (error != 0) {
+		unlink(path);
+		errno = error;
+		err(1, "%s", path);
+	}
+
+	start = bench_nsec();
+	for (u_int i = 0; i < ncached; i++) {
+		error = arm64id_cache_load(path, 0, &snap);
+		if (error != 0) {
+			unlink(path);
+			errno = error;
+			err(1, "%s", path);
+		}
+	}
+	cached = bench_nsec() - start;
+	unlink(path);
+
+	printf("in process: probe %.2f us, cache load %.2f us, %.1fx\n",
+	    cold / 1000.0 / ncold, cached / 1000.0 / ncached,
+	    ((double)cold / ncold) / ((double)cached / ncached));
+}
+
+/*
+ * Implementations for the dispatch benchmark. They are kept out of line so
+ * each call is a real call.
+ */
+static __attribute__((__noinline__)) int
+bench_add_generic(int x)
+{
+	__asm __volatile("" : "+r"(x));
+	return (x + 1);
+}
+
+static __attribute__((__noinline__)) int
+bench_add_lse(int x)
+{
+	__asm __volatile("" : "+r"(x));
+	return (x + 1);
+}
+
+static __attribute__((__noinline__)) int
+bench_add_sve2(int x)
+{
+	__asm __volatile("" : "+r"(x));
+	return (x + 1);
+}
+
+static const struct arm64id_impl bench_add_impls[] = {
+	ARM64ID_IMPL("SVE2 ID_AA64ZFR0_EL1.SVEver>=1", bench_add_sve2),
+	ARM64ID_IMPL("ATOMICS", bench_add_lse),
+	ARM64ID_IMPL(NULL, bench_add_generic),
+};
+
+ARM64ID_DISPATCH(int, bench_add_dispatch, (int x), (x), bench_add_impls);
+#ifdef ARM64ID_HAVE_IFUNC
+ARM64ID_IFUNC(int, bench_add_ifunc, (int), bench_add_impls);
+#endif
+
+/* As bench_add_impls without the field, so IFUNCs can pick each one */
+static const struct arm64id_impl bench_add_hwcap_impls[] = {
+	ARM64ID_IMPL("SVE2", bench_add_sve2),
+	ARM64ID_IMPL("ATOMICS", bench_add_lse),
+	ARM64ID_IMPL(NULL, bench_add_generic),
+};
+
+/*
+ * Check the IFUNC resolver with the arguments the dynamic linker would
+ * pass. AT_HWCAP2 is only used when the argument is flagged as present and
+ * large enough, and a field requirement is never met.
+ */
+static void
+bench_dispatch_check_ifunc(void)
+{
+	struct arm64id_ifunc_arg arg;
+	arm64id_func_t func;
+
+	memset(&arg, 0, sizeof(arg));
+	arg.size = sizeof(arg);
+	arg.hwcap = HWCAP_ATOMICS;
+	arg.hwcap2 = HWCAP2_SVE2;
+
+	func = arm64id_ifunc_resolve(ARM64ID_IFUNC_ARG_HWCAP | HWCAP_ATOMICS,
+	    &arg, bench_add_hwcap_impls, ARM64ID_NIMPLS(bench_add_hwcap_impls));
+	if (func != (arm64id_func_t)bench_add_sve2)
+		errx(1, "dispatch: IFUNC with HWCAP2_SVE2 didn't select sve2");
+
+	func = arm64id_ifunc_resolve(HWCAP_ATOMICS, &arg,
+	    bench_add_hwcap_impls, ARM64ID_NIMPLS(bench_add_hwcap_impls));
+	if (func != (arm64id_func_t)bench_add_lse)
+		errx(1, "dispatch: IFUNC used AT_HWCAP2 without the flag");
+
+	arg.size = offsetof(struct arm64id_ifunc_arg, hwcap2);
+	func = arm64id_ifunc_resolve(ARM64ID_IFUNC_ARG_HWCAP | HWCAP_ATOMICS,
+	    &arg, bench_add_hwcap_impls, ARM64ID_NIMPLS(bench_add_hwcap_impls));
+	if (func != (arm64id_func_t)bench_add_lse)
+		errx(1, "dispatch: IFUNC used AT_HWCAP2 past the arg size");
+
+	func = arm64id_ifunc_resolve(ARM64ID_IFUNC_ARG_HWCAP, NULL,
+	    bench_add_hwcap_impls, ARM64ID_NIMPLS(bench_add_hwcap_impls));
+	if (func != (arm64id_func_t)bench_add_generic)
+		errx(1, "dispatch: IFUNC with no HWCAPs didn't select generic");
+
+	/* The SVE2 implementation also needs a field so is never picked */
+	arg.size = sizeof(arg);
+	func = arm64id_ifunc_resolve(ARM64ID_IFUNC_ARG_HWCAP | HWCAP_ATOMICS,
+	    &arg, bench_add_impls, ARM64ID_NIMPLS(bench_add_impls));
+	if (func != (arm64id_func_t)bench_add_lse)
+		errx(1, "dispatch: IFUNC met a field requirement");
+
+	func = arm64id_ifunc_resolve(ARM64ID_IFUNC_ARG_HWCAP, &arg,
+	    bench_add_impls, ARM64ID_NIMPLS(bench_add_impls));
+	if (func != (arm64id_func_t)bench_add_generic)
+		errx(1, "dispatch: IFUNC met a field requirement");
+}
+
+/*
+ * Check each implementation is picked with a snapshot that only has the
+ * features it needs, so the timings below are for a known path.
+ */
+static void
+bench_dispatch_check(void)
+{
+	struct arm64id_snapshot snap;
+	uint64_t hwcaps[2];
+	const char *name;
+	arm64id_func_t func;
+	int idx;
+
+	memset(hwcaps, 0, sizeof(hwcaps));
+	hwcaps[1] = HWCAP2_SVE2;
+	arm64id_snapshot_hwcaps(&snap, hwcaps, 2);
+	idx = arm64id_reg_lookup("id_aa64zfr0_el1");
+	if (idx < 0)
+		errx(1, "no id_aa64zfr0_el1 register");
+	snap.regs[idx] = 1;	/* SVEver == 1, SVE2 */
+	snap.reg_valid[idx / 64] |= (uint64_t)1 << (idx % 64);
+	func = arm64id_resolve(&snap, bench_add_impls,
+	    ARM64ID_NIMPLS(bench_add_impls));
+	if (func != (arm64id_func_t)bench_add_sve2)
+		errx(1, "dispatch: SVE2 snapshot didn't select sve2");
+
+	/* Without the field only the HWCAP is set so SVE2 isn't picked */
+	snap.reg_valid[idx / 64] &= ~((uint64_t)1 << (idx % 64));
+	hwcaps[0] = HWCAP_ATOMICS;
+	arm64id_snapshot_hwcaps(&snap, hwcaps, 2);
+	func = arm64id_resolve(&snap, bench_add_impls,
+	    ARM64ID_NIMPLS(bench_add_impls));
+	if (func != (arm64id_func_t)bench_add_lse)
+		errx(1, "dispatch: ATOMICS snapshot didn't select lse");
+
+	func = arm64id_resolve(NULL, bench_add_impls,
+	    ARM64ID_NIMPLS(bench_add_impls));
+	if (func != (arm64id_func_t)bench_add_generic)
+		errx(1, "dispatch: empty snapshot didn't select generic");
+
+	bench_dispatch_check_ifunc();
+
+	func = arm64id_resolve(arm64id_snapshot_get(), bench_add_impls,
+	    ARM64ID_NIMPLS(bench_add_impls));
+	if (func == (arm64id_func_t)bench_add_sve2)
+		name = "sve2";
+	else if (func == (arm64id_func_t)bench_add_lse)
+		name = "lse";
+	else
+		name = "generic";
+	printf("%-12s %s\n", "selected", name);
+}
+
+static void
+bench_dispatch(void)
+{
+	int (*volatile indirect)(int);
+	uint64_t start, ns;
+	const u_int n = 100000000;
+	u_int runs;
+	int x;
+
+	bench_dispatch_check();
+
+	/* Resolve before timing */
+	(void)bench_add_dispatch(0);
+	indirect = bench_add_generic;
+
+	x = 0;
+	runs = 3;
+	start = bench_nsec();
+	for (u_int i = 0; i < n; i++)
+		x = bench_add_generic(x);
+	ns = bench_nsec() - start;
+	printf("%-12s %10.3f ns/call\n", "direct", (double)ns / n);
+
+	start = bench_nsec();
+	for (u_int i = 0; i < n; i++)
+		x = indirect(x);
+	ns = bench_nsec() - start;
+	printf("%-12s %10.3f ns/call\n", "indirect", (double)ns / n);
+
+	start = bench_nsec();
+	for (u_int i = 0; i < n; i++)
+		x = bench_add_dispatch(x);
+	ns = bench_nsec() - start;
+	printf("%-12s %10.3f ns/call\n", "dispatch", (double)ns / n);
+
+#ifdef ARM64ID_HAVE_IFUNC
+	start = bench_nsec();
+	for (u_int i = 0; i < n; i++)
+		x = bench_add_ifunc(x);
+	ns = bench_nsec() - start;
+	printf("%-12s %10.3f ns/call\n", "ifunc", (double)ns / n);
+	runs++;
+#endif
+
+	if ((u_int)x != n * runs)
+		errx(1, "dispatch: bad result %d", x);
+}
+
+#ifdef __aarch64__
+struct bench_probe_worker {
+	pthread_t	 thread;
+	int		 cpu;		/* -1 if not pinned */
+	const struct arm64id_snapshot *ref;
+	u_int		 mismatches;
+	int		 error;
+};
+
+static void *
+bench_probe_thread(void *arg)
+{
+	struct bench_probe_worker *w;
+	struct arm64id_snapshot snap;
+
+	w = arg;
+	if (w->cpu >= 0 && !bench_pin(w->cpu)) {
+		w->error = errno;
+		return (NULL);
+	}
+	for (u_int i = 0; i < BENCH_PROBE_ITERS; i++) {
+		w->error = arm64id_probe(&snap);
+		if (w->error != 0)
+			return (NULL);
+		if (!arm64id_snapshot_same_class(w->ref, &snap))
+			w->mismatches++;
+	}
+	return (NULL);
+}
+#endif
+
+/*
+ * Check probing is thread safe. A single threaded probe of each CPU is
+ * the reference, then two threads per CPU probe it concurrently so the
+ * signal handlers are installed and removed while other threads are
+ * taking faults. Every probe must match the reference.
+ */
+static void
+bench_probe(void)
+{
+#ifdef __aarch64__
+	struct arm64id_snapshot *refs;
+	struct bench_probe_worker *workers;
+	int cpus[BENCH_PROBE_CPUS];
+	uint64_t start, ns;
+	u_int mismatches, ncpus, nrefs, nworkers;
+	int error;
+
+	ncpus = bench_cpus(cpus, nitems(cpus));
+	nrefs = MAX(ncpus, 1);
+	nworkers = nrefs * 2;
+	refs = calloc(nrefs, sizeof(*refs));
+	workers = calloc(nworkers, sizeof(*workers));
+	if (refs == NULL || workers == NULL)
+		err(1, "calloc");
+
+	for (u_int i = 0; i < nrefs; i++) {
+		if (ncpus != 0 && !bench_pin(cpus[i]))
+			err(1, "unable to pin to cpu %d", cpus[i]);
+		error = arm64id_probe(&refs[i]);
+		if (error != 0) {
+			errno = error;
+			err(1, "unable to read the ID registers");
+		}
+	}
+
+	start = bench_nsec();
+	for (u_int i = 0; i < nworkers; i++) {
+		workers[i].cpu = ncpus != 0 ? cpus[i % ncpus] : -1;
+		workers[i].ref = &refs[i % nrefs];
+		error = pthread_create(&workers[i].thread, NULL,
+		    bench_probe_thread, &workers[i]);
+		if (error != 0) {
+			errno = error;
+			err(1, "pthread_create");
+		}
+	}
+	mismatches = 0;
+	for (u_int i = 0; i < nworkers; i++) {
+		pthread_join(workers[i].thread, NULL);
+		if (workers[i].error != 0) {
+			errno = workers[i].error;
+			err(1, "probe: thread %u", i);
+		}
+		mismatches += workers[i].mismatches;
+	}
+	ns = bench_nsec() - start;
+
+	if (mismatches != 0)
+		errx(1, "probe: %u of %u concurrent probes differ from the "
+		    "single threaded probe", mismatches,
+		    nworkers * BENCH_PROBE_ITERS);
+	printf("%u threads on %u cpu%s, %u probes each, all match the single "
+	    "threaded probe\n", nworkers, nrefs, nrefs == 1 ? "" : "s",
+	    BENCH_PROBE_ITERS);
+	printf("%.1f us per probe\n",
+	    (double)ns * nrefs / (nworkers * BENCH_PROBE_ITERS) / 1000);
+	free(workers);
+	free(refs);
+#else
+	printf("probe: needs arm64\n");
+#endif
+}
+
+static const struct bench benches[] = {
+	{ "atomics", "LSE vs exclusive atomics with 1 to N threads",
+	    bench_atomics },
+	{ "cache", "arm64id vs arm64id -c, and probe vs cache load",
+	    bench_cache },
+	{ "crypto", "crypto and CRC extension throughput in bytes/cycle",
+	    bench_crypto },
+	{ "dispatch", "dispatch call overhead vs direct and indirect calls",
+	    bench_dispatch },
+	{ "geometry", "measure cache sizes, coherence granule and DC ZVA",
+	    bench_geometry },
+	{ "mops", "MOPS memcpy/memset vs libc and a NEON loop",
+	    bench_mops },
+	{ "mte", "MTE allocation and copy cost in each tag check mode",
+	    bench_mte },
+	{ "pmu", "PMU version, perf_event access and a sample count",
+	    bench_pmu },
+	{ "probe", "concurrent probes from every cpu vs a single thread",
+	    bench_probe },
+	{ "timer", "generic timer read cost, resolution and cross-cpu skew",
+	    bench_timer },
+	{ "vl", "SVE and SME vector lengths and throughput at each",
+	    bench_vl },
+};
+
+int
+bench_main(const char *name, char *prog)
+{
+	bench_prog = prog;
+	for (size_t i = 0; i < nitems(benches); i++) {
+		if (strcmp(name, benches[i].name) == 0) {
+			benches[i].run();
+			return (0);
+		}
+	}
+
+	fprintf(stderr, "unknown benchmark %s, available benchmarks:\n", name);
+	for (size_t i = 0; i < nitems(benches); i++)
+		fprintf(stderr, "  %-12s %s\n", benches[i].name,
+		    benches[i].desc);
+	return (1);
+}
@@ -0,0 +1,246 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A per-boot cache of a snapshot. The ID registers and HWCAPs can only
+ * change across a reboot or when CPUs are brought on or offline, so a
+ * snapshot stored with the boot ID and the online CPU mask can be reused
+ * by later runs until either changes. Volatile registers, e.g. MPIDR_EL1 or
+ * the counters, hold the values from when the cache was written.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__FreeBSD__) || defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/time.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+
+#define	CACHE_MAGIC	0x43343641	/* "A64C" */
+#define	CACHE_VERSION	1
+
+struct cache_key {
+	char		boot_id[40];
+	uint64_t	online_hash;	/* FNV-1a of the online CPU list */
+	uint32_t	flags;		/* arm64id_probe_flags flags */
+	uint32_t	_pad;
+};
+
+struct cache_file {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	size;		/* sizeof(struct cache_file) */
+	struct cache_key key;
+	struct arm64id_snapshot snap;
+};
+
+static bool
+cache_read_file(const char *path, char *buf, size_t len)
+{
+	ssize_t ret;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return (false);
+	ret = read(fd, buf, len - 1);
+	close(fd);
+	if (ret <= 0)
+		return (false);
+	buf[ret] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return (true);
+}
+
+static uint64_t
+cache_hash(const char *str)
+{
+	uint64_t hash;
+
+	hash = 14695981039346656037ull;
+	for (; *str != '\0'; str++) {
+		hash ^= (uint8_t)*str;
+		hash *= 1099511628211ull;
+	}
+	return (hash);
+}
+
+static int
+cache_key_init(struct cache_key *key, int flags)
+{
+	char online[1024];
+
+	memset(key, 0, sizeof(*key));
+	key->flags = flags;
+
+#if defined(__linux__)
+	if (!cache_read_file("/proc/sys/kernel/random/boot_id", key->boot_id,
+	    sizeof(key->boot_id)))
+		return (ENOTSUP);
+	if (!cache_read_file("/sys/devices/system/cpu/online", online,
+	    sizeof(online)))
+		return (ENOTSUP);
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+	struct timeval tv;
+	size_t len;
+
+	len = sizeof(tv);
+	if (sysctlbyname("kern.boottime", &tv, &len, NULL, 0) != 0)
+		return (errno);
+	snprintf(key->boot_id, sizeof(key->boot_id), "%jd.%06ld",
+	    (intmax_t)tv.tv_sec, (long)tv.tv_usec);
+	snprintf(online, sizeof(online), "%ld",
+	    sysconf(_SC_NPROCESSORS_ONLN));
+#else
+	(void)online;
+	return (ENOTSUP);
+#endif
+	key->online_hash = cache_hash(online);
+	return (0);
+}
+
+/*
+ * Load a snapshot from the cache at path. Returns ENOENT if there is no
+ * cache, or ESTALE if it was written on a different boot, with different
+ * CPUs online, or with different flags. The caller should probe and call
+ * arm64id_cache_store in either case.
+ */
+int
+arm64id_cache_load(const char *path, int flags, struct arm64id_snapshot *snap)
+{
+	struct cache_key key;
+	const struct cache_file *cf;
+	struct stat sb;
+	void *map;
+	int error, fd;
+
+	error = cache_key_init(&key, flags);
+	if (error != 0)
+		return (error);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return (errno);
+	if (fstat(fd, &sb) != 0) {
+		error = errno;
+		close(fd);
+		return (error);
+	}
+	if (sb.st_size != sizeof(*cf)) {
+		close(fd);
+		return (EINVAL);
+	}
+
+	map = mmap(NULL, sizeof(*cf), PROT_READ, MAP_SHARED, fd, 0);
+	error = errno;
+	close(fd);
+	if (map == MAP_FAILED)
+		return (error);
+
+	cf = map;
+	if (cf->magic != CACHE_MAGIC || cf->version != CACHE_VERSION ||
+	    cf->size != sizeof(*cf) ||
+	    cf->snap.version != ARM64ID_SNAPSHOT_VERSION ||
+	    cf->snap.nregs != ARM64ID_NREGS) {
+		error = EINVAL;
+	} else if (memcmp(&cf->key, &key, sizeof(key)) != 0) {
+		error = ESTALE;
+	} else {
+		memcpy(snap, &cf->snap, sizeof(*snap));
+		error = 0;
+	}
+	munmap(map, sizeof(*cf));
+	return (error);
+}
+
+/*
+ * Store a snapshot in the cache at path. The file is replaced atomically so
+ * concurrent readers see either the old or the new cache.
+ */
+int
+arm64id_cache_store(const char *path, int flags,
+    const struct arm64id_snapshot *snap)
+{
+	struct cache_file cf;
+	char tmp[PATH_MAX];
+	const char *buf;
+	size_t len;
+	ssize_t ret;
+	int error, fd;
+
+	memset(&cf, 0, sizeof(cf));
+	error = cache_key_init(&cf.key, flags);
+	if (error != 0)
+		return (error);
+	cf.magic = CACHE_MAGIC;
+	cf.version = CACHE_VERSION;
+	cf.size = sizeof(cf);
+	memcpy(&cf.snap, snap, sizeof(cf.snap));
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp))
+		return (ENAMETOOLONG);
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		return (errno);
+
+	error = 0;
+	buf = (const char *)&cf;
+	len = sizeof(cf);
+	while (len > 0) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			error = errno;
+			break;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	if (error == 0 && fchmod(fd, 0644) != 0)
+		error = errno;
+	if (close(fd) != 0 && error == 0)
+		error = errno;
+	if (error == 0 && rename(tmp, path) != 0)
+		error = errno;
+	if (error != 0)
+		unlink(tmp);
+	return (error);
+}
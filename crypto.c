@@ -0,0 +1,1611 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Throughput of the crypto and checksum extensions. Each extension the
+ * snapshot has is used to run a standard kernel, e.g. AES-GCM, SHA-256 or
+ * CRC32C, and the result is reported in bytes per cycle. Where there is a
+ * known answer each kernel is checked before it is timed. This is the
+ * "crypto" benchmark.
+ *
+ * The kernels are written in C around one asm statement per instruction,
+ * using .arch_extension so no -march flags are needed, and the compiler
+ * allocates the registers.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#include "arm64id.h"
+#include "extern.h"
+
+/* Bytes per call, this fits in the L1 D-cache with the output */
+#define	CRYPTO_BYTES	(16 * 1024)
+/* Bytes to process for each measurement */
+#define	CRYPTO_TOTAL	(64 * 1024 * 1024)
+
+#ifdef __aarch64__
+struct crypto_kernel {
+	const char	*name;
+	const char	*requires;	/* For arm64id_requires */
+	/* Process len bytes of in, returns how many were used */
+	size_t		(*run)(const uint8_t *, uint8_t *, size_t);
+	bool		(*check)(void);	/* Known answer test */
+};
+
+/*
+ * CRC32 and CRC32C, the checksum is kept across calls.
+ */
+static uint32_t crypto_crc;
+
+static inline uint32_t
+crc32x(uint32_t crc, uint64_t v)
+{
+	__asm(".arch_extension crc\n"
+	    "crc32x %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+	return (crc);
+}
+
+static inline uint32_t
+crc32b(uint32_t crc, uint8_t v)
+{
+	__asm(".arch_extension crc\n"
+	    "crc32b %w0, %w0, %w1" : "+r"(crc) : "r"((uint32_t)v));
+	return (crc);
+}
+
+static inline uint32_t
+crc32cx(uint32_t crc, uint64_t v)
+{
+	__asm(".arch_extension crc\n"
+	    "crc32cx %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+	return (crc);
+}
+
+static inline uint32_t
+crc32cb(uint32_t crc, uint8_t v)
+{
+	__asm(".arch_extension crc\n"
+	    "crc32cb %w0, %w0, %w1" : "+r"(crc) : "r"((uint32_t)v));
+	return (crc);
+}
+
+static uint32_t
+crypto_crc32(uint32_t crc, const uint8_t *p, size_t len, bool castagnoli)
+{
+	uint64_t v;
+
+	crc = ~crc;
+	for (; len >= 8; len -= 8, p += 8) {
+		memcpy(&v, p, sizeof(v));
+		crc = castagnoli ? crc32cx(crc, v) : crc32x(crc, v);
+	}
+	for (; len > 0; len--, p++)
+		crc = castagnoli ? crc32cb(crc, *p) : crc32b(crc, *p);
+	return (~crc);
+}
+
+static size_t
+crypto_run_crc32(const uint8_t *in, uint8_t *out, size_t len)
+{
+	crypto_crc = crypto_crc32(crypto_crc, in, len, false);
+	return (len);
+}
+
+static size_t
+crypto_run_crc32c(const uint8_t *in, uint8_t *out, size_t len)
+{
+	crypto_crc = crypto_crc32(crypto_crc, in, len, true);
+	return (len);
+}
+
+static bool
+crypto_check_crc32(void)
+{
+	const uint8_t msg[] = "123456789";
+
+	/* The standard check values, with an unaligned tail */
+	return (crypto_crc32(0, msg, 9, false) == 0xcbf43926 &&
+	    crypto_crc32(0, msg, 9, true) == 0xe3069283);
+}
+
+/*
+ * AES-128. The key schedule is done in C with an S-box computed at
+ * startup, the rounds use AESE and AESMC. Four blocks are encrypted at a
+ * time so the rounds of different blocks overlap.
+ */
+static uint8_t aes_sbox[256];
+static uint8x16_t aes_rk[11];
+
+static inline uint8x16_t
+aese(uint8x16_t v, uint8x16_t k)
+{
+	__asm(".arch_extension aes\n"
+	    "aese %0.16b, %1.16b" : "+w"(v) : "w"(k));
+	return (v);
+}
+
+static inline uint8x16_t
+aesmc(uint8x16_t v)
+{
+	__asm(".arch_extension aes\n"
+	    "aesmc %0.16b, %0.16b" : "+w"(v));
+	return (v);
+}
+
+static inline uint8_t
+rol8(uint8_t x, u_int n)
+{
+	return ((uint8_t)(x << n | x >> (8 - n)));
+}
+
+static void
+aes_sbox_init(void)
+{
+	uint8_t p, q;
+
+	/* Walk the field with the generator 3 and its inverse */
+	p = q = 1;
+	do {
+		p = p ^ (uint8_t)(p << 1) ^ (p & 0x80 ? 0x1b : 0);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		if (q & 0x80)
+			q ^= 0x09;
+		aes_sbox[p] = q ^ rol8(q, 1) ^ rol8(q, 2) ^ rol8(q, 3) ^
+		    rol8(q, 4) ^ 0x63;
+	} while (p != 1);
+	aes_sbox[0] = 0x63;
+}
+
+static void
+aes_expand_key(const uint8_t key[16], uint8x16_t rk[11])
+{
+	uint8_t w[176], t[4], rcon;
+
+	memcpy(w, key, 16);
+	rcon = 1;
+	for (u_int i = 16; i < sizeof(w); i += 4) {
+		memcpy(t, &w[i - 4], 4);
+		if (i % 16 == 0) {
+			uint8_t t0 = t[0];
+
+			t[0] = aes_sbox[t[1]] ^ rcon;
+			t[1] = aes_sbox[t[2]];
+			t[2] = aes_sbox[t[3]];
+			t[3] = aes_sbox[t0];
+			rcon = (uint8_t)(rcon << 1) ^ (rcon & 0x80 ? 0x1b : 0);
+		}
+		for (u_int j = 0; j < 4; j++)
+			w[i + j] = w[i - 16 + j] ^ t[j];
+	}
+	for (u_int i = 0; i < 11; i++)
+		rk[i] = vld1q_u8(&w[i * 16]);
+}
+
+static inline uint8x16_t
+aes_encrypt(const uint8x16_t rk[11], uint8x16_t b)
+{
+	for (u_int r = 0; r < 9; r++)
+		b = aesmc(aese(b, rk[r]));
+	return (veorq_u8(aese(b, rk[9]), rk[10]));
+}
+
+static inline void
+aes_encrypt4(const uint8x16_t rk[11], uint8x16_t b[4])
+{
+	for (u_int r = 0; r < 9; r++) {
+		b[0] = aesmc(aese(b[0], rk[r]));
+		b[1] = aesmc(aese(b[1], rk[r]));
+		b[2] = aesmc(aese(b[2], rk[r]));
+		b[3] = aesmc(aese(b[3], rk[r]));
+	}
+	for (u_int i = 0; i < 4; i++)
+		b[i] = veorq_u8(aese(b[i], rk[9]), rk[10]);
+}
+
+/* Encrypt len bytes, a multiple of 16, in ECB mode */
+static void
+aes_ecb(const uint8x16_t rk[11], const uint8_t *in, uint8_t *out,
+    size_t len)
+{
+	uint8x16_t b[4];
+
+	for (; len >= 64; len -= 64, in += 64, out += 64) {
+		for (u_int i = 0; i < 4; i++)
+			b[i] = vld1q_u8(in + i * 16);
+		aes_encrypt4(rk, b);
+		for (u_int i = 0; i < 4; i++)
+			vst1q_u8(out + i * 16, b[i]);
+	}
+	for (; len >= 16; len -= 16, in += 16, out += 16)
+		vst1q_u8(out, aes_encrypt(rk, vld1q_u8(in)));
+}
+
+static size_t
+crypto_run_aes(const uint8_t *in, uint8_t *out, size_t len)
+{
+	aes_ecb(aes_rk, in, out, len);
+	return (len);
+}
+
+static bool
+crypto_check_aes(void)
+{
+	/* FIPS-197 appendix C.1 */
+	const uint8_t key[16] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	};
+	const uint8_t pt[16] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+	};
+	const uint8_t ct[16] = {
+		0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+		0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+	};
+	uint8x16_t rk[11];
+	uint8_t in[64], out[64];
+
+	aes_expand_key(key, rk);
+	/* Check both the four block and single block paths */
+	for (u_int i = 0; i < 4; i++)
+		memcpy(&in[i * 16], pt, 16);
+	aes_ecb(rk, in, out, 64);
+	for (u_int i = 0; i < 4; i++) {
+		if (memcmp(&out[i * 16], ct, 16) != 0)
+			return (false);
+	}
+	aes_ecb(rk, pt, out, 16);
+	return (memcmp(out, ct, 16) == 0);
+}
+
+/*
+ * GHASH with PMULL. The bits of each byte are reversed so the blocks are
+ * plain polynomials over GF(2), bit n being the coefficient of x^n. Four
+ * blocks are multiplied by H^4..H and summed before a single reduction.
+ */
+struct ghash_acc {
+	uint64x2_t	lo;
+	uint64x2_t	mid;
+	uint64x2_t	hi;
+};
+
+static inline uint64x2_t
+pmull_lo(uint64x2_t a, uint64x2_t b)
+{
+	uint64x2_t r;
+
+	__asm(".arch_extension aes\n"
+	    "pmull %0.1q, %1.1d, %2.1d" : "=w"(r) : "w"(a), "w"(b));
+	return (r);
+}
+
+static inline uint64x2_t
+pmull_hi(uint64x2_t a, uint64x2_t b)
+{
+	uint64x2_t r;
+
+	__asm(".arch_extension aes\n"
+	    "pmull2 %0.1q, %1.2d, %2.2d" : "=w"(r) : "w"(a), "w"(b));
+	return (r);
+}
+
+static inline uint64x2_t
+ghash_load(const uint8_t *p)
+{
+	return (vreinterpretq_u64_u8(vrbitq_u8(vld1q_u8(p))));
+}
+
+/* Add the 256 bit product of a and b to acc */
+static inline void
+ghash_mul_acc(struct ghash_acc *acc, uint64x2_t a, uint64x2_t b)
+{
+	uint64x2_t bs;
+
+	bs = vextq_u64(b, b, 1);
+	acc->lo = veorq_u64(acc->lo, pmull_lo(a, b));
+	acc->hi = veorq_u64(acc->hi, pmull_hi(a, b));
+	acc->mid = veorq_u64(acc->mid,
+	    veorq_u64(pmull_lo(a, bs), pmull_hi(a, bs)));
+}
+
+/* Reduce modulo x^128 + x^7 + x^2 + x + 1 */
+static inline uint64x2_t
+ghash_reduce(const struct ghash_acc *acc)
+{
+	const uint64x2_t poly = vdupq_n_u64(0x87);
+	const uint64x2_t zero = vdupq_n_u64(0);
+	uint64x2_t hi, lo, t;
+
+	lo = veorq_u64(acc->lo, vextq_u64(zero, acc->mid, 1));
+	hi = veorq_u64(acc->hi, vextq_u64(acc->mid, zero, 1));
+	/* Fold x^192 and up down to x^64, then x^128 and up down to x^0 */
+	t = pmull_hi(hi, poly);
+	lo = veorq_u64(lo, vextq_u64(zero, t, 1));
+	hi = veorq_u64(hi, vextq_u64(t, zero, 1));
+	t = pmull_lo(hi, poly);
+	return (veorq_u64(lo, t));
+}
+
+static inline uint64x2_t
+ghash_mul(uint64x2_t a, uint64x2_t b)
+{
+	struct ghash_acc acc;
+
+	acc.lo = acc.mid = acc.hi = vdupq_n_u64(0);
+	ghash_mul_acc(&acc, a, b);
+	return (ghash_reduce(&acc));
+}
+
+/* hp[i] is H^(i + 1) */
+static void
+ghash_init(uint64x2_t hp[4], uint8x16_t h)
+{
+	hp[0] = vreinterpretq_u64_u8(vrbitq_u8(h));
+	for (u_int i = 1; i < 4; i++)
+		hp[i] = ghash_mul(hp[i - 1], hp[0]);
+}
+
+static uint64x2_t
+ghash_update(uint64x2_t y, const uint64x2_t hp[4], const uint8_t *p,
+    size_t nblocks)
+{
+	struct ghash_acc acc;
+
+	for (; nblocks >= 4; nblocks -= 4, p += 64) {
+		acc.lo = acc.mid = acc.hi = vdupq_n_u64(0);
+		ghash_mul_acc(&acc, veorq_u64(y, ghash_load(p)), hp[3]);
+		ghash_mul_acc(&acc, ghash_load(p + 16), hp[2]);
+		ghash_mul_acc(&acc, ghash_load(p + 32), hp[1]);
+		ghash_mul_acc(&acc, ghash_load(p + 48), hp[0]);
+		y = ghash_reduce(&acc);
+	}
+	for (; nblocks > 0; nblocks--, p += 16)
+		y = ghash_mul(veorq_u64(y, ghash_load(p)), hp[0]);
+	return (y);
+}
+
+static void
+ghash_store(uint8_t *p, uint64x2_t y)
+{
+	vst1q_u8(p, vrbitq_u8(vreinterpretq_u8_u64(y)));
+}
+
+static uint64x2_t ghash_y, ghash_hp[4];
+
+static size_t
+crypto_run_ghash(const uint8_t *in, uint8_t *out, size_t len)
+{
+	ghash_y = ghash_update(ghash_y, ghash_hp, in, len / 16);
+	return (len & ~(size_t)15);
+}
+
+static bool
+crypto_check_ghash(void)
+{
+	/* From test case 2 of the GCM specification */
+	const uint8_t h[16] = {
+		0x66, 0xe9, 0x4b, 0xd4, 0xef, 0x8a, 0x2c, 0x3b,
+		0x88, 0x4c, 0xfa, 0x59, 0xca, 0x34, 0x2b, 0x2e,
+	};
+	const uint8_t msg[32] = {
+		0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92,
+		0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x80,
+	};
+	const uint8_t hash[16] = {
+		0xf3, 0x8c, 0xbb, 0x1a, 0xd6, 0x92, 0x23, 0xdc,
+		0xc3, 0x45, 0x7a, 0xe5, 0xb6, 0xb0, 0xf8, 0x85,
+	};
+	uint64x2_t hp[4], y1, y4;
+	uint8_t data[128], out[16];
+
+	ghash_init(hp, vld1q_u8(h));
+	ghash_store(out, ghash_update(vdupq_n_u64(0), hp, msg, 2));
+	if (memcmp(out, hash, sizeof(hash)) != 0)
+		return (false);
+
+	/* The four block path must match one block at a time */
+	for (u_int i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t)(i * 37 + 11);
+	y4 = ghash_update(vdupq_n_u64(0), hp, data, 8);
+	y1 = vdupq_n_u64(0);
+	for (u_int i = 0; i < 8; i++)
+		y1 = ghash_update(y1, hp, data + i * 16, 1);
+	return (vgetq_lane_u64(y1, 0) == vgetq_lane_u64(y4, 0) &&
+	    vgetq_lane_u64(y1, 1) == vgetq_lane_u64(y4, 1));
+}
+
+/*
+ * AES-128-GCM encryption, CTR mode with GHASH over the ciphertext.
+ */
+struct gcm {
+	uint8x16_t	rk[11];
+	uint64x2_t	hp[4];
+	uint8x16_t	j0;
+	uint32x4_t	ctr;		/* The counter block as words */
+	uint64x2_t	y;
+};
+
+static struct gcm crypto_gcm;
+
+static void
+gcm_init(struct gcm *g, const uint8_t key[16], const uint8_t iv[12])
+{
+	uint8_t j0[16];
+
+	aes_expand_key(key, g->rk);
+	ghash_init(g->hp, aes_encrypt(g->rk, vdupq_n_u8(0)));
+	memcpy(j0, iv, 12);
+	j0[12] = j0[13] = j0[14] = 0;
+	j0[15] = 1;
+	g->j0 = vld1q_u8(j0);
+	g->ctr = vreinterpretq_u32_u8(vrev32q_u8(g->j0));
+	g->y = vdupq_n_u64(0);
+}
+
+/* Increment the last 32 bit big endian word of the counter block */
+static inline uint8x16_t
+gcm_counter(struct gcm *g)
+{
+	g->ctr = vaddq_u32(g->ctr, vsetq_lane_u32(1, vdupq_n_u32(0), 3));
+	return (vrev32q_u8(vreinterpretq_u8_u32(g->ctr)));
+}
+
+/* Encrypt len bytes, a multiple of 16 */
+static void
+gcm_encrypt(struct gcm *g, const uint8_t *in, uint8_t *out, size_t len)
+{
+	uint8x16_t b[4];
+
+	for (; len >= 64; len -= 64, in += 64, out += 64) {
+		for (u_int i = 0; i < 4; i++)
+			b[i] = gcm_counter(g);
+		aes_encrypt4(g->rk, b);
+		for (u_int i = 0; i < 4; i++)
+			vst1q_u8(out + i * 16,
+			    veorq_u8(b[i], vld1q_u8(in + i * 16)));
+		g->y = ghash_update(g->y, g->hp, out, 4);
+	}
+	for (; len >= 16; len -= 16, in += 16, out += 16) {
+		vst1q_u8(out, veorq_u8(aes_encrypt(g->rk, gcm_counter(g)),
+		    vld1q_u8(in)));
+		g->y = ghash_update(g->y, g->hp, out, 1);
+	}
+}
+
+/* The tag for clen bytes of ciphertext and no additional data */
+static void
+gcm_tag(struct gcm *g, uint64_t clen, uint8_t tag[16])
+{
+	uint8_t lens[16];
+
+	memset(lens, 0, sizeof(lens));
+	clen *= 8;
+	for (u_int i = 0; i < 8; i++)
+		lens[15 - i] = (uint8_t)(clen >> (i * 8));
+	g->y = ghash_update(g->y, g->hp, lens, 1);
+	ghash_store(tag, g->y);
+	vst1q_u8(tag, veorq_u8(vld1q_u8(tag), aes_encrypt(g->rk, g->j0)));
+}
+
+static size_t
+crypto_run_gcm(const uint8_t *in, uint8_t *out, size_t len)
+{
+	gcm_encrypt(&crypto_gcm, in, out, len & ~(size_t)15);
+	return (len & ~(size_t)15);
+}
+
+static bool
+crypto_check_gcm(void)
+{
+	/* Test case 2 of the GCM specification, all zero key, IV and data */
+	const uint8_t ct[16] = {
+		0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92,
+		0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78,
+	};
+	const uint8_t tag[16] = {
+		0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd,
+		0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf,
+	};
+	uint8_t zero[16], out[16], t[16];
+	struct gcm g;
+
+	memset(zero, 0, sizeof(zero));
+	gcm_init(&g, zero, zero);
+	gcm_encrypt(&g, zero, out, 16);
+	gcm_tag(&g, 16, t);
+	return (memcmp(out, ct, 16) == 0 && memcmp(t, tag, 16) == 0);
+}
+
+/*
+ * SHA-1, SHA-256 and SHA-512 block functions. Each round group uses the
+ * hash instructions and the message schedule is updated in place.
+ */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t sha512_k[80] = {
+	0x428a2f98d728ae22, 0x7137449123ef65cd,
+	0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+	0x3956c25bf348b538, 0x59f111f1b605d019,
+	0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+	0xd807aa98a3030242, 0x12835b0145706fbe,
+	0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+	0x72be5d74f27b896f, 0x80deb1fe3b1696b1,
+	0x9bdc06a725c71235, 0xc19bf174cf692694,
+	0xe49b69c19ef14ad2, 0xefbe4786384f25e3,
+	0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+	0x2de92c6f592b0275, 0x4a7484aa6ea6e483,
+	0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+	0x983e5152ee66dfab, 0xa831c66d2db43210,
+	0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+	0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+	0x06ca6351e003826f, 0x142929670a0e6e70,
+	0x27b70a8546d22ffc, 0x2e1b21385c26c926,
+	0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+	0x650a73548baf63de, 0x766a0abb3c77b2a8,
+	0x81c2c92e47edaee6, 0x92722c851482353b,
+	0xa2bfe8a14cf10364, 0xa81a664bbc423001,
+	0xc24b8b70d0f89791, 0xc76c51a30654be30,
+	0xd192e819d6ef5218, 0xd69906245565a910,
+	0xf40e35855771202a, 0x106aa07032bbd1b8,
+	0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+	0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+	0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb,
+	0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+	0x748f82ee5defb2fc, 0x78a5636f43172f60,
+	0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+	0x90befffa23631e28, 0xa4506cebde82bde9,
+	0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+	0xca273eceea26619c, 0xd186b8c721c0c207,
+	0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+	0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+	0x113f9804bef90dae, 0x1b710b35131c471b,
+	0x28db77f523047d84, 0x32caab7b40c72493,
+	0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+	0x4cc5d4becb3e42b6, 0x597f299cfc657e2a,
+	0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+static inline uint32x4_t
+sha1c(uint32x4_t abcd, uint32_t e, uint32x4_t wk)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha1c %q0, %s1, %2.4s" : "+w"(abcd) : "w"(e), "w"(wk));
+	return (abcd);
+}
+
+static inline uint32x4_t
+sha1p(uint32x4_t abcd, uint32_t e, uint32x4_t wk)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha1p %q0, %s1, %2.4s" : "+w"(abcd) : "w"(e), "w"(wk));
+	return (abcd);
+}
+
+static inline uint32x4_t
+sha1m(uint32x4_t abcd, uint32_t e, uint32x4_t wk)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha1m %q0, %s1, %2.4s" : "+w"(abcd) : "w"(e), "w"(wk));
+	return (abcd);
+}
+
+static inline uint32_t
+sha1h(uint32_t e)
+{
+	uint32_t r;
+
+	__asm(".arch_extension sha2\n"
+	    "sha1h %s0, %s1" : "=w"(r) : "w"(e));
+	return (r);
+}
+
+static inline uint32x4_t
+sha1su0(uint32x4_t w0, uint32x4_t w1, uint32x4_t w2)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha1su0 %0.4s, %1.4s, %2.4s" : "+w"(w0) : "w"(w1), "w"(w2));
+	return (w0);
+}
+
+static inline uint32x4_t
+sha1su1(uint32x4_t w0, uint32x4_t w3)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha1su1 %0.4s, %1.4s" : "+w"(w0) : "w"(w3));
+	return (w0);
+}
+
+static inline uint32x4_t
+sha256h(uint32x4_t abcd, uint32x4_t efgh, uint32x4_t wk)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha256h %q0, %q1, %2.4s" : "+w"(abcd) : "w"(efgh), "w"(wk));
+	return (abcd);
+}
+
+static inline uint32x4_t
+sha256h2(uint32x4_t efgh, uint32x4_t abcd, uint32x4_t wk)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha256h2 %q0, %q1, %2.4s" : "+w"(efgh) : "w"(abcd), "w"(wk));
+	return (efgh);
+}
+
+static inline uint32x4_t
+sha256su0(uint32x4_t w0, uint32x4_t w1)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha256su0 %0.4s, %1.4s" : "+w"(w0) : "w"(w1));
+	return (w0);
+}
+
+static inline uint32x4_t
+sha256su1(uint32x4_t w0, uint32x4_t w2, uint32x4_t w3)
+{
+	__asm(".arch_extension sha2\n"
+	    "sha256su1 %0.4s, %1.4s, %2.4s" : "+w"(w0) : "w"(w2), "w"(w3));
+	return (w0);
+}
+
+static inline uint64x2_t
+sha512h(uint64x2_t d, uint64x2_t n, uint64x2_t m)
+{
+	__asm(".arch_extension sha3\n"
+	    "sha512h %q0, %q1, %2.2d" : "+w"(d) : "w"(n), "w"(m));
+	return (d);
+}
+
+static inline uint64x2_t
+sha512h2(uint64x2_t d, uint64x2_t n, uint64x2_t m)
+{
+	__asm(".arch_extension sha3\n"
+	    "sha512h2 %q0, %q1, %2.2d" : "+w"(d) : "w"(n), "w"(m));
+	return (d);
+}
+
+static inline uint64x2_t
+sha512su0(uint64x2_t w0, uint64x2_t w1)
+{
+	__asm(".arch_extension sha3\n"
+	    "sha512su0 %0.2d, %1.2d" : "+w"(w0) : "w"(w1));
+	return (w0);
+}
+
+static inline uint64x2_t
+sha512su1(uint64x2_t w0, uint64x2_t w7, uint64x2_t w45)
+{
+	__asm(".arch_extension sha3\n"
+	    "sha512su1 %0.2d, %1.2d, %2.2d" : "+w"(w0) : "w"(w7), "w"(w45));
+	return (w0);
+}
+
+static inline uint32x4_t
+load_be32(const uint8_t *p)
+{
+	return (vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p))));
+}
+
+static void
+sha1_blocks(uint32_t state[5], const uint8_t *p, size_t nblocks)
+{
+	static const uint32_t k[4] = {
+		0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+	};
+	uint32x4_t abcd, abcd0, w[4], w0, wk;
+	uint32_t e, e0, e1;
+
+	abcd = vld1q_u32(state);
+	e = state[4];
+	for (; nblocks > 0; nblocks--, p += 64) {
+		abcd0 = abcd;
+		e0 = e;
+		for (u_int i = 0; i < 4; i++)
+			w[i] = load_be32(p + i * 16);
+		/* 20 groups of four rounds */
+#pragma GCC unroll 20
+		for (u_int r = 0; r < 20; r++) {
+			wk = vaddq_u32(w[r % 4], vdupq_n_u32(k[r / 5]));
+			e1 = sha1h(vgetq_lane_u32(abcd, 0));
+			if (r < 5)
+				abcd = sha1c(abcd, e, wk);
+			else if (r >= 10 && r < 15)
+				abcd = sha1m(abcd, e, wk);
+			else
+				abcd = sha1p(abcd, e, wk);
+			e = e1;
+			if (r < 16) {
+				w0 = sha1su0(w[r % 4], w[(r + 1) % 4],
+				    w[(r + 2) % 4]);
+				w[r % 4] = sha1su1(w0, w[(r + 3) % 4]);
+			}
+		}
+		abcd = vaddq_u32(abcd, abcd0);
+		e += e0;
+	}
+	vst1q_u32(state, abcd);
+	state[4] = e;
+}
+
+static void
+sha256_blocks(uint32_t state[8], const uint8_t *p, size_t nblocks)
+{
+	uint32x4_t abcd, abcd0, efgh, efgh0, t, w[4], w0, wk;
+
+	abcd = vld1q_u32(state);
+	efgh = vld1q_u32(state + 4);
+	for (; nblocks > 0; nblocks--, p += 64) {
+		abcd0 = abcd;
+		efgh0 = efgh;
+		for (u_int i = 0; i < 4; i++)
+			w[i] = load_be32(p + i * 16);
+		/* 16 groups of four rounds */
+#pragma GCC unroll 16
+		for (u_int r = 0; r < 16; r++) {
+			wk = vaddq_u32(w[r % 4], vld1q_u32(&sha256_k[r * 4]));
+			if (r < 12) {
+				w0 = sha256su0(w[r % 4], w[(r + 1) % 4]);
+				w[r % 4] = sha256su1(w0, w[(r + 2) % 4],
+				    w[(r + 3) % 4]);
+			}
+			t = abcd;
+			abcd = sha256h(abcd, efgh, wk);
+			efgh = sha256h2(efgh, t, wk);
+		}
+		abcd = vaddq_u32(abcd, abcd0);
+		efgh = vaddq_u32(efgh, efgh0);
+	}
+	vst1q_u32(state, abcd);
+	vst1q_u32(state + 4, efgh);
+}
+
+/*
+ * Two rounds of SHA-512. The state is in four of the five registers in s
+ * as ab, cd, ef and gh, which register holds which rotates each call as
+ * given by sha512_order.
+ */
+static inline void
+sha512_dround(uint64x2_t s[5], const u_int o[5], uint64x2_t k,
+    uint64x2_t w[8], u_int j, bool update)
+{
+	uint64x2_t a, b, c, t;
+
+	t = vaddq_u64(k, w[j]);
+	a = vextq_u64(s[o[2]], s[o[3]], 1);
+	t = vextq_u64(t, t, 1);
+	b = vextq_u64(s[o[1]], s[o[2]], 1);
+	s[o[3]] = vaddq_u64(s[o[3]], t);
+	if (update) {
+		c = vextq_u64(w[(j + 4) % 8], w[(j + 5) % 8], 1);
+		w[j] = sha512su0(w[j], w[(j + 1) % 8]);
+		w[j] = sha512su1(w[j], w[(j + 7) % 8], c);
+	}
+	s[o[3]] = sha512h(s[o[3]], a, b);
+	s[o[4]] = vaddq_u64(s[o[1]], s[o[3]]);
+	s[o[3]] = sha512h2(s[o[3]], s[o[1]], s[o[0]]);
+}
+
+static const u_int sha512_order[5][5] = {
+	{ 0, 1, 2, 3, 4 },
+	{ 3, 0, 4, 2, 1 },
+	{ 2, 3, 1, 4, 0 },
+	{ 4, 2, 0, 1, 3 },
+	{ 1, 4, 3, 0, 2 },
+};
+
+static void
+sha512_blocks(uint64_t state[8], const uint8_t *p, size_t nblocks)
+{
+	uint64x2_t s[5], s0[4], w[8];
+
+	for (u_int i = 0; i < 4; i++)
+		s[i] = vld1q_u64(state + i * 2);
+	for (; nblocks > 0; nblocks--, p += 128) {
+		for (u_int i = 0; i < 4; i++)
+			s0[i] = s[i];
+		for (u_int i = 0; i < 8; i++)
+			w[i] = vreinterpretq_u64_u8(vrev64q_u8(
+			    vld1q_u8(p + i * 16)));
+		/* After each five calls the state is back in s[0..3] */
+#pragma GCC unroll 40
+		for (u_int r = 0; r < 40; r++)
+			sha512_dround(s, sha512_order[r % 5],
+			    vld1q_u64(&sha512_k[r * 2]), w, r % 8, r < 32);
+		for (u_int i = 0; i < 4; i++)
+			s[i] = vaddq_u64(s[i], s0[i]);
+	}
+	for (u_int i = 0; i < 4; i++)
+		vst1q_u64(state + i * 2, s[i]);
+}
+
+static const uint32_t sha1_iv[5] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static const uint32_t sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint64_t sha512_iv[8] = {
+	0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
+	0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+	0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+	0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+};
+
+static uint32_t crypto_sha1[5], crypto_sha256[8];
+static uint64_t crypto_sha512[8];
+
+static size_t
+crypto_run_sha1(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha1_blocks(crypto_sha1, in, len / 64);
+	return (len & ~(size_t)63);
+}
+
+static size_t
+crypto_run_sha256(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha256_blocks(crypto_sha256, in, len / 64);
+	return (len & ~(size_t)63);
+}
+
+static size_t
+crypto_run_sha512(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha512_blocks(crypto_sha512, in, len / 128);
+	return (len & ~(size_t)127);
+}
+
+/* Pad "abc" to a single block of size bytes with the length at the end */
+static void
+crypto_abc_block(uint8_t *block, size_t size)
+{
+	memset(block, 0, size);
+	memcpy(block, "abc", 3);
+	block[3] = 0x80;
+	block[size - 1] = 24;
+}
+
+static bool
+crypto_check_sha1(void)
+{
+	static const uint32_t hash[5] = {
+		0xa9993e36, 0x4706816a, 0xba3e2571, 0x7850c26c, 0x9cd0d89d,
+	};
+	uint8_t block[64];
+	uint32_t st[5];
+
+	crypto_abc_block(block, sizeof(block));
+	memcpy(st, sha1_iv, sizeof(st));
+	sha1_blocks(st, block, 1);
+	return (memcmp(st, hash, sizeof(hash)) == 0);
+}
+
+static bool
+crypto_check_sha256(void)
+{
+	static const uint32_t hash[8] = {
+		0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223,
+		0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad,
+	};
+	uint8_t block[64];
+	uint32_t st[8];
+
+	crypto_abc_block(block, sizeof(block));
+	memcpy(st, sha256_iv, sizeof(st));
+	sha256_blocks(st, block, 1);
+	return (memcmp(st, hash, sizeof(hash)) == 0);
+}
+
+static bool
+crypto_check_sha512(void)
+{
+	static const uint64_t hash[8] = {
+		0xddaf35a193617aba, 0xcc417349ae204131,
+		0x12e6fa4e89a97ea2, 0x0a9eeee64b55d39a,
+		0x2192992a274fc1a8, 0x36ba3c23a3feebbd,
+		0x454d4423643ce80e, 0x2a9ac94fa54ca49f,
+	};
+	uint8_t block[128];
+	uint64_t st[8];
+
+	crypto_abc_block(block, sizeof(block));
+	memcpy(st, sha512_iv, sizeof(st));
+	sha512_blocks(st, block, 1);
+	return (memcmp(st, hash, sizeof(hash)) == 0);
+}
+
+/*
+ * SHA3-256 with EOR3, RAX1, XAR and BCAX. Each lane of the state is in
+ * the low half of a vector register.
+ */
+static const uint64_t keccak_rc[24] = {
+	0x0000000000000001, 0x0000000000008082,
+	0x800000000000808a, 0x8000000080008000,
+	0x000000000000808b, 0x0000000080000001,
+	0x8000000080008081, 0x8000000000008009,
+	0x000000000000008a, 0x0000000000000088,
+	0x0000000080008009, 0x000000008000000a,
+	0x000000008000808b, 0x800000000000008b,
+	0x8000000000008089, 0x8000000000008003,
+	0x8000000000008002, 0x8000000000000080,
+	0x000000000000800a, 0x800000008000000a,
+	0x8000000080008081, 0x8000000000008080,
+	0x0000000080000001, 0x8000000080008008,
+};
+
+static inline uint64x2_t
+eor3(uint64x2_t a, uint64x2_t b, uint64x2_t c)
+{
+	uint64x2_t r;
+
+	__asm(".arch_extension sha3\n"
+	    "eor3 %0.16b, %1.16b, %2.16b, %3.16b"
+	    : "=w"(r) : "w"(a), "w"(b), "w"(c));
+	return (r);
+}
+
+/* a ^ rol(b, 1) */
+static inline uint64x2_t
+rax1(uint64x2_t a, uint64x2_t b)
+{
+	uint64x2_t r;
+
+	__asm(".arch_extension sha3\n"
+	    "rax1 %0.2d, %1.2d, %2.2d" : "=w"(r) : "w"(a), "w"(b));
+	return (r);
+}
+
+/* a ^ (b & ~c) */
+static inline uint64x2_t
+bcax(uint64x2_t a, uint64x2_t b, uint64x2_t c)
+{
+	uint64x2_t r;
+
+	__asm(".arch_extension sha3\n"
+	    "bcax %0.16b, %1.16b, %2.16b, %3.16b"
+	    : "=w"(r) : "w"(a), "w"(b), "w"(c));
+	return (r);
+}
+
+/* d = ror(a ^ b, imm), the rotate has to be a constant */
+#define	KECCAK_XAR(d, a, b, imm)					\
+	__asm(".arch_extension sha3\n"					\
+	    "xar %0.2d, %1.2d, %2.2d, #" #imm				\
+	    : "=w"(d) : "w"(a), "w"(b))
+
+static void
+keccak_f1600(uint64x2_t st[25])
+{
+	uint64x2_t b[25], c[5], d[5];
+
+	for (u_int r = 0; r < 24; r++) {
+		/* Theta */
+		for (u_int x = 0; x < 5; x++)
+			c[x] = eor3(eor3(st[x], st[x + 5], st[x + 10]),
+			    st[x + 15], st[x + 20]);
+		for (u_int x = 0; x < 5; x++)
+			d[x] = rax1(c[(x + 4) % 5], c[(x + 1) % 5]);
+		/* Theta is finished while doing rho and pi */
+		b[0] = veorq_u64(st[0], d[0]);
+		KECCAK_XAR(b[10], st[1], d[1], 63);
+		KECCAK_XAR(b[20], st[2], d[2], 2);
+		KECCAK_XAR(b[5], st[3], d[3], 36);
+		KECCAK_XAR(b[15], st[4], d[4], 37);
+		KECCAK_XAR(b[16], st[5], d[0], 28);
+		KECCAK_XAR(b[1], st[6], d[1], 20);
+		KECCAK_XAR(b[11], st[7], d[2], 58);
+		KECCAK_XAR(b[21], st[8], d[3], 9);
+		KECCAK_XAR(b[6], st[9], d[4], 44);
+		KECCAK_XAR(b[7], st[10], d[0], 61);
+		KECCAK_XAR(b[17], st[11], d[1], 54);
+		KECCAK_XAR(b[2], st[12], d[2], 21);
+		KECCAK_XAR(b[12], st[13], d[3], 39);
+		KECCAK_XAR(b[22], st[14], d[4], 25);
+		KECCAK_XAR(b[23], st[15], d[0], 23);
+		KECCAK_XAR(b[8], st[16], d[1], 19);
+		KECCAK_XAR(b[18], st[17], d[2], 49);
+		KECCAK_XAR(b[3], st[18], d[3], 43);
+		KECCAK_XAR(b[13], st[19], d[4], 56);
+		KECCAK_XAR(b[14], st[20], d[0], 46);
+		KECCAK_XAR(b[24], st[21], d[1], 62);
+		KECCAK_XAR(b[9], st[22], d[2], 3);
+		KECCAK_XAR(b[19], st[23], d[3], 8);
+		KECCAK_XAR(b[4], st[24], d[4], 50);
+		/* Chi */
+		for (u_int y = 0; y < 25; y += 5) {
+			for (u_int x = 0; x < 5; x++)
+				st[y + x] = bcax(b[y + x], b[y + (x + 2) % 5],
+				    b[y + (x + 1) % 5]);
+		}
+		/* Iota */
+		st[0] = veorq_u64(st[0], vcombine_u64(vcreate_u64(keccak_rc[r]),
+		    vcreate_u64(0)));
+	}
+}
+
+/* The SHA3-256 rate in bytes */
+#define	SHA3_256_RATE	136
+
+static void
+sha3_blocks(uint64x2_t st[25], const uint8_t *p, size_t nblocks)
+{
+	for (; nblocks > 0; nblocks--, p += SHA3_256_RATE) {
+		for (u_int i = 0; i < SHA3_256_RATE / 8; i++)
+			st[i] = veorq_u64(st[i], vcombine_u64(
+			    vreinterpret_u64_u8(vld1_u8(p + i * 8)),
+			    vcreate_u64(0)));
+		keccak_f1600(st);
+	}
+}
+
+static uint64x2_t crypto_sha3[25];
+
+static size_t
+crypto_run_sha3(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sha3_blocks(crypto_sha3, in, len / SHA3_256_RATE);
+	return (len - len % SHA3_256_RATE);
+}
+
+static bool
+crypto_check_sha3(void)
+{
+	static const uint8_t hash[32] = {
+		0x3a, 0x98, 0x5d, 0xa7, 0x4f, 0xe2, 0x25, 0xb2,
+		0x04, 0x5c, 0x17, 0x2d, 0x6b, 0xd3, 0x90, 0xbd,
+		0x85, 0x5f, 0x08, 0x6e, 0x3e, 0x9d, 0x52, 0x5b,
+		0x46, 0xbf, 0xe2, 0x45, 0x11, 0x43, 0x15, 0x32,
+	};
+	uint64x2_t st[25];
+	uint8_t block[SHA3_256_RATE], out[32];
+
+	memset(block, 0, sizeof(block));
+	memcpy(block, "abc", 3);
+	block[3] = 0x06;
+	block[sizeof(block) - 1] = 0x80;
+	for (u_int i = 0; i < nitems(st); i++)
+		st[i] = vdupq_n_u64(0);
+	sha3_blocks(st, block, 1);
+	for (u_int i = 0; i < 4; i++)
+		vst1_u8(&out[i * 8], vreinterpret_u8_u64(vget_low_u64(st[i])));
+	return (memcmp(out, hash, sizeof(hash)) == 0);
+}
+
+/*
+ * SM3 with the SM3 instructions. The state is held as DCBA and HGFE, the
+ * round constant is in the top lane of t and is rotated each round.
+ */
+#define	SM3_TT(ab, n, d, a, b, imm)					\
+	__asm(".arch_extension sm4\n"					\
+	    "sm3tt" #n #ab " %0.4s, %1.4s, %2.s[" #imm "]"		\
+	    : "+w"(d) : "w"(a), "w"(b))
+
+#define	SM3_ROUND(ab, s0, w, imm) do {					\
+	uint32x4_t ss1;							\
+									\
+	__asm(".arch_extension sm4\n"					\
+	    "sm3ss1 %0.4s, %1.4s, %2.4s, %3.4s"				\
+	    : "=w"(ss1) : "w"(abcd), "w"(t), "w"(efgh));		\
+	t = vsriq_n_u32(vshlq_n_u32(t, 1), t, 31);			\
+	SM3_TT(ab, 1, abcd, ss1, w, imm);				\
+	SM3_TT(ab, 2, efgh, ss1, s0, imm);				\
+} while (0)
+
+#define	SM3_QROUND(ab, s0, s1) do {					\
+	uint32x4_t w = veorq_u32(s0, s1);				\
+									\
+	SM3_ROUND(ab, s0, w, 0);					\
+	SM3_ROUND(ab, s0, w, 1);					\
+	SM3_ROUND(ab, s0, w, 2);					\
+	SM3_ROUND(ab, s0, w, 3);					\
+} while (0)
+
+static inline uint32x4_t
+sm3partw1(uint32x4_t d, uint32x4_t a, uint32x4_t b)
+{
+	__asm(".arch_extension sm4\n"
+	    "sm3partw1 %0.4s, %1.4s, %2.4s" : "+w"(d) : "w"(a), "w"(b));
+	return (d);
+}
+
+static inline uint32x4_t
+sm3partw2(uint32x4_t d, uint32x4_t a, uint32x4_t b)
+{
+	__asm(".arch_extension sm4\n"
+	    "sm3partw2 %0.4s, %1.4s, %2.4s" : "+w"(d) : "w"(a), "w"(b));
+	return (d);
+}
+
+static inline uint32x4_t
+sm3_swap(uint32x4_t v)
+{
+	v = vrev64q_u32(v);
+	return (vextq_u32(v, v, 2));
+}
+
+static void
+sm3_blocks(uint32_t state[8], const uint8_t *p, size_t nblocks)
+{
+	uint32x4_t abcd, abcd0, efgh, efgh0, t, s[5], v6, v7;
+
+	abcd = sm3_swap(vld1q_u32(state));
+	efgh = sm3_swap(vld1q_u32(state + 4));
+	for (; nblocks > 0; nblocks--, p += 64) {
+		abcd0 = abcd;
+		efgh0 = efgh;
+		for (u_int i = 0; i < 4; i++)
+			s[i] = load_be32(p + i * 16);
+		/* 16 groups of four rounds, the first four use T0 */
+		t = vsetq_lane_u32(0x79cc4519, vdupq_n_u32(0), 3);
+#pragma GCC unroll 16
+		for (u_int q = 0; q < 16; q++) {
+			uint32x4_t *s0 = &s[q % 5], *s1 = &s[(q + 1) % 5];
+			uint32x4_t *s2 = &s[(q + 2) % 5], *s3 = &s[(q + 3) % 5];
+			uint32x4_t *s4 = &s[(q + 4) % 5];
+
+			/* Expand the next four words of the schedule */
+			if (q < 13) {
+				*s4 = vextq_u32(*s1, *s2, 3);
+				v6 = vextq_u32(*s0, *s1, 3);
+				v7 = vextq_u32(*s2, *s3, 2);
+				*s4 = sm3partw1(*s4, *s0, *s3);
+			}
+			if (q == 4)
+				t = vsetq_lane_u32(0x9d8a7a87, vdupq_n_u32(0),
+				    3);
+			if (q < 4)
+				SM3_QROUND(a, *s0, *s1);
+			else
+				SM3_QROUND(b, *s0, *s1);
+			if (q < 13)
+				*s4 = sm3partw2(*s4, v7, v6);
+		}
+		abcd = veorq_u32(abcd, abcd0);
+		efgh = veorq_u32(efgh, efgh0);
+	}
+	vst1q_u32(state, sm3_swap(abcd));
+	vst1q_u32(state + 4, sm3_swap(efgh));
+}
+
+static const uint32_t sm3_iv[8] = {
+	0x7380166f, 0x4914b2b9, 0x172442d7, 0xda8a0600,
+	0xa96f30bc, 0x163138aa, 0xe38dee4d, 0xb0fb0e4e,
+};
+
+static uint32_t crypto_sm3[8];
+
+static size_t
+crypto_run_sm3(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sm3_blocks(crypto_sm3, in, len / 64);
+	return (len & ~(size_t)63);
+}
+
+static bool
+crypto_check_sm3(void)
+{
+	static const uint32_t hash[8] = {
+		0x66c7f0f4, 0x62eeedd9, 0xd1f2d46b, 0xdc10e4e2,
+		0x4167c487, 0x5cf2f7a2, 0x297da02b, 0x8f4ba8e0,
+	};
+	uint8_t block[64];
+	uint32_t st[8];
+
+	crypto_abc_block(block, sizeof(block));
+	memcpy(st, sm3_iv, sizeof(st));
+	sm3_blocks(st, block, 1);
+	return (memcmp(st, hash, sizeof(hash)) == 0);
+}
+
+/*
+ * SM4 in ECB mode with SM4E, four blocks are in flight at a time.
+ */
+static uint32x4_t sm4_rk[8];
+
+static inline uint32x4_t
+sm4ekey(uint32x4_t k, uint32x4_t ck)
+{
+	uint32x4_t r;
+
+	__asm(".arch_extension sm4\n"
+	    "sm4ekey %0.4s, %1.4s, %2.4s" : "=w"(r) : "w"(k), "w"(ck));
+	return (r);
+}
+
+static inline uint32x4_t
+sm4e(uint32x4_t b, uint32x4_t rk)
+{
+	__asm(".arch_extension sm4\n"
+	    "sm4e %0.4s, %1.4s" : "+w"(b) : "w"(rk));
+	return (b);
+}
+
+static void
+sm4_expand_key(const uint8_t key[16], uint32x4_t rk[8])
+{
+	static const uint32_t fk[4] = {
+		0xa3b1bac6, 0x56aa3350, 0x677d9197, 0xb27022dc,
+	};
+	uint32_t ck[32];
+	uint32x4_t k;
+
+	/* CK[i] byte j is (4i + j) * 7 */
+	for (u_int i = 0; i < nitems(ck); i++) {
+		ck[i] = 0;
+		for (u_int j = 0; j < 4; j++)
+			ck[i] = ck[i] << 8 | (((4 * i + j) * 7) & 0xff);
+	}
+	k = veorq_u32(load_be32(key), vld1q_u32(fk));
+	for (u_int i = 0; i < 8; i++) {
+		k = sm4ekey(k, vld1q_u32(&ck[i * 4]));
+		rk[i] = k;
+	}
+}
+
+static inline uint8x16_t
+sm4_encrypt(const uint32x4_t rk[8], uint8x16_t in)
+{
+	uint32x4_t b;
+
+	b = vreinterpretq_u32_u8(vrev32q_u8(in));
+	for (u_int r = 0; r < 8; r++)
+		b = sm4e(b, rk[r]);
+	/* The output is the last four words in reverse order */
+	b = vrev64q_u32(b);
+	b = vextq_u32(b, b, 2);
+	return (vrev32q_u8(vreinterpretq_u8_u32(b)));
+}
+
+static void
+sm4_ecb(const uint32x4_t rk[8], const uint8_t *in, uint8_t *out,
+    size_t len)
+{
+	uint32x4_t b[4];
+
+	for (; len >= 64; len -= 64, in += 64, out += 64) {
+		for (u_int i = 0; i < 4; i++)
+			b[i] = load_be32(in + i * 16);
+		for (u_int r = 0; r < 8; r++) {
+			b[0] = sm4e(b[0], rk[r]);
+			b[1] = sm4e(b[1], rk[r]);
+			b[2] = sm4e(b[2], rk[r]);
+			b[3] = sm4e(b[3], rk[r]);
+		}
+		for (u_int i = 0; i < 4; i++) {
+			b[i] = vrev64q_u32(b[i]);
+			b[i] = vextq_u32(b[i], b[i], 2);
+			vst1q_u8(out + i * 16,
+			    vrev32q_u8(vreinterpretq_u8_u32(b[i])));
+		}
+	}
+	for (; len >= 16; len -= 16, in += 16, out += 16)
+		vst1q_u8(out, sm4_encrypt(rk, vld1q_u8(in)));
+}
+
+static size_t
+crypto_run_sm4(const uint8_t *in, uint8_t *out, size_t len)
+{
+	sm4_ecb(sm4_rk, in, out, len);
+	return (len);
+}
+
+static bool
+crypto_check_sm4(void)
+{
+	/* GB/T 32907-2016 appendix A.1, the key is also the plaintext */
+	static const uint8_t key[16] = {
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10,
+	};
+	static const uint8_t ct[16] = {
+		0x68, 0x1e, 0xdf, 0x34, 0xd2, 0x06, 0x96, 0x5e,
+		0x86, 0xb3, 0xe9, 0x4f, 0x53, 0x6e, 0x42, 0x46,
+	};
+	uint32x4_t rk[8];
+	uint8_t in[64], out[64];
+
+	sm4_expand_key(key, rk);
+	for (u_int i = 0; i < 4; i++)
+		memcpy(&in[i * 16], key, 16);
+	sm4_ecb(rk, in, out, 64);
+	for (u_int i = 0; i < 4; i++) {
+		if (memcmp(&out[i * 16], ct, 16) != 0)
+			return (false);
+	}
+	sm4_ecb(rk, key, out, 16);
+	return (memcmp(out, ct, 16) == 0);
+}
+
+/*
+ * AES in ECB mode with the SVE2 AES instructions, four vectors are in
+ * flight at a time. The round keys are replicated to every 128-bit
+ * segment so each segment is an independent block. This uses the same
+ * round keys as the Advanced SIMD kernel so the output can be compared.
+ */
+static u_int
+sve_vl(void)
+{
+	uint64_t vl;
+
+	__asm __volatile(".arch_extension sve\n"
+	    "rdvl %0, #1" : "=r"(vl));
+	return ((u_int)vl);
+}
+
+static size_t
+sve_aes_ecb(const uint8x16_t rk[11], const uint8_t *in, uint8_t *out,
+    size_t len)
+{
+	uint64_t n;
+	const uint8x16_t *rk2;
+
+	/* Four vectors per iteration */
+	n = len / (4 * sve_vl());
+	if (n == 0)
+		return (0);
+	/* LD1RQB offsets only reach 112 bytes */
+	rk2 = &rk[8];
+	__asm __volatile(
+	    ".arch_extension sve\n"
+	    ".arch_extension sve2-aes\n"
+	    "ptrue	p0.b\n"
+	    "ld1rqb	{z16.b}, p0/z, [%[rk], #0]\n"
+	    "ld1rqb	{z17.b}, p0/z, [%[rk], #16]\n"
+	    "ld1rqb	{z18.b}, p0/z, [%[rk], #32]\n"
+	    "ld1rqb	{z19.b}, p0/z, [%[rk], #48]\n"
+	    "ld1rqb	{z20.b}, p0/z, [%[rk], #64]\n"
+	    "ld1rqb	{z21.b}, p0/z, [%[rk], #80]\n"
+	    "ld1rqb	{z22.b}, p0/z, [%[rk], #96]\n"
+	    "ld1rqb	{z23.b}, p0/z, [%[rk], #112]\n"
+	    "ld1rqb	{z24.b}, p0/z, [%[rk2], #0]\n"
+	    "ld1rqb	{z25.b}, p0/z, [%[rk2], #16]\n"
+	    "ld1rqb	{z26.b}, p0/z, [%[rk2], #32]\n"
+	    "1:\n"
+	    "ld1b	{z0.b}, p0/z, [%[in], #0, mul vl]\n"
+	    "ld1b	{z1.b}, p0/z, [%[in], #1, mul vl]\n"
+	    "ld1b	{z2.b}, p0/z, [%[in], #2, mul vl]\n"
+	    "ld1b	{z3.b}, p0/z, [%[in], #3, mul vl]\n"
+	    ".irp	k, 16, 17, 18, 19, 20, 21, 22, 23, 24\n"
+	    "aese	z0.b, z0.b, z\\k\\().b\n"
+	    "aese	z1.b, z1.b, z\\k\\().b\n"
+	    "aese	z2.b, z2.b, z\\k\\().b\n"
+	    "aese	z3.b, z3.b, z\\k\\().b\n"
+	    "aesmc	z0.b, z0.b\n"
+	    "aesmc	z1.b, z1.b\n"
+	    "aesmc	z2.b, z2.b\n"
+	    "aesmc	z3.b, z3.b\n"
+	    ".endr\n"
+	    "aese	z0.b, z0.b, z25.b\n"
+	    "aese	z1.b, z1.b, z25.b\n"
+	    "aese	z2.b, z2.b, z25.b\n"
+	    "aese	z3.b, z3.b, z25.b\n"
+	    "eor	z0.d, z0.d, z26.d\n"
+	    "eor	z1.d, z1.d, z26.d\n"
+	    "eor	z2.d, z2.d, z26.d\n"
+	    "eor	z3.d, z3.d, z26.d\n"
+	    "st1b	{z0.b}, p0, [%[out], #0, mul vl]\n"
+	    "st1b	{z1.b}, p0, [%[out], #1, mul vl]\n"
+	    "st1b	{z2.b}, p0, [%[out], #2, mul vl]\n"
+	    "st1b	{z3.b}, p0, [%[out], #3, mul vl]\n"
+	    "addvl	%[in], %[in], #4\n"
+	    "addvl	%[out], %[out], #4\n"
+	    "subs	%[n], %[n], #1\n"
+	    "b.ne	1b\n"
+	    : [in] "+r"(in), [out] "+r"(out), [n] "+r"(n)
+	    : [rk] "r"(rk), [rk2] "r"(rk2)
+	    : "v0", "v1", "v2", "v3", "v16", "v17", "v18", "v19", "v20",
+	      "v21", "v22", "v23", "v24", "v25", "v26", "p0", "cc", "memory");
+	return (len - len % (4 * sve_vl()));
+}
+
+static size_t
+crypto_run_sve_aes(const uint8_t *in, uint8_t *out, size_t len)
+{
+	return (sve_aes_ecb(aes_rk, in, out, len));
+}
+
+static bool
+crypto_check_sve_aes(void)
+{
+	uint8_t *in, *out, *ref;
+	size_t len;
+	bool ok;
+
+	/* The largest vector length is 256 bytes */
+	len = 4 * 256;
+	in = malloc(len);
+	out = malloc(len);
+	ref = malloc(len);
+	if (in == NULL || out == NULL || ref == NULL)
+		err(1, "malloc");
+	for (size_t i = 0; i < len; i++)
+		in[i] = (uint8_t)(i * 13 + 7);
+	aes_ecb(aes_rk, in, ref, len);
+	ok = sve_aes_ecb(aes_rk, in, out, len) == len &&
+	    memcmp(out, ref, len) == 0;
+	free(ref);
+	free(out);
+	free(in);
+	return (ok);
+}
+
+/*
+ * The kernels in the order they are reported. A kernel with no run
+ * function is a feature there is no kernel for, e.g. the multi-vector
+ * SVE AES instructions need a newer assembler than is commonly available.
+ */
+static const struct crypto_kernel crypto_kernels[] = {
+	{ "crc32", "CRC32", crypto_run_crc32, crypto_check_crc32 },
+	{ "crc32c", "CRC32", crypto_run_crc32c, crypto_check_crc32 },
+	{ "aes-128-ecb", "AES", crypto_run_aes, crypto_check_aes },
+	{ "ghash", "PMULL", crypto_run_ghash, crypto_check_ghash },
+	{ "aes-128-gcm", "AES PMULL", crypto_run_gcm, crypto_check_gcm },
+	{ "sha1", "SHA1", crypto_run_sha1, crypto_check_sha1 },
+	{ "sha256", "SHA2", crypto_run_sha256, crypto_check_sha256 },
+	{ "sha512", "SHA512", crypto_run_sha512, crypto_check_sha512 },
+	{ "sha3-256", "SHA3", crypto_run_sha3, crypto_check_sha3 },
+	{ "sm3", "SM3", crypto_run_sm3, crypto_check_sm3 },
+	{ "sm4-ecb", "SM4", crypto_run_sm4, crypto_check_sm4 },
+	{ "sve-aes-128-ecb", "SVEAES", crypto_run_sve_aes,
+	    crypto_check_sve_aes },
+	{ "sve-aes2", "SVE_AES2", NULL, NULL },
+};
+
+/* Set the keys and initial state of the kernels */
+static void
+crypto_init(void)
+{
+	uint8_t key[16], iv[12];
+
+	for (u_int i = 0; i < sizeof(key); i++)
+		key[i] = (uint8_t)i;
+	memset(iv, 0, sizeof(iv));
+
+	aes_sbox_init();
+	aes_expand_key(key, aes_rk);
+	ghash_y = vdupq_n_u64(0);
+	ghash_init(ghash_hp, aes_encrypt(aes_rk, vdupq_n_u8(0)));
+	gcm_init(&crypto_gcm, key, iv);
+	sm4_expand_key(key, sm4_rk);
+	memcpy(crypto_sha1, sha1_iv, sizeof(crypto_sha1));
+	memcpy(crypto_sha256, sha256_iv, sizeof(crypto_sha256));
+	memcpy(crypto_sha512, sha512_iv, sizeof(crypto_sha512));
+	memcpy(crypto_sm3, sm3_iv, sizeof(crypto_sm3));
+	for (u_int i = 0; i < nitems(crypto_sha3); i++)
+		crypto_sha3[i] = vdupq_n_u64(0);
+}
+
+/* Returns the best bytes per ns of three runs */
+static double
+crypto_time(const struct crypto_kernel *k, const uint8_t *in, uint8_t *out)
+{
+	uint64_t start, ns;
+	size_t done;
+	double best;
+
+	/* Warm up the caches and branch predictors */
+	k->run(in, out, CRYPTO_BYTES);
+
+	best = 0;
+	for (u_int r = 0; r < 3; r++) {
+		done = 0;
+		start = bench_nsec();
+		while (done < CRYPTO_TOTAL)
+			done += k->run(in, out, CRYPTO_BYTES);
+		ns = bench_nsec() - start;
+		best = MAX(best, (double)done / ns);
+	}
+	return (best);
+}
+#endif
+
+void
+bench_crypto(void)
+{
+#ifdef __aarch64__
+	const struct arm64id_snapshot *snap;
+	const struct crypto_kernel *k;
+	uint8_t *in, *out;
+	double ghz, gbs;
+
+	snap = arm64id_snapshot_get();
+	if (snap == NULL)
+		errx(1, "unable to read the ID registers");
+
+	if (posix_memalign((void **)&in, 4096, CRYPTO_BYTES) != 0 ||
+	    posix_memalign((void **)&out, 4096, CRYPTO_BYTES) != 0)
+		err(1, "posix_memalign");
+	for (size_t i = 0; i < CRYPTO_BYTES; i++)
+		in[i] = (uint8_t)(i * 31 + 1);
+	crypto_init();
+
+	ghz = bench_ghz();
+	printf("clock estimate %.2f GHz, %d KiB per call\n\n", ghz,
+	    CRYPTO_BYTES / 1024);
+	printf("%-16s %-10s %-5s %8s %11s\n", "kernel", "feature", "check",
+	    "GB/s", "bytes/cycle");
+	for (size_t i = 0; i < nitems(crypto_kernels); i++) {
+		k = &crypto_kernels[i];
+		printf("%-16s %-10s ", k->name, k->requires);
+		if (!arm64id_requires(snap, k->requires)) {
+			printf("not present\n");
+			continue;
+		}
+		if (k->run == NULL) {
+			printf("present, no kernel\n");
+			continue;
+		}
+		/* Don't time a kernel that gets the wrong answer */
+		if (k->check != NULL && !k->check()) {
+			printf("FAIL\n");
+			continue;
+		}
+		gbs = crypto_time(k, in, out);
+		printf("%-5s %8.2f %11.2f\n", k->check != NULL ? "ok" : "-",
+		    gbs, gbs / ghz);
+	}
+	free(in);
+	free(out);
+#else
+	printf("crypto: needs arm64\n");
+#endif
+}
@@ -0,0 +1,280 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Runtime dispatch. Callers give a list of implementations of a function,
+ * best first, each with the features it needs. They are resolved once to a
+ * function pointer, either from an ELF IFUNC resolver or on the first call.
+ *
+ * The IFUNC resolvers run while the dynamic linker is still relocating the
+ * object so the functions used by arm64id_ifunc_resolve must not call into
+ * libc or use anything that needs relocating beyond the static tables.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm64id.h"
+
+/* Used in place of a NULL snapshot, no requirements are met */
+static const struct arm64id_snapshot dispatch_empty;
+
+static bool
+dispatch_is_sep(char ch)
+{
+	return (ch == ' ' || ch == ',' || ch == '\t');
+}
+
+static char
+dispatch_upper(char ch)
+{
+	if (ch >= 'a' && ch <= 'z')
+		return (ch - 'a' + 'A');
+	return (ch);
+}
+
+/* Compare a token of length len with a NUL terminated name ignoring case */
+static bool
+dispatch_match(const char *tok, size_t len, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (name[i] == '\0' ||
+		    dispatch_upper(tok[i]) != dispatch_upper(name[i]))
+			return (false);
+	}
+	return (name[i] == '\0');
+}
+
+static bool
+dispatch_hwcap(const uint64_t *hwcaps, uint32_t hwcap_valid, const char *tok,
+    size_t len)
+{
+	const struct arm64id_hwcap *list;
+	size_t count;
+
+	for (u_int word = 0; word < ARM64ID_NHWCAPS; word++) {
+		list = arm64id_hwcap_list(word, &count);
+		for (size_t i = 0; i < count; i++) {
+			if (!dispatch_match(tok, len, list[i].name))
+				continue;
+			return ((hwcap_valid & (1u << word)) != 0 &&
+			    (hwcaps[word] & list[i].cap) != 0);
+		}
+	}
+	return (false);
+}
+
+/*
+ * Check a field requirement, <register>.<field>>=<value> or
+ * <register>.<field>=<value>, e.g. ID_AA64ISAR0_EL1.Atomic>=2.
+ */
+static bool
+dispatch_field(const struct arm64id_snapshot *snap, const char *tok,
+    size_t len)
+{
+	const struct arm64id_field_desc *desc;
+	const char *dot, *op, *end;
+	char buf[32];
+	int64_t want, val;
+	bool ge;
+
+	dot = memchr(tok, '.', len);
+	op = memchr(tok, '=', len);
+	if (dot == NULL || op == NULL || op < dot)
+		return (false);
+	ge = op[-1] == '>';
+	end = ge ? op - 1 : op;
+
+	if ((size_t)(tok + len - op - 1) >= sizeof(buf))
+		return (false);
+	memcpy(buf, op + 1, tok + len - op - 1);
+	buf[tok + len - op - 1] = '\0';
+	want = strtoll(buf, NULL, 0);
+
+	for (u_int f = 0; f < ARM64ID_NFIELDS; f++) {
+		desc = arm64id_field_desc(f);
+		if (!dispatch_match(tok, dot - tok, desc->reg) ||
+		    !dispatch_match(dot + 1, end - dot - 1, desc->name))
+			continue;
+		if (!arm64id_field_get(snap, f, &val))
+			return (false);
+		return (ge ? val >= want : val == want);
+	}
+	return (false);
+}
+
+/*
+ * Check if all the requirements of an implementation are met. Without a
+ * snapshot only HWCAPs can be checked, e.g. from an IFUNC resolver.
+ */
+static bool
+dispatch_check(const struct arm64id_snapshot *snap, const uint64_t *hwcaps,
+    uint32_t hwcap_valid, const char *req)
+{
+	const char *tok;
+	size_t len;
+	bool is_field, ok;
+
+	if (req == NULL)
+		return (true);
+	for (;;) {
+		while (dispatch_is_sep(*req))
+			req++;
+		if (*req == '\0')
+			return (true);
+		tok = req;
+		while (*req != '\0' && !dispatch_is_sep(*req))
+			req++;
+		len = req - tok;
+
+		/* Field requirements have a '.' between register and field */
+		is_field = false;
+		for (size_t i = 0; i < len; i++)
+			is_field |= tok[i] == '.';
+		if (is_field)
+			ok = snap != NULL && dispatch_field(snap, tok, len);
+		else
+			ok = dispatch_hwcap(hwcaps, hwcap_valid, tok, len);
+		if (!ok)
+			return (false);
+	}
+}
+
+static arm64id_func_t
+dispatch_resolve(const struct arm64id_snapshot *snap, const uint64_t *hwcaps,
+    uint32_t hwcap_valid, const struct arm64id_impl *impls, size_t nimpls)
+{
+	for (size_t i = 0; i < nimpls; i++) {
+		if (dispatch_check(snap, hwcaps, hwcap_valid,
+		    impls[i].requires))
+			return (impls[i].func);
+	}
+	return (NULL);
+}
+
+/*
+ * Check if a snapshot meets a list of requirements. The list is separated
+ * by spaces or commas, each entry is either a HWCAP name, e.g. "ATOMICS",
+ * or an ID register field test, e.g. "ID_AA64ISAR0_EL1.Atomic>=2". Names
+ * are matched ignoring case.
+ */
+bool
+arm64id_requires(const struct arm64id_snapshot *snap, const char *req)
+{
+	return (dispatch_check(snap, snap->hwcaps, snap->hwcap_valid, req));
+}
+
+/*
+ * Return the first implementation whose requirements are met by the
+ * snapshot. The last implementation should have no requirements so there
+ * is always a fallback, if there is none NULL is returned. With a NULL
+ * snapshot, e.g. when arm64id_snapshot_get fails, only implementations
+ * without requirements are used.
+ */
+arm64id_func_t
+arm64id_resolve(const struct arm64id_snapshot *snap,
+    const struct arm64id_impl *impls, size_t nimpls)
+{
+	if (snap == NULL)
+		snap = &dispatch_empty;
+	return (dispatch_resolve(snap, snap->hwcaps, snap->hwcap_valid, impls,
+	    nimpls));
+}
+
+/*
+ * Resolve every entry of a dispatch table from one snapshot. Returns ENOENT
+ * if an entry had no usable implementation, it is left unchanged.
+ */
+int
+arm64id_dispatch_init(const struct arm64id_snapshot *snap,
+    const struct arm64id_dispatch *table, size_t n)
+{
+	arm64id_func_t func;
+	int error;
+
+	error = 0;
+	for (size_t i = 0; i < n; i++) {
+		func = arm64id_resolve(snap, table[i].impls, table[i].nimpls);
+		if (func == NULL) {
+			error = ENOENT;
+			continue;
+		}
+		*table[i].funcp = func;
+	}
+	return (error);
+}
+
+/*
+ * Fill in a snapshot with only HWCAP values, e.g. from the arguments to an
+ * IFUNC resolver, or to force a particular implementation to be used.
+ */
+void
+arm64id_snapshot_hwcaps(struct arm64id_snapshot *snap, const uint64_t *hwcaps,
+    u_int n)
+{
+	memset(snap, 0, sizeof(*snap));
+	snap->version = ARM64ID_SNAPSHOT_VERSION;
+	snap->nregs = ARM64ID_NREGS;
+	for (u_int i = 0; i < n && i < ARM64ID_NHWCAPS; i++) {
+		snap->hwcaps[i] = hwcaps[i];
+		snap->hwcap_valid |= 1u << i;
+	}
+}
+
+/*
+ * The body of the resolvers defined by ARM64ID_IFUNC. The arguments are as
+ * passed to IFUNC resolvers by the Linux and FreeBSD dynamic linkers. Only
+ * the HWCAP requirements can be checked as the registers can't be probed
+ * safely this early, so field requirements are never met.
+ */
+arm64id_func_t
+arm64id_ifunc_resolve(uint64_t hwcap, const struct arm64id_ifunc_arg *arg,
+    const struct arm64id_impl *impls, size_t nimpls)
+{
+	uint64_t hwcaps[ARM64ID_NHWCAPS];
+	uint32_t valid;
+
+	for (u_int i = 0; i < ARM64ID_NHWCAPS; i++)
+		hwcaps[i] = 0;
+	hwcaps[0] = hwcap & ~ARM64ID_IFUNC_ARG_HWCAP;
+	valid = 1u << 0;
+	if ((hwcap & ARM64ID_IFUNC_ARG_HWCAP) != 0 && arg != NULL &&
+	    arg->size >= offsetof(struct arm64id_ifunc_arg, hwcap2) +
+	    sizeof(arg->hwcap2)) {
+		hwcaps[1] = arg->hwcap2;
+		valid |= 1u << 1;
+	}
+	return (dispatch_resolve(NULL, hwcaps, valid, impls, nimpls));
+}
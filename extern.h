@@ -0,0 +1,101 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef	_EXTERN_H_
+#define	_EXTERN_H_
+
+#ifndef nitems
+#define	nitems(x)	(sizeof(x)/sizeof(x[0]))
+#endif
+
+struct arm64id_snapshot;
+struct march_state;
+
+typedef void (*snapshot_cb)(const struct arm64id_snapshot *, void *);
+
+/* arm64id.c */
+int	cache_load(int, struct arm64id_snapshot *);
+void	cache_store(int, const struct arm64id_snapshot *);
+void	print_snapshot(const struct arm64id_snapshot *, bool);
+
+/* atomics.c */
+void	bench_atomics(void);
+
+/* bench.c */
+uint64_t bench_nsec(void);
+double	bench_ghz(void);
+u_int	bench_cpus(int *, u_int);
+bool	bench_pin(int);
+int	bench_main(const char *, char *);
+
+/* crypto.c */
+void	bench_crypto(void);
+
+/* geometry.c */
+void	bench_geometry(void);
+
+/* header.c */
+void	print_header(const struct arm64id_snapshot *);
+
+/* march.c */
+struct march_state *march_alloc(void);
+void	march_add(const struct arm64id_snapshot *, void *);
+void	march_print(struct march_state *);
+
+/* mops.c */
+void	bench_mops(void);
+
+/* mte.c */
+void	bench_mte(void);
+
+/* fleet.c */
+int	fleet_main(int, char **, u_int);
+
+/* input.c */
+bool	input_is_archive(const char *);
+int	input_parse_text(FILE *, snapshot_cb, void *);
+int	input_load(const char *, snapshot_cb, void *);
+
+/* pmu.c */
+void	bench_pmu(void);
+
+/* prom.c */
+int	prom_main(double, bool, u_int, const char *);
+
+/* timer.c */
+void	bench_timer(void);
+
+/* topo.c */
+int	topo_main(u_int, bool, const char *);
+
+/* vl.c */
+void	bench_vl(void);
+
+/* watch.c */
+int	watch_main(double, bool, const char *);
+
+#endif /* !_EXTERN_H_ */
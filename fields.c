@@ -0,0 +1,125 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arm64id.h"
+
+#define	VAL(v, s)	{ (v), (s) },
+
+#define	FIELD(reg, name, shift, width, sign, values)			\
+static const struct arm64id_field_value reg##_##name##_values[] = {	\
+	values								\
+	{ 0, NULL }							\
+};
+ARM64ID_FIELD_TABLE
+#undef FIELD
+
+#define	FIELD_SIGNED_U	false
+#define	FIELD_SIGNED_S	true
+
+static const struct arm64id_field_desc field_descs[ARM64ID_NFIELDS] = {
+#define	FIELD(_reg, _name, _shift, _width, _sign, vals)			\
+	[ARM64ID_##_reg##_##_name] = {					\
+		.reg = #_reg,						\
+		.name = #_name,						\
+		.enc = ARM64ID_ENC_##_reg,				\
+		.shift = _shift,					\
+		.width = _width,					\
+		.is_signed = FIELD_SIGNED_##_sign,			\
+		.values = _reg##_##_name##_values,			\
+	},
+	ARM64ID_FIELD_TABLE
+#undef FIELD
+};
+
+/* The snapshot index of the register holding each field */
+static pthread_once_t field_once = PTHREAD_ONCE_INIT;
+static int field_reg[ARM64ID_NFIELDS];
+
+static void
+field_init(void)
+{
+	for (u_int i = 0; i < ARM64ID_NFIELDS; i++)
+		field_reg[i] = arm64id_reg_index(field_descs[i].enc);
+}
+
+const struct arm64id_field_desc *
+arm64id_field_desc(enum arm64id_field field)
+{
+	if ((u_int)field >= ARM64ID_NFIELDS)
+		return (NULL);
+	return (&field_descs[field]);
+}
+
+/*
+ * Extract a field from a snapshot, sign extending signed fields. Returns
+ * false if the register holding the field couldn't be read.
+ */
+bool
+arm64id_field_get(const struct arm64id_snapshot *snap,
+    enum arm64id_field field, int64_t *valp)
+{
+	const struct arm64id_field_desc *desc;
+	uint64_t mask, val;
+	int idx;
+
+	if ((u_int)field >= ARM64ID_NFIELDS)
+		return (false);
+	pthread_once(&field_once, field_init);
+
+	idx = field_reg[field];
+	if (idx < 0 || !arm64id_reg_valid(snap, idx))
+		return (false);
+
+	desc = &field_descs[field];
+	mask = ((uint64_t)1 << desc->width) - 1;
+	val = (snap->regs[idx] >> desc->shift) & mask;
+	if (desc->is_signed && (val & ((mask >> 1) + 1)) != 0)
+		val |= ~mask;
+	*valp = (int64_t)val;
+	return (true);
+}
+
+const char *
+arm64id_field_value_name(enum arm64id_field field, int64_t val)
+{
+	const struct arm64id_field_value *v;
+
+	if ((u_int)field >= ARM64ID_NFIELDS)
+		return (NULL);
+	for (v = field_descs[field].values; v->name != NULL; v++) {
+		if (v->value == val)
+			return (v->name);
+	}
+	return (NULL);
+}
@@ -0,0 +1,634 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+/*
+ * Aggregate many snapshots to find the features common to all of them,
+ * the features present on any of them, and how many snapshots have each
+ * feature. This only uses saved snapshots so runs on any host.
+ *
+ * The HWCAP words are combined with vector AND/OR. The ID register fields
+ * listed in arm64id_fields.h are each extracted to a byte of a vector and
+ * combined with a vector min/max. Signed fields are biased by flipping
+ * their top bit so an unsigned compare orders them correctly. MIDR_EL1 and
+ * REVIDR_EL1 have no ordering so are reported as the set of values seen.
+ *
+ * Fleets have few distinct configurations, so the field ranges and the
+ * per-feature counts are computed from a table of unique configurations
+ * rather than per snapshot.
+ */
+
+typedef uint8_t v16u8 __attribute__((__vector_size__(16)));
+typedef uint64_t v2u64 __attribute__((__vector_size__(16)));
+
+#define	FLEET_NIDREGS	64	/* Max registers in a configuration */
+#define	FLEET_NVEC	howmany(ARM64ID_NFIELDS, 16)
+#define	FLEET_NVALUES	256	/* Field values, all fields are <= 8 bits */
+#define	FLEET_CHUNK	65536
+
+/* The part of a snapshot used to tell configurations apart */
+struct fleet_config {
+	uint64_t	hwcaps[ARM64ID_NHWCAPS];
+	uint64_t	hwcap_valid;
+	uint64_t	id_valid;
+	uint64_t	id_regs[FLEET_NIDREGS];
+};
+
+struct fleet_entry {
+	struct fleet_config cfg;
+	uint64_t	hash;
+	uint64_t	count;
+};
+
+struct fleet_agg {
+	uint64_t	nsnaps;
+	uint64_t	hwcap_nsnaps[ARM64ID_NHWCAPS];
+	v2u64		hwcap_and[ARM64ID_NHWCAPS / 2];
+	v2u64		hwcap_or[ARM64ID_NHWCAPS / 2];
+	uint64_t	id_nsnaps[FLEET_NIDREGS];
+
+	struct fleet_entry *entries;
+	size_t		nentries;
+	size_t		size;
+};
+
+struct fleet_work {
+	const char	*path;
+	const struct arm64id_record *recs;
+	size_t		nrecs;
+};
+
+struct fleet_thread {
+	pthread_t	thread;
+	struct fleet_agg agg;
+	int		error;
+};
+
+/* One byte per field, as a vector or as an array */
+union fleet_lanes {
+	v16u8		v[FLEET_NVEC];
+	uint8_t		b[FLEET_NVEC * 16];
+};
+
+struct fleet_value {
+	uint64_t	value;
+	uint64_t	count;
+};
+
+/* The registers kept in a configuration, as snapshot indexes */
+static u_int fleet_nid;
+static u_int fleet_id_idx[FLEET_NIDREGS];
+/* The fields aggregated, the configuration register holding each */
+static u_int fleet_nfields;
+static enum arm64id_field fleet_fields[ARM64ID_NFIELDS];
+static u_int fleet_field_id[ARM64ID_NFIELDS];
+static union fleet_lanes fleet_bias;
+/* The configuration registers for MIDR_EL1 and REVIDR_EL1, or -1 */
+static int fleet_midr, fleet_revidr;
+
+static struct fleet_work *fleet_work;
+static size_t fleet_nwork;
+static size_t fleet_next;
+
+static inline v16u8
+vmin(v16u8 a, v16u8 b)
+{
+	v16u8 m;
+
+	m = (v16u8)(a < b);
+	return ((a & m) | (b & ~m));
+}
+
+static inline v16u8
+vmax(v16u8 a, v16u8 b)
+{
+	v16u8 m;
+
+	m = (v16u8)(a > b);
+	return ((a & m) | (b & ~m));
+}
+
+/* Find or add the snapshot register idx to the configuration */
+static int
+fleet_id_add(u_int idx)
+{
+	for (u_int i = 0; i < fleet_nid; i++) {
+		if (fleet_id_idx[i] == idx)
+			return (i);
+	}
+	if (fleet_nid == FLEET_NIDREGS)
+		return (-1);
+	fleet_id_idx[fleet_nid] = idx;
+	return (fleet_nid++);
+}
+
+static int
+fleet_id_lookup(const char *name)
+{
+	int idx;
+
+	idx = arm64id_reg_lookup(name);
+	if (idx < 0)
+		return (-1);
+	return (fleet_id_add(idx));
+}
+
+static void
+fleet_setup(void)
+{
+	const struct arm64id_field_desc *desc;
+	int id, idx;
+
+	fleet_nid = 0;
+	fleet_nfields = 0;
+	memset(&fleet_bias, 0, sizeof(fleet_bias));
+	for (u_int f = 0; f < ARM64ID_NFIELDS; f++) {
+		desc = arm64id_field_desc(f);
+		/* Skip MPIDR_EL1 as it is different on every CPU */
+		idx = arm64id_reg_index(desc->enc);
+		if (idx < 0 || arm64id_reg_volatile(idx))
+			continue;
+		id = fleet_id_add(idx);
+		if (id < 0)
+			continue;
+		if (desc->is_signed)
+			fleet_bias.b[fleet_nfields] = 1u << (desc->width - 1);
+		fleet_field_id[fleet_nfields] = id;
+		fleet_fields[fleet_nfields++] = f;
+	}
+	fleet_midr = fleet_id_lookup("midr_el1");
+	fleet_revidr = fleet_id_lookup("revidr_el1");
+}
+
+/* The biased value of field n from a configuration */
+static inline u_int
+fleet_field_raw(const struct fleet_config *cfg, u_int n)
+{
+	const struct arm64id_field_desc *desc;
+
+	desc = arm64id_field_desc(fleet_fields[n]);
+	return (((cfg->id_regs[fleet_field_id[n]] >> desc->shift) &
+	    ((1u << desc->width) - 1)) ^ fleet_bias.b[n]);
+}
+
+/* Undo the bias and sign extend */
+static int
+fleet_field_value(u_int n, u_int raw)
+{
+	const struct arm64id_field_desc *desc;
+
+	desc = arm64id_field_desc(fleet_fields[n]);
+	if (desc->is_signed)
+		return ((int)raw - (1 << (desc->width - 1)));
+	return (raw);
+}
+
+static void
+fleet_agg_init(struct fleet_agg *agg)
+{
+	memset(agg, 0, sizeof(*agg));
+	for (u_int i = 0; i < ARM64ID_NHWCAPS / 2; i++)
+		agg->hwcap_and[i] = ~(v2u64){ 0, 0 };
+}
+
+static uint64_t
+fleet_hash(const struct fleet_config *cfg)
+{
+	const uint64_t *w;
+	uint64_t h;
+
+	h = 0xcbf29ce484222325ul;
+	w = (const uint64_t *)cfg;
+	for (size_t i = 0; i < sizeof(*cfg) / sizeof(*w); i++) {
+		h ^= w[i];
+		h *= 0x100000001b3ul;
+		h ^= h >> 29;
+	}
+	return (h);
+}
+
+static void
+fleet_insert(struct fleet_agg *agg, const struct fleet_config *cfg,
+    uint64_t hash, uint64_t count)
+{
+	struct fleet_entry *old, *e;
+	size_t i, oldsize;
+
+	if (agg->nentries * 2 >= agg->size) {
+		old = agg->entries;
+		oldsize = agg->size;
+		agg->size = oldsize == 0 ? 64 : oldsize * 2;
+		agg->entries = calloc(agg->size, sizeof(*agg->entries));
+		if (agg->entries == NULL)
+			err(1, "calloc");
+		agg->nentries = 0;
+		for (i = 0; i < oldsize; i++) {
+			if (old[i].count != 0)
+				fleet_insert(agg, &old[i].cfg, old[i].hash,
+				    old[i].count);
+		}
+		free(old);
+	}
+
+	for (i = hash & (agg->size - 1);; i = (i + 1) & (agg->size - 1)) {
+		e = &agg->entries[i];
+		if (e->count == 0) {
+			e->cfg = *cfg;
+			e->hash = hash;
+			e->count = count;
+			agg->nentries++;
+			return;
+		}
+		if (e->hash == hash && memcmp(&e->cfg, cfg, sizeof(*cfg)) == 0) {
+			e->count += count;
+			return;
+		}
+	}
+}
+
+static void
+fleet_add(const struct arm64id_snapshot *snap, void *arg)
+{
+	struct fleet_agg *agg;
+	struct fleet_config cfg;
+	v2u64 caps, valid;
+	u_int idx;
+
+	agg = arg;
+	agg->nsnaps++;
+
+	memset(&cfg, 0, sizeof(cfg));
+	memcpy(cfg.hwcaps, snap->hwcaps, sizeof(cfg.hwcaps));
+	cfg.hwcap_valid = snap->hwcap_valid;
+	for (u_int w = 0; w < ARM64ID_NHWCAPS; w += 2) {
+		memcpy(&caps, &snap->hwcaps[w], sizeof(caps));
+		valid = (v2u64){
+		    arm64id_hwcap_valid(snap, w) ? ~0ul : 0,
+		    arm64id_hwcap_valid(snap, w + 1) ? ~0ul : 0 };
+		/* Unknown words don't take part in the intersection */
+		agg->hwcap_and[w / 2] &= caps | ~valid;
+		agg->hwcap_or[w / 2] |= caps & valid;
+		agg->hwcap_nsnaps[w] += valid[0] & 1;
+		agg->hwcap_nsnaps[w + 1] += valid[1] & 1;
+	}
+
+	for (u_int i = 0; i < fleet_nid; i++) {
+		idx = fleet_id_idx[i];
+		if (!arm64id_reg_valid(snap, idx))
+			continue;
+		cfg.id_valid |= (uint64_t)1 << i;
+		cfg.id_regs[i] = snap->regs[idx];
+		agg->id_nsnaps[i]++;
+	}
+
+	fleet_insert(agg, &cfg, fleet_hash(&cfg), 1);
+}
+
+static void
+fleet_merge(struct fleet_agg *dst, const struct fleet_agg *src)
+{
+	dst->nsnaps += src->nsnaps;
+	for (u_int w = 0; w < ARM64ID_NHWCAPS; w++)
+		dst->hwcap_nsnaps[w] += src->hwcap_nsnaps[w];
+	for (u_int w = 0; w < ARM64ID_NHWCAPS / 2; w++) {
+		dst->hwcap_and[w] &= src->hwcap_and[w];
+		dst->hwcap_or[w] |= src->hwcap_or[w];
+	}
+	for (u_int i = 0; i < fleet_nid; i++)
+		dst->id_nsnaps[i] += src->id_nsnaps[i];
+	for (size_t i = 0; i < src->size; i++) {
+		if (src->entries[i].count != 0)
+			fleet_insert(dst, &src->entries[i].cfg,
+			    src->entries[i].hash, src->entries[i].count);
+	}
+}
+
+static void *
+fleet_thread(void *arg)
+{
+	struct fleet_thread *thr;
+	struct fleet_work *work;
+	size_t i;
+	int error;
+
+	thr = arg;
+	for (;;) {
+		i = __atomic_fetch_add(&fleet_next, 1, __ATOMIC_RELAXED);
+		if (i >= fleet_nwork)
+			break;
+		work = &fleet_work[i];
+		if (work->recs == NULL) {
+			error = input_load(work->path, fleet_add, &thr->agg);
+			if (error != 0) {
+				errno = error;
+				warn("%s", work->path);
+				thr->error = error;
+			}
+			continue;
+		}
+		for (size_t r = 0; r < work->nrecs; r++) {
+			if (arm64id_record_valid(&work->recs[r]))
+				fleet_add(&work->recs[r].snap, &thr->agg);
+		}
+	}
+	return (NULL);
+}
+
+static void
+fleet_add_work(const char *path, const struct arm64id_record *recs,
+    size_t nrecs)
+{
+	fleet_work = reallocarray(fleet_work, fleet_nwork + 1,
+	    sizeof(*fleet_work));
+	if (fleet_work == NULL)
+		err(1, "reallocarray");
+	fleet_work[fleet_nwork].path = path;
+	fleet_work[fleet_nwork].recs = recs;
+	fleet_work[fleet_nwork].nrecs = nrecs;
+	fleet_nwork++;
+}
+
+static void
+fleet_print_hwcaps(const struct fleet_agg *agg)
+{
+	const struct arm64id_hwcap *caps;
+	uint64_t and, or, count;
+	size_t ncaps;
+
+	for (u_int w = 0; w < ARM64ID_NHWCAPS; w++) {
+		if (agg->hwcap_nsnaps[w] == 0)
+			continue;
+		and = agg->hwcap_and[w / 2][w % 2];
+		or = agg->hwcap_or[w / 2][w % 2];
+		printf("HWCAP%.0u: common %016"PRIx64" any %016"PRIx64" "
+		    "(%"PRIu64" snapshots)\n", w == 0 ? 0 : w + 1, and, or,
+		    agg->hwcap_nsnaps[w]);
+
+		caps = arm64id_hwcap_list(w, &ncaps);
+		for (size_t i = 0; i < ncaps; i++) {
+			if ((or & caps[i].cap) == 0)
+				continue;
+			count = 0;
+			for (size_t e = 0; e < agg->size; e++) {
+				if ((agg->entries[e].cfg.hwcaps[w] &
+				    caps[i].cap) != 0)
+					count += agg->entries[e].count;
+			}
+			printf("  %-16s %12"PRIu64" %6.2f%%%s\n", caps[i].name,
+			    count, 100.0 * count / agg->hwcap_nsnaps[w],
+			    (and & caps[i].cap) != 0 ? "" : " partial");
+		}
+	}
+}
+
+static int
+fleet_value_cmp(const void *a, const void *b)
+{
+	const struct fleet_value *va, *vb;
+
+	va = a;
+	vb = b;
+	if (va->count != vb->count)
+		return (va->count < vb->count ? 1 : -1);
+	if (va->value != vb->value)
+		return (va->value < vb->value ? -1 : 1);
+	return (0);
+}
+
+/* Print the distinct values of a register with no ordered fields */
+static void
+fleet_print_values(const struct fleet_agg *agg, int id)
+{
+	struct fleet_value *vals;
+	const struct fleet_entry *e;
+	size_t i, nvals;
+
+	if (id < 0 || agg->id_nsnaps[id] == 0)
+		return;
+
+	vals = calloc(agg->nentries, sizeof(*vals));
+	if (vals == NULL)
+		err(1, "calloc");
+	nvals = 0;
+	for (size_t n = 0; n < agg->size; n++) {
+		e = &agg->entries[n];
+		if (e->count == 0 ||
+		    (e->cfg.id_valid & ((uint64_t)1 << id)) == 0)
+			continue;
+		for (i = 0; i < nvals; i++) {
+			if (vals[i].value == e->cfg.id_regs[id])
+				break;
+		}
+		if (i == nvals)
+			vals[nvals++].value = e->cfg.id_regs[id];
+		vals[i].count += e->count;
+	}
+	qsort(vals, nvals, sizeof(*vals), fleet_value_cmp);
+
+	printf("%20s: %zu distinct value%s (%"PRIu64" snapshots)\n",
+	    arm64id_reg_name(fleet_id_idx[id]), nvals, nvals == 1 ? "" : "s",
+	    agg->id_nsnaps[id]);
+	for (i = 0; i < nvals; i++)
+		printf("  0x%016"PRIx64" %12"PRIu64" %6.2f%%\n", vals[i].value,
+		    vals[i].count, 100.0 * vals[i].count / agg->id_nsnaps[id]);
+	free(vals);
+}
+
+/*
+ * Find the biased min and max of each field over the configurations.
+ * Fields in registers a configuration couldn't read are left out.
+ */
+static void
+fleet_field_range(const struct fleet_agg *agg, union fleet_lanes *min,
+    union fleet_lanes *max)
+{
+	union fleet_lanes v, valid;
+	const struct fleet_entry *e;
+
+	memset(min, 0xff, sizeof(*min));
+	memset(max, 0, sizeof(*max));
+	for (size_t i = 0; i < agg->size; i++) {
+		e = &agg->entries[i];
+		if (e->count == 0)
+			continue;
+		memset(&v, 0, sizeof(v));
+		memset(&valid, 0, sizeof(valid));
+		for (u_int n = 0; n < fleet_nfields; n++) {
+			if ((e->cfg.id_valid &
+			    ((uint64_t)1 << fleet_field_id[n])) == 0)
+				continue;
+			v.b[n] = fleet_field_raw(&e->cfg, n);
+			valid.b[n] = 0xff;
+		}
+		for (u_int w = 0; w < FLEET_NVEC; w++) {
+			min->v[w] = vmin(min->v[w], v.v[w] | ~valid.v[w]);
+			max->v[w] = vmax(max->v[w], v.v[w] & valid.v[w]);
+		}
+	}
+}
+
+static void
+fleet_print_fields(const struct fleet_agg *agg)
+{
+	uint64_t hist[FLEET_NVALUES];
+	union fleet_lanes rmin, rmax;
+	const struct arm64id_field_desc *desc;
+	const struct fleet_entry *e;
+	u_int id, min, max;
+
+	printf("\nID register fields (common = lowest value):\n");
+	fleet_field_range(agg, &rmin, &rmax);
+	for (u_int n = 0; n < fleet_nfields; n++) {
+		id = fleet_field_id[n];
+		if (agg->id_nsnaps[id] == 0)
+			continue;
+		min = rmin.b[n];
+		max = rmax.b[n];
+		if (fleet_field_value(n, min) == 0 &&
+		    fleet_field_value(n, max) == 0)
+			continue;
+
+		desc = arm64id_field_desc(fleet_fields[n]);
+		printf("%20s.%-12s common %d",
+		    arm64id_reg_name(fleet_id_idx[id]), desc->name,
+		    fleet_field_value(n, min));
+		if (min == max) {
+			printf("\n");
+			continue;
+		}
+
+		memset(hist, 0, sizeof(hist));
+		for (size_t i = 0; i < agg->size; i++) {
+			e = &agg->entries[i];
+			if (e->count == 0 ||
+			    (e->cfg.id_valid & ((uint64_t)1 << id)) == 0)
+				continue;
+			hist[fleet_field_raw(&e->cfg, n)] += e->count;
+		}
+		printf(" any %d:", fleet_field_value(n, max));
+		for (u_int v = 0; v < FLEET_NVALUES; v++) {
+			if (hist[v] != 0)
+				printf(" %d=%"PRIu64, fleet_field_value(n, v),
+				    hist[v]);
+		}
+		printf("\n");
+	}
+}
+
+/*
+ * arm64id -A [-j threads] file ...
+ */
+int
+fleet_main(int argc, char **argv, u_int nthreads)
+{
+	struct arm64id_archive *archives;
+	struct fleet_thread *threads;
+	struct fleet_agg total;
+	int error, ret;
+
+	if (argc == 0)
+		return (EINVAL);
+
+	fleet_setup();
+
+	archives = calloc(argc, sizeof(*archives));
+	if (archives == NULL)
+		err(1, "calloc");
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "-") == 0 || !input_is_archive(argv[i])) {
+			fleet_add_work(argv[i], NULL, 0);
+			continue;
+		}
+		error = arm64id_archive_open(argv[i], &archives[i]);
+		if (error != 0) {
+			errno = error;
+			err(1, "%s", argv[i]);
+		}
+		for (size_t r = 0; r < archives[i].nrecords; r += FLEET_CHUNK)
+			fleet_add_work(argv[i], archives[i].records + r,
+			    MIN(FLEET_CHUNK, archives[i].nrecords - r));
+	}
+
+	nthreads = MAX(1, MIN(nthreads, fleet_nwork));
+	threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL)
+		err(1, "calloc");
+	for (u_int t = 0; t < nthreads; t++) {
+		fleet_agg_init(&threads[t].agg);
+		error = pthread_create(&threads[t].thread, NULL, fleet_thread,
+		    &threads[t]);
+		if (error != 0) {
+			errno = error;
+			err(1, "pthread_create");
+		}
+	}
+
+	ret = 0;
+	fleet_agg_init(&total);
+	for (u_int t = 0; t < nthreads; t++) {
+		pthread_join(threads[t].thread, NULL);
+		if (threads[t].error != 0)
+			ret = 1;
+		fleet_merge(&total, &threads[t].agg);
+		free(threads[t].agg.entries);
+	}
+	free(threads);
+
+	printf("%"PRIu64" snapshots, %zu unique configurations\n",
+	    total.nsnaps, total.nentries);
+	if (total.nsnaps != 0) {
+		fleet_print_hwcaps(&total);
+		printf("\nCore identification:\n");
+		fleet_print_values(&total, fleet_midr);
+		fleet_print_values(&total, fleet_revidr);
+		fleet_print_fields(&total);
+	}
+
+	free(total.entries);
+	for (int i = 0; i < argc; i++)
+		arm64id_archive_close(&archives[i]);
+	free(archives);
+	free(fleet_work);
+
+	return (ret);
+}
@@ -0,0 +1,360 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Measure the cache geometry and compare it with what CTR_EL0 and
+ * DCZID_EL0 report. This is the "geometry" benchmark.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/mman.h>
+
+#include <err.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#define	CHASE_MIN	(4 * 1024)
+#define	CHASE_MAX	(256 * 1024 * 1024)
+#define	CHASE_LEVELS	4
+/* Sizes up to this are timed a few times */
+#define	CHASE_REPEAT_MAX	(8 * 1024 * 1024)
+/* Latency must grow by this much to leave a cache level */
+#define	CHASE_STEP	1.5
+/* and then change by less than this between sizes to be a new level */
+#define	CHASE_FLAT	1.15
+
+#define	SHARE_ITERS	(20 * 1000 * 1000)
+#define	SHARE_FAR	4096
+
+#define	ZERO_BYTES	(1024ul * 1024 * 1024)
+
+/* The line size to use when CTR_EL0 is unavailable */
+#define	DEFAULT_LINE	64
+
+static uint64_t
+geometry_rand(uint64_t *state)
+{
+	/* xorshift64 */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return (*state);
+}
+
+static u_int
+geometry_field_size(const struct arm64id_snapshot *snap, enum arm64id_field f)
+{
+	int64_t val;
+
+	if (snap == NULL || !arm64id_field_get(snap, f, &val) || val == 0)
+		return (0);
+	return (4u << val);
+}
+
+static void
+print_size(const char *name, size_t size)
+{
+	if (size >= 1024 * 1024)
+		printf("%-16s %zu MiB\n", name, size / (1024 * 1024));
+	else if (size >= 1024)
+		printf("%-16s %zu KiB\n", name, size / 1024);
+	else if (size > 0)
+		printf("%-16s %zu bytes\n", name, size);
+	else
+		printf("%-16s unknown\n", name);
+}
+
+/*
+ * Chase pointers through size bytes of memory in a random order, one
+ * pointer per line so each load depends on the last and may miss.
+ */
+static double
+geometry_chase(char *buf, size_t size, size_t line)
+{
+	size_t *order, nlines, j, tmp;
+	uint64_t best, ns, rng, start, steps;
+	void **p;
+
+	nlines = size / line;
+	order = malloc(nlines * sizeof(*order));
+	if (order == NULL)
+		err(1, "malloc");
+	for (size_t i = 0; i < nlines; i++)
+		order[i] = i;
+	rng = 0x9e3779b97f4a7c15ull;
+	for (size_t i = nlines - 1; i > 0; i--) {
+		j = geometry_rand(&rng) % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	for (size_t i = 0; i < nlines; i++)
+		*(void **)(buf + order[i] * line) =
+		    buf + order[(i + 1) % nlines] * line;
+	free(order);
+
+	steps = MIN(MAX(nlines * 2, 1u << 20), 1u << 23);
+	p = (void **)buf;
+	/* Warm up */
+	for (size_t i = 0; i < nlines; i++)
+		p = *p;
+	/* Take the best of a few runs to skip interrupts and preemption */
+	best = UINT64_MAX;
+	for (u_int run = 0; run < (size <= CHASE_REPEAT_MAX ? 3 : 1); run++) {
+		start = bench_nsec();
+		for (uint64_t i = 0; i < steps; i++)
+			p = *p;
+		__asm __volatile("" :: "r"(p));
+		ns = bench_nsec() - start;
+		best = MIN(best, ns);
+	}
+	return ((double)best / steps);
+}
+
+static void
+geometry_levels(size_t line)
+{
+	size_t sizes[CHASE_LEVELS], size, prev;
+	double lat, last, base, lats[CHASE_LEVELS];
+	u_int nlevels;
+	bool plateau;
+	char *buf;
+
+	buf = mmap(NULL, CHASE_MAX, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (buf == MAP_FAILED)
+		err(1, "mmap");
+
+	printf("\nLoad latency, %zu byte stride, random order:\n", line);
+	nlevels = 0;
+	base = last = 0;
+	prev = 0;
+	plateau = false;
+	/* Sizes go up by a factor of 1.5 then 1.33 so each power of 2 is hit */
+	for (size = CHASE_MIN; size <= CHASE_MAX;
+	    size = (size & (size - 1)) == 0 ? size + size / 2 : size / 3 * 4) {
+		lat = geometry_chase(buf, size, line);
+		printf("%10zu KiB %8.2f ns\n", size / 1024, lat);
+		if (base == 0) {
+			base = lat;
+			plateau = true;
+		} else if (plateau && lat > base * CHASE_STEP) {
+			/* The previous size fit in the current level */
+			if (nlevels < CHASE_LEVELS) {
+				sizes[nlevels] = prev;
+				lats[nlevels] = base;
+				nlevels++;
+			}
+			plateau = false;
+		} else if (!plateau && lat < last * CHASE_FLAT) {
+			base = lat;
+			plateau = true;
+		}
+		last = lat;
+		prev = size;
+	}
+	munmap(buf, CHASE_MAX);
+
+	printf("\n");
+	for (u_int i = 0; i < nlevels; i++) {
+		printf("level %u: at least %zu KiB, %.2f ns\n", i + 1,
+		    sizes[i] / 1024, lats[i]);
+	}
+	printf("memory: %.2f ns\n", last);
+}
+
+struct share_arg {
+	volatile uint64_t *counter;
+	volatile u_int	*start;
+	int		 cpu;
+};
+
+static void *
+share_thread(void *arg)
+{
+	struct share_arg *sa;
+
+	sa = arg;
+	if (sa->cpu >= 0)
+		(void)bench_pin(sa->cpu);
+	while (*sa->start == 0)
+		;
+	for (u_int i = 0; i < SHARE_ITERS; i++)
+		(*sa->counter)++;
+	return (NULL);
+}
+
+/* Time two threads incrementing counters offset bytes apart */
+static double
+geometry_share(char *buf, size_t offset, const int *cpus)
+{
+	struct share_arg args[2];
+	pthread_t threads[2];
+	volatile u_int start;
+	uint64_t begin;
+
+	start = 0;
+	for (u_int i = 0; i < 2; i++) {
+		args[i].counter = (volatile uint64_t *)(buf + i * offset);
+		args[i].start = &start;
+		args[i].cpu = cpus != NULL ? cpus[i] : -1;
+		if (pthread_create(&threads[i], NULL, share_thread,
+		    &args[i]) != 0)
+			errx(1, "pthread_create");
+	}
+	/* Give the threads time to pin themselves */
+	usleep(10000);
+	begin = bench_nsec();
+	start = 1;
+	for (u_int i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+	return ((double)(bench_nsec() - begin) / SHARE_ITERS);
+}
+
+static size_t
+geometry_granule(void)
+{
+	size_t granule, offset;
+	double far, t;
+	int cpus[2];
+	char *buf;
+
+	if (bench_cpus(cpus, nitems(cpus)) != nitems(cpus)) {
+		printf("\nfalse sharing: needs two CPUs\n");
+		return (0);
+	}
+	if (posix_memalign((void **)&buf, SHARE_FAR, 2 * SHARE_FAR) != 0)
+		err(1, "posix_memalign");
+	memset(buf, 0, 2 * SHARE_FAR);
+
+	printf("\nFalse sharing, cpus %d and %d:\n", cpus[0], cpus[1]);
+	far = geometry_share(buf, SHARE_FAR, cpus);
+	printf("%10d bytes %8.2f ns/increment\n", SHARE_FAR, far);
+	granule = 0;
+	for (offset = 8; offset < SHARE_FAR; offset *= 2) {
+		t = geometry_share(buf, offset, cpus);
+		printf("%10zu bytes %8.2f ns/increment\n", offset, t);
+		/* The first offset that is close to independent counters */
+		if (granule == 0 && t < far * 1.5)
+			granule = offset;
+	}
+	free(buf);
+	return (granule);
+}
+
+#ifdef __aarch64__
+static void
+geometry_zva(char *buf, size_t len, size_t bs)
+{
+	for (char *p = buf; p < buf + len; p += bs)
+		__asm __volatile("dc zva, %0" :: "r"(p) : "memory");
+}
+#endif
+
+static void
+geometry_zero(size_t zva_size)
+{
+	const size_t sizes[] = { 16 * 1024, 64 * 1024 * 1024 };
+	uint64_t start, ns;
+	size_t iters;
+	char *buf;
+
+	printf("\nZeroing throughput:\n");
+	if (posix_memalign((void **)&buf, 4096, sizes[nitems(sizes) - 1]) != 0)
+		err(1, "posix_memalign");
+	memset(buf, 1, sizes[nitems(sizes) - 1]);
+
+	for (size_t i = 0; i < nitems(sizes); i++) {
+		iters = MAX(ZERO_BYTES / sizes[i], 1);
+
+		start = bench_nsec();
+		for (size_t j = 0; j < iters; j++) {
+			memset(buf, 0, sizes[i]);
+			__asm __volatile("" :: "r"(buf) : "memory");
+		}
+		ns = bench_nsec() - start;
+		printf("%10zu KiB memset %8.2f GB/s\n", sizes[i] / 1024,
+		    (double)sizes[i] * iters / ns);
+
+#ifdef __aarch64__
+		if (zva_size == 0)
+			continue;
+		start = bench_nsec();
+		for (size_t j = 0; j < iters; j++)
+			geometry_zva(buf, sizes[i], zva_size);
+		ns = bench_nsec() - start;
+		printf("%10zu KiB dc zva %8.2f GB/s\n", sizes[i] / 1024,
+		    (double)sizes[i] * iters / ns);
+#endif
+	}
+	if (zva_size == 0)
+		printf("dc zva: prohibited or unknown\n");
+	free(buf);
+}
+
+void
+bench_geometry(void)
+{
+	const struct arm64id_snapshot *snap;
+	size_t dline, granule, zva;
+	int64_t val;
+
+	snap = arm64id_snapshot_get();
+	dline = geometry_field_size(snap, ARM64ID_CTR_EL0_DminLine);
+	zva = geometry_field_size(snap, ARM64ID_DCZID_EL0_BS);
+	if (snap != NULL &&
+	    arm64id_field_get(snap, ARM64ID_DCZID_EL0_DZP, &val) && val != 0)
+		zva = 0;
+
+	printf("Reported by CTR_EL0 and DCZID_EL0:\n");
+	print_size("D-cache line", dline);
+	print_size("I-cache line",
+	    geometry_field_size(snap, ARM64ID_CTR_EL0_IminLine));
+	print_size("CWG", geometry_field_size(snap, ARM64ID_CTR_EL0_CWG));
+	print_size("ERG", geometry_field_size(snap, ARM64ID_CTR_EL0_ERG));
+	print_size("DC ZVA block", zva);
+
+	geometry_levels(dline != 0 ? dline : DEFAULT_LINE);
+
+	granule = geometry_granule();
+	if (granule != 0) {
+		printf("\n");
+		print_size("coherence granule", granule);
+	}
+
+	geometry_zero(zva);
+}
@@ -0,0 +1,196 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Generate a C/C++ header of compile-time constants from a snapshot so code
+ * can be specialised for a known set of hardware. The output only depends
+ * on the snapshot, there are no timestamps or hostnames, so it can be
+ * cached by a build system and generated from a saved snapshot on any host.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+/* Common names for features that have a different HWCAP name */
+static const struct {
+	const char *name;
+	const char *hwcap;
+} header_aliases[] = {
+	{ "LSE",	"ATOMICS" },
+	{ "LSE2",	"USCAT" },
+	{ "PAUTH",	"PACA" },
+	{ "RCPC",	"LRCPC" },
+	{ "RDM",	"ASIMDRDM" },
+	{ "DOTPROD",	"ASIMDDP" },
+	{ "FP16",	"FPHP" },
+	{ "FHM",	"ASIMDFHM" },
+};
+
+static void
+print_upper(const char *str)
+{
+	for (; *str != '\0'; str++)
+		putchar(toupper((unsigned char)*str));
+}
+
+static void
+print_lower(const char *str)
+{
+	for (; *str != '\0'; str++)
+		putchar(tolower((unsigned char)*str));
+}
+
+static bool
+header_have(const struct arm64id_snapshot *snap,
+    const struct arm64id_hwcap *cap, u_int word)
+{
+	return (arm64id_hwcap_valid(snap, word) &&
+	    (snap->hwcaps[word] & cap->cap) != 0);
+}
+
+/*
+ * Get the size in bytes of a cache line or block from a log2(words) field,
+ * or 0 if the register isn't in the snapshot.
+ */
+static u_int
+header_line_size(const struct arm64id_snapshot *snap, enum arm64id_field f)
+{
+	int64_t val;
+
+	if (!arm64id_field_get(snap, f, &val))
+		return (0);
+	return (4u << val);
+}
+
+void
+print_header(const struct arm64id_snapshot *snap)
+{
+	const struct arm64id_field_desc *desc;
+	const struct arm64id_hwcap *cap;
+	const char *last;
+	size_t ncaps;
+	u_int dline, iline, dczva, word;
+	int64_t val;
+	int idx;
+
+	dline = header_line_size(snap, ARM64ID_CTR_EL0_DminLine);
+	iline = header_line_size(snap, ARM64ID_CTR_EL0_IminLine);
+	dczva = header_line_size(snap, ARM64ID_DCZID_EL0_BS);
+	/* DCZID_EL0.DZP set means DC ZVA is prohibited */
+	if (arm64id_field_get(snap, ARM64ID_DCZID_EL0_DZP, &val) && val != 0)
+		dczva = 0;
+
+	printf("/* Generated by arm64id -H, do not edit */\n\n");
+	printf("#ifndef\tARM64ID_SPEC_H\n#define\tARM64ID_SPEC_H\n");
+
+	printf("\n/* HWCAPs */\n");
+	for (word = 0; word < ARM64ID_NHWCAPS; word++) {
+		cap = arm64id_hwcap_list(word, &ncaps);
+		for (size_t i = 0; i < ncaps; i++) {
+			printf("#define\tARM64ID_HAVE_");
+			print_upper(cap[i].name);
+			printf("\t%d\n", header_have(snap, &cap[i], word));
+		}
+	}
+	for (size_t i = 0; i < nitems(header_aliases); i++) {
+		cap = arm64id_hwcap_lookup(header_aliases[i].hwcap, &word);
+		if (cap == NULL)
+			continue;
+		printf("#define\tARM64ID_HAVE_%s\t%d\n", header_aliases[i].name,
+		    header_have(snap, cap, word));
+	}
+
+	printf("\n/* Cache geometry in bytes, 0 if unknown */\n");
+	printf("#define\tARM64ID_DCACHE_LINE_SIZE\t%u\n", dline);
+	printf("#define\tARM64ID_ICACHE_LINE_SIZE\t%u\n", iline);
+	printf("#define\tARM64ID_DC_ZVA_SIZE\t%u\n", dczva);
+
+	printf("\n/* ID registers */\n");
+	for (u_int i = 0; i < snap->nregs; i++) {
+		if (!arm64id_reg_valid(snap, i) || arm64id_reg_volatile(i))
+			continue;
+		printf("#define\tARM64ID_REG_");
+		print_upper(arm64id_reg_name(i));
+		printf("\t0x%016"PRIx64"ULL\n", snap->regs[i]);
+	}
+
+	last = NULL;
+	for (u_int f = 0; f < ARM64ID_NFIELDS; f++) {
+		desc = arm64id_field_desc(f);
+		/* Skip fields that differ between CPUs, e.g. MPIDR_EL1 */
+		idx = arm64id_reg_index(desc->enc);
+		if ((idx >= 0 && arm64id_reg_volatile(idx)) ||
+		    !arm64id_field_get(snap, f, &val))
+			continue;
+		if (last == NULL || strcmp(last, desc->reg) != 0) {
+			printf("\n/* %s fields */\n", desc->reg);
+			last = desc->reg;
+		}
+		/* ARM64ID_<reg>_<name> is taken by enum arm64id_field */
+		printf("#define\tARM64ID_FIELD_");
+		print_upper(desc->reg);
+		putchar('_');
+		print_upper(desc->name);
+		printf("\t%"PRId64"\n", val);
+	}
+
+	printf("\n#ifdef __cplusplus\nnamespace arm64id_spec {\n");
+	for (word = 0; word < ARM64ID_NHWCAPS; word++) {
+		cap = arm64id_hwcap_list(word, &ncaps);
+		for (size_t i = 0; i < ncaps; i++) {
+			printf("static constexpr bool have_");
+			print_lower(cap[i].name);
+			printf(" = %s;\n",
+			    header_have(snap, &cap[i], word) ? "true" : "false");
+		}
+	}
+	for (size_t i = 0; i < nitems(header_aliases); i++) {
+		cap = arm64id_hwcap_lookup(header_aliases[i].hwcap, &word);
+		if (cap == NULL)
+			continue;
+		printf("static constexpr bool have_");
+		print_lower(header_aliases[i].name);
+		printf(" = %s;\n",
+		    header_have(snap, cap, word) ? "true" : "false");
+	}
+	printf("static constexpr unsigned dcache_line_size = %u;\n", dline);
+	printf("static constexpr unsigned icache_line_size = %u;\n", iline);
+	printf("static constexpr unsigned dc_zva_size = %u;\n", dczva);
+	printf("} /* namespace arm64id_spec */\n#endif\n");
+
+	printf("\n#endif /* !ARM64ID_SPEC_H */\n");
+}
@@ -0,0 +1,181 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+/*
+ * Read snapshots saved by arm64id, either binary records written with -o
+ * or the text output of the default mode.
+ */
+
+bool
+input_is_archive(const char *path)
+{
+	uint32_t magic;
+	ssize_t len;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return (false);
+	len = read(fd, &magic, sizeof(magic));
+	close(fd);
+	return (len == sizeof(magic) && magic == ARM64ID_RECORD_MAGIC);
+}
+
+static void
+input_snapshot_init(struct arm64id_snapshot *snap)
+{
+	memset(snap, 0, sizeof(*snap));
+	snap->version = ARM64ID_SNAPSHOT_VERSION;
+	snap->nregs = ARM64ID_NREGS;
+}
+
+/*
+ * Parse the text output of arm64id. A file may hold the output of many
+ * runs, e.g. from arm64id -i. A snapshot ends at a "host" line, a blank
+ * line or a "---" line, the registers and HWCAPs between them may be in
+ * any order.
+ */
+int
+input_parse_text(FILE *fp, snapshot_cb cb, void *arg)
+{
+	struct arm64id_snapshot snap;
+	char *line, *p, *name, *value, *end;
+	size_t linecap;
+	uint64_t reg;
+	int idx, word;
+	bool have;
+
+	input_snapshot_init(&snap);
+	have = false;
+	line = NULL;
+	linecap = 0;
+	while (getline(&line, &linecap, fp) > 0) {
+		p = line;
+		while (isspace((unsigned char)*p))
+			p++;
+
+		if (*p == '\0' || strncmp(p, "---", 3) == 0 ||
+		    strncmp(p, "host ", 5) == 0) {
+			if (have)
+				cb(&snap, arg);
+			input_snapshot_init(&snap);
+			have = false;
+			continue;
+		}
+
+		if (strncmp(p, "HWCAP", 5) == 0) {
+			p += 5;
+			word = 0;
+			if (*p >= '2' && *p <= '0' + ARM64ID_NHWCAPS)
+				word = *p++ - '1';
+			if (*p++ != ':')
+				continue;
+			reg = strtoull(p, &end, 16);
+			if (end == p)
+				continue;
+			snap.hwcaps[word] = reg;
+			snap.hwcap_valid |= 1u << word;
+			have = true;
+			continue;
+		}
+
+		value = strstr(p, " = ");
+		if (value == NULL)
+			continue;
+		*value = '\0';
+		value += 3;
+		name = p;
+		idx = arm64id_reg_lookup(name);
+		if (idx < 0)
+			continue;
+		have = true;
+
+		if (strncmp(value, "0x", 2) != 0)
+			continue;
+		reg = strtoull(value, &end, 16);
+		if (end == value)
+			continue;
+		snap.regs[idx] = reg;
+		snap.reg_valid[idx / 64] |= (uint64_t)1 << (idx % 64);
+	}
+	free(line);
+
+	if (have)
+		cb(&snap, arg);
+	return (ferror(fp) ? EIO : 0);
+}
+
+/*
+ * Call cb for each snapshot in path. "-" reads text from stdin.
+ */
+int
+input_load(const char *path, snapshot_cb cb, void *arg)
+{
+	struct arm64id_archive ar;
+	const struct arm64id_record *rec;
+	FILE *fp;
+	int error;
+
+	if (strcmp(path, "-") == 0)
+		return (input_parse_text(stdin, cb, arg));
+
+	if (input_is_archive(path)) {
+		error = arm64id_archive_open(path, &ar);
+		if (error != 0)
+			return (error);
+		ARM64ID_ARCHIVE_FOREACH(rec, &ar) {
+			if (arm64id_record_valid(rec))
+				cb(&rec->snap, arg);
+		}
+		arm64id_archive_close(&ar);
+		return (0);
+	}
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return (errno);
+	error = input_parse_text(fp, cb, arg);
+	fclose(fp);
+	return (error);
+}
@@ -0,0 +1,1059 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Andrew Turner
+ * All rights reserved.
+ *
+ * This software was developed by SRI International and the University of
+ * Cambridge Computer Laboratory under DARPA/AFRL contract FA8750-10-C-0237
+ * ("CTSRD"), as part of the DARPA CRASH research programme.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef __linux__
+#define	_GNU_SOURCE	/* For sched_getcpu */
+#endif
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#if !defined(__APPLE__) && !defined(__NetBSD__)
+#include <sys/auxv.h>
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "hwcaps.h"
+#include "linker_set.h"
+
+typedef int (*special_reg_read)(uint64_t *);
+
+struct special_reg {
+	const char *reg_name;
+	const char *alias;
+	special_reg_read reader;
+	uint64_t hwcap;
+	uint8_t op1;
+	uint8_t crn;
+	uint8_t crm;
+	uint8_t op2;
+	uint8_t flags;
+	uint8_t hwcap_word;
+};
+
+#define	REG_F_VOLATILE	0x01	/* Changes between reads or CPUs */
+#define	REG_F_SYSFS	0x02	/* In Linux regs/identification/<alias> */
+
+LS_SET_DECLARE(special_reg, struct special_reg);
+
+/*
+ * The jump buffer of the probe running on the current thread, or NULL when
+ * the thread isn't probing. The signal handler uses this to decide if it
+ * should recover from the fault or pass it on to the previous handler.
+ */
+static __thread sigjmp_buf *volatile probe_jmpbuf;
+
+#ifdef __aarch64__
+#define	PROBE_CAN_READ	true
+#define _SPECIAL_REGISTER_READER(name)				\
+static int							\
+get_##name(uint64_t *res)					\
+{								\
+	sigjmp_buf jb;						\
+	uint64_t tmp;						\
+	int ret;						\
+								\
+	ret = sigsetjmp(jb, 1);					\
+	if (ret == 0) {						\
+		probe_jmpbuf = &jb;				\
+		asm volatile(					\
+		"	mrs	%0, "__STRING(name)"	\n"	\
+		"	str	%0, [%1]		\n"	\
+		: "+r"(tmp): "r"(res): "memory");		\
+	}							\
+	probe_jmpbuf = NULL;					\
+	return (ret);						\
+}
+#else
+/*
+ * Other architectures only use the register names and encodings, e.g. to
+ * read saved snapshots, so the readers always fail.
+ */
+#define	PROBE_CAN_READ	false
+#define _SPECIAL_REGISTER_READER(name)				\
+static int							\
+get_##name(uint64_t *res)					\
+{								\
+	(void)res;						\
+	return (1);						\
+}
+#endif
+
+/*
+ * Per-register metadata, bound to the linker set entry at compile time so
+ * looking it up doesn't need a table search. Registers without a
+ * REG_META_<name> definition get the default from REG_META. The values are
+ * the alias, REG_F_* flags, and the HWCAP word and bit that must be set for
+ * the register to be readable, or 0 if it doesn't depend on a HWCAP.
+ */
+#define	REG_META_DEF(...)	~, (__VA_ARGS__)
+
+#define	REG_META_S3_0_C0_C0_0 REG_META_DEF("midr_el1", REG_F_SYSFS, 0, 0)
+#define	REG_META_S3_0_C0_C0_5 REG_META_DEF("mpidr_el1", REG_F_VOLATILE, 0, 0)
+#define	REG_META_S3_0_C0_C0_6 REG_META_DEF("revidr_el1", REG_F_SYSFS, 0, 0)
+
+#define	REG_META_S3_0_C0_C1_0 REG_META_DEF("id_pfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_1 REG_META_DEF("id_pfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_2 REG_META_DEF("id_dfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_3 REG_META_DEF("id_afr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_4 REG_META_DEF("id_mmfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_5 REG_META_DEF("id_mmfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_6 REG_META_DEF("id_mmfr2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C1_7 REG_META_DEF("id_mmfr3_el1", 0, 0, 0)
+
+#define	REG_META_S3_0_C0_C2_0 REG_META_DEF("id_isar0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_1 REG_META_DEF("id_isar1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_2 REG_META_DEF("id_isar2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_3 REG_META_DEF("id_isar3_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_4 REG_META_DEF("id_isar4_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_5 REG_META_DEF("id_isar5_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_6 REG_META_DEF("id_mmfr4_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C2_7 REG_META_DEF("id_isar6_el1", 0, 0, 0)
+
+#define	REG_META_S3_0_C0_C3_0 REG_META_DEF("mvfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C3_1 REG_META_DEF("mvfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C3_2 REG_META_DEF("mvfr2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C3_4 REG_META_DEF("id_pfr2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C3_5 REG_META_DEF("id_dfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C3_6 REG_META_DEF("id_mmfr5_el1", 0, 0, 0)
+
+#define	REG_META_S3_0_C0_C4_0 REG_META_DEF("id_aa64pfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C4_1 REG_META_DEF("id_aa64pfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C4_2 REG_META_DEF("id_aa64pfr2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C4_4 REG_META_DEF("id_aa64zfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C4_5 REG_META_DEF("id_aa64smfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C4_7 REG_META_DEF("id_aa64fpfr0_el1", 0, 0, 0)
+
+#define	REG_META_S3_0_C0_C5_0 REG_META_DEF("id_aa64dfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C5_1 REG_META_DEF("id_aa64dfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C5_2 REG_META_DEF("id_aa64dfr2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C5_4 REG_META_DEF("id_aa64afr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C5_5 REG_META_DEF("id_aa64afr1_el1", 0, 0, 0)
+
+#define	REG_META_S3_0_C0_C6_0 REG_META_DEF("id_aa64isar0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C6_1 REG_META_DEF("id_aa64isar1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C6_2 REG_META_DEF("id_aa64isar2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C6_3 REG_META_DEF("id_aa64isar3_el1", 0, 0, 0)
+
+#define	REG_META_S3_0_C0_C7_0 REG_META_DEF("id_aa64mmfr0_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C7_1 REG_META_DEF("id_aa64mmfr1_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C7_2 REG_META_DEF("id_aa64mmfr2_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C7_3 REG_META_DEF("id_aa64mmfr3_el1", 0, 0, 0)
+#define	REG_META_S3_0_C0_C7_4 REG_META_DEF("id_aa64mmfr4_el1", 0, 0, 0)
+
+#define	REG_META_S3_3_C0_C0_1 REG_META_DEF("ctr_el0", 0, 0, 0)
+#define	REG_META_S3_3_C0_C0_7 REG_META_DEF("dczid_el0", 0, 0, 0)
+
+#define	REG_META_S3_3_C2_C4_0						\
+    REG_META_DEF("rndr", REG_F_VOLATILE, 1, HWCAP2_RNG)
+#define	REG_META_S3_3_C2_C4_1						\
+    REG_META_DEF("rndrrs", REG_F_VOLATILE, 1, HWCAP2_RNG)
+
+#define	REG_META_S3_3_C4_C2_0 REG_META_DEF("nzcv", 0, 0, 0)
+#define	REG_META_S3_3_C4_C2_1 REG_META_DEF("daif", 0, 0, 0)
+#define	REG_META_S3_3_C4_C2_2 REG_META_DEF("svcr", 0, 1, HWCAP2_SME)
+#define	REG_META_S3_3_C4_C2_5 REG_META_DEF("dit", 0, 0, HWCAP_DIT)
+#define	REG_META_S3_3_C4_C2_6 REG_META_DEF("ssbs", 0, 0, HWCAP_SSBS)
+#define	REG_META_S3_3_C4_C2_7 REG_META_DEF("tco", 0, 1, HWCAP2_MTE)
+
+#define	REG_META_S3_3_C14_C0_0 REG_META_DEF("cntfrq_el0", 0, 0, 0)
+#define	REG_META_S3_3_C14_C0_1 REG_META_DEF("cntpct_el0", REG_F_VOLATILE, 0, 0)
+#define	REG_META_S3_3_C14_C0_2 REG_META_DEF("cntvct_el0", REG_F_VOLATILE, 0, 0)
+#define	REG_META_S3_3_C14_C0_5						\
+    REG_META_DEF("cntpctss_el0", REG_F_VOLATILE, 1, HWCAP2_ECV)
+#define	REG_META_S3_3_C14_C0_6						\
+    REG_META_DEF("cntvctss_el0", REG_F_VOLATILE, 1, HWCAP2_ECV)
+
+#define	REG_META_S3_3_C14_C2_0						\
+    REG_META_DEF("cntp_tval_el0", REG_F_VOLATILE, 0, 0)
+#define	REG_META_S3_3_C14_C2_1 REG_META_DEF("cntp_ctl_el0", 0, 0, 0)
+#define	REG_META_S3_3_C14_C2_2 REG_META_DEF("cntp_cval_el0", 0, 0, 0)
+
+#define	REG_META_S3_3_C14_C3_0						\
+    REG_META_DEF("cntv_tval_el0", REG_F_VOLATILE, 0, 0)
+#define	REG_META_S3_3_C14_C3_1 REG_META_DEF("cntv_ctl_el0", 0, 0, 0)
+#define	REG_META_S3_3_C14_C3_2 REG_META_DEF("cntv_cval_el0", 0, 0, 0)
+
+#define	REG_META_PICK(ignored, meta, ...)	meta
+#define	REG_META_PICK1(args)	REG_META_PICK args
+#define	REG_META(name)							\
+    REG_META_PICK1((REG_META_ ## name, (NULL, 0, 0, 0), ~))
+#define	REG_META_INIT(_alias, _flags, _word, _hwcap)			\
+	.alias = _alias,						\
+	.flags = _flags,						\
+	.hwcap_word = _word,						\
+	.hwcap = _hwcap
+#define	REG_META_APPLY(m, args)	m args
+
+#define _SPECIAL_REGISTER(name, _op1, n, m, _op2)		\
+_SPECIAL_REGISTER_READER(name)					\
+static struct special_reg name ## _entry = {			\
+	.reg_name = LS_XSTRING(name),				\
+	.reader = get_ ## name,					\
+	.op1 = _op1,						\
+	.crn = n,						\
+	.crm = m,						\
+	.op2 = _op2,						\
+	REG_META_APPLY(REG_META_INIT, REG_META(name)),		\
+};								\
+LS_DATA_SET(special_reg, name ## _entry)
+
+#define SPECIAL_REGISTER(op1, n, m, op2)				\
+    _SPECIAL_REGISTER(S3_ ## op1 ## _C ## n ## _C ## m ## _ ## op2,	\
+    op1, n, m, op2)
+
+#define SPECIAL_REGISTER_GROUP(op1, n, m)				\
+SPECIAL_REGISTER(op1, n, m, 0);						\
+SPECIAL_REGISTER(op1, n, m, 1);						\
+SPECIAL_REGISTER(op1, n, m, 2);						\
+SPECIAL_REGISTER(op1, n, m, 3);						\
+SPECIAL_REGISTER(op1, n, m, 4);						\
+SPECIAL_REGISTER(op1, n, m, 5);						\
+SPECIAL_REGISTER(op1, n, m, 6);						\
+SPECIAL_REGISTER(op1, n, m, 7)
+
+SPECIAL_REGISTER_GROUP(0, 0, 0);
+SPECIAL_REGISTER_GROUP(0, 0, 1);
+SPECIAL_REGISTER_GROUP(0, 0, 2);
+SPECIAL_REGISTER_GROUP(0, 0, 3);
+SPECIAL_REGISTER_GROUP(0, 0, 4);
+SPECIAL_REGISTER_GROUP(0, 0, 5);
+SPECIAL_REGISTER_GROUP(0, 0, 6);
+SPECIAL_REGISTER_GROUP(0, 0, 7);
+
+SPECIAL_REGISTER_GROUP(3, 0, 0);
+SPECIAL_REGISTER_GROUP(3, 2, 4);
+SPECIAL_REGISTER_GROUP(3, 4, 2);
+SPECIAL_REGISTER_GROUP(3, 14, 0);
+SPECIAL_REGISTER_GROUP(3, 14, 2);
+SPECIAL_REGISTER_GROUP(3, 14, 3);
+
+#ifndef nitems
+#define	nitems(x)	(sizeof(x)/sizeof(x[0]))
+#endif
+
+static const struct arm64id_hwcap hwcaps[] = {
+#define	HWCAP(cap) { LS_XSTRING(cap), HWCAP_ ## cap }
+	HWCAP(FP),
+	HWCAP(ASIMD),
+	HWCAP(EVTSTRM),
+	HWCAP(AES),
+	HWCAP(PMULL),
+	HWCAP(SHA1),
+	HWCAP(SHA2),
+	HWCAP(CRC32),
+	HWCAP(ATOMICS),
+	HWCAP(FPHP),
+	HWCAP(ASIMDHP),
+	HWCAP(CPUID),
+	HWCAP(ASIMDRDM),
+	HWCAP(JSCVT),
+	HWCAP(FCMA),
+	HWCAP(LRCPC),
+	HWCAP(DCPOP),
+	HWCAP(SHA3),
+	HWCAP(SM3),
+	HWCAP(SM4),
+	HWCAP(ASIMDDP),
+	HWCAP(SHA512),
+	HWCAP(SVE),
+	HWCAP(ASIMDFHM),
+	HWCAP(DIT),
+	HWCAP(USCAT),
+	HWCAP(ILRCPC),
+	HWCAP(FLAGM),
+	HWCAP(SSBS),
+	HWCAP(SB),
+	HWCAP(PACA),
+	HWCAP(PACG),
+	HWCAP(GCS),
+	HWCAP(CMPBR),
+	HWCAP(FPRCVT),
+	HWCAP(F8MM8),
+	HWCAP(F8MM4),
+	HWCAP(SVE_F16MM),
+	HWCAP(SVE_ELTPERM),
+	HWCAP(SVE_AES2),
+	HWCAP(SVE_BFSCALE),
+	HWCAP(SVE2P2),
+	HWCAP(SME2P2),
+	HWCAP(SME_SBITPERM),
+	HWCAP(SME_AES),
+	HWCAP(SME_SFEXPA),
+	HWCAP(SME_STMOP),
+	HWCAP(SME_SMOP4),
+#undef HWCAP
+};
+
+static const struct arm64id_hwcap hwcaps2[] = {
+#define	HWCAP(cap) { LS_XSTRING(cap), HWCAP2_ ## cap }
+	HWCAP(DCPODP),
+	HWCAP(SVE2),
+	HWCAP(SVEAES),
+	HWCAP(SVEPMULL),
+	HWCAP(SVEBITPERM),
+	HWCAP(SVESHA3),
+	HWCAP(SVESM4),
+	HWCAP(FLAGM2),
+	HWCAP(FRINT),
+	HWCAP(SVEI8MM),
+	HWCAP(SVEF32MM),
+	HWCAP(SVEF64MM),
+	HWCAP(SVEBF16),
+	HWCAP(I8MM),
+	HWCAP(BF16),
+	HWCAP(DGH),
+	HWCAP(RNG),
+	HWCAP(BTI),
+	HWCAP(MTE),
+	HWCAP(ECV),
+	HWCAP(AFP),
+	HWCAP(RPRES),
+	HWCAP(MTE3),
+	HWCAP(SME),
+	HWCAP(SME_I16I64),
+	HWCAP(SME_F64F64),
+	HWCAP(SME_I8I32),
+	HWCAP(SME_F16F32),
+	HWCAP(SME_B16F32),
+	HWCAP(SME_F32F32),
+	HWCAP(SME_FA64),
+	HWCAP(WFXT),
+	HWCAP(EBF16),
+	HWCAP(SVE_EBF16),
+	HWCAP(CSSC),
+	HWCAP(RPRFM),
+	HWCAP(SVE2P1),
+	HWCAP(SME2),
+	HWCAP(SME2P1),
+	HWCAP(SME_I16I32),
+	HWCAP(SME_BI32I32),
+	HWCAP(SME_B16B16),
+	HWCAP(SME_F16F16),
+	HWCAP(MOPS),
+	HWCAP(HBC),
+	HWCAP(SVE_B16B16),
+	HWCAP(LRCPC3),
+	HWCAP(LSE128),
+	HWCAP(FPMR),
+	HWCAP(LUT),
+	HWCAP(FAMINMAX),
+	HWCAP(F8CVT),
+	HWCAP(F8FMA),
+	HWCAP(F8DP4),
+	HWCAP(F8DP2),
+	HWCAP(F8E4M3),
+	HWCAP(F8E5M2),
+	HWCAP(SME_LUTV2),
+	HWCAP(SME_F8F16),
+	HWCAP(SME_F8F32),
+	HWCAP(SME_SF8FMA),
+	HWCAP(SME_SF8DP4),
+	HWCAP(SME_SF8DP2),
+	HWCAP(POE),
+#undef HWCAP
+};
+
+static const struct arm64id_hwcap hwcaps3[] = {
+#define	HWCAP(cap) { LS_XSTRING(cap), HWCAP3_ ## cap }
+	HWCAP(MTE_FAR),
+	HWCAP(MTE_STORE_ONLY),
+	HWCAP(LSFE),
+	HWCAP(LS64),
+#undef HWCAP
+};
+
+static const struct arm64id_hwcap hwcaps4[] = {
+};
+
+static const struct {
+	const struct arm64id_hwcap *list;
+	size_t count;
+} hwcap_lists[ARM64ID_NHWCAPS] = {
+	{ hwcaps,  nitems(hwcaps) },
+	{ hwcaps2, nitems(hwcaps2) },
+	{ hwcaps3, nitems(hwcaps3) },
+	{ hwcaps4, nitems(hwcaps4) },
+};
+
+/*
+ * The linker set is in whatever order the compiler and linker emit it. The
+ * snapshot, and so the binary record format, uses the registers sorted by
+ * their encoding so the layout doesn't depend on the toolchain.
+ */
+static pthread_once_t reg_table_once = PTHREAD_ONCE_INIT;
+static const struct special_reg *reg_table[ARM64ID_NREGS];
+static bool reg_table_valid;
+
+/*
+ * Open addressing hash of both the alias and system register name of each
+ * register to its index in reg_table. Names are hashed case-insensitively.
+ */
+#define	REG_HASH_SIZE	512	/* Power of 2, at least 4 * ARM64ID_NREGS */
+static const char *reg_hash_name[REG_HASH_SIZE];
+static uint8_t reg_hash_idx[REG_HASH_SIZE];
+
+static pthread_once_t snapshot_once = PTHREAD_ONCE_INIT;
+static struct arm64id_snapshot snapshot;
+static int snapshot_error;
+
+/*
+ * The SIGILL/SIGBUS handlers are installed while at least one thread is
+ * probing. The handlers that were installed before are saved so they can
+ * be restored by the last thread to finish, and so faults from threads
+ * that aren't probing can be passed on to them.
+ */
+static pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;
+static u_int probe_users;
+/* Set while the current thread is counted in probe_users */
+static __thread bool probe_active;
+static struct sigaction old_sigill;
+static struct sigaction old_sigbus;
+
+/*
+ * The fault codes, e.g. ILL_ILLOPC or BUS_ADRALN, are small positive
+ * values on every supported OS. Signals sent with kill(2) and friends use
+ * SI_USER, SI_QUEUE, etc. that are outside this range.
+ */
+static bool
+sigill_is_fault(const siginfo_t *info)
+{
+	return (info != NULL && info->si_code > 0 && info->si_code <= 16);
+}
+
+static void
+sigill(int signo, siginfo_t *info, void *ctx)
+{
+	struct sigaction *old, dfl;
+	struct timespec ts;
+	sigjmp_buf *jb;
+	u_int self;
+
+	/* Signals sent with kill(2) while probing aren't from the probe */
+	jb = probe_jmpbuf;
+	if (jb != NULL && sigill_is_fault(info))
+		siglongjmp(*jb, 1);
+
+	/* Not from a probe, hand it to the previous handler */
+	old = signo == SIGBUS ? &old_sigbus : &old_sigill;
+	if ((old->sa_flags & SA_SIGINFO) != 0) {
+		old->sa_sigaction(signo, info, ctx);
+		return;
+	}
+	if (old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN) {
+		old->sa_handler(signo);
+		return;
+	}
+	/* An ignored signal from kill(2) can be dropped */
+	if (old->sa_handler == SIG_IGN && !sigill_is_fault(info))
+		return;
+
+	/*
+	 * Otherwise this is fatal, either the default action or a fault that
+	 * would restart forever if ignored. Wait for any other threads to
+	 * finish probing, as resetting the action would kill them on their
+	 * next expected fault, then die from the default action. This thread
+	 * may itself be between probe_begin and probe_end so isn't waited
+	 * for. The signal is blocked in the handler so is delivered when it
+	 * returns.
+	 */
+	self = probe_active ? 1 : 0;
+	ts.tv_sec = 0;
+	ts.tv_nsec = 1000000;
+	while (__atomic_load_n(&probe_users, __ATOMIC_ACQUIRE) > self)
+		nanosleep(&ts, NULL);
+	memset(&dfl, 0, sizeof(dfl));
+	sigemptyset(&dfl.sa_mask);
+	dfl.sa_handler = SIG_DFL;
+	sigaction(signo, &dfl, NULL);
+	raise(signo);
+}
+
+/* Restore the saved action, unless the host replaced ours while probing */
+static void
+sigill_restore(int signo, const struct sigaction *old)
+{
+	struct sigaction cur;
+
+	if (sigaction(signo, NULL, &cur) != 0 ||
+	    (cur.sa_flags & SA_SIGINFO) == 0 || cur.sa_sigaction != sigill)
+		return;
+	sigaction(signo, old, NULL);
+}
+
+static int
+probe_begin(void)
+{
+	struct sigaction act;
+	int error;
+
+	error = 0;
+	pthread_mutex_lock(&probe_lock);
+	if (probe_users == 0) {
+		memset(&act, 0, sizeof(act));
+		sigemptyset(&act.sa_mask);
+		act.sa_sigaction = sigill;
+		act.sa_flags = SA_SIGINFO;
+
+		if (sigaction(SIGILL, &act, &old_sigill) != 0) {
+			error = errno;
+			goto out;
+		}
+		/* Reading SME registers may raise SIGBUS on FreeBSD 14 */
+		if (sigaction(SIGBUS, &act, &old_sigbus) != 0) {
+			error = errno;
+			sigaction(SIGILL, &old_sigill, NULL);
+			goto out;
+		}
+	}
+	/* Set before counting so the handler never waits for itself */
+	probe_active = true;
+	__atomic_store_n(&probe_users, probe_users + 1, __ATOMIC_RELEASE);
+out:
+	pthread_mutex_unlock(&probe_lock);
+	return (error);
+}
+
+static void
+probe_end(void)
+{
+	pthread_mutex_lock(&probe_lock);
+	if (probe_users == 1) {
+		sigill_restore(SIGBUS, &old_sigbus);
+		sigill_restore(SIGILL, &old_sigill);
+	}
+	__atomic_store_n(&probe_users, probe_users - 1, __ATOMIC_RELEASE);
+	probe_active = false;
+	pthread_mutex_unlock(&probe_lock);
+}
+
+/* No HWCAP support on Mac or NetBSD (at least not in 2026) */
+#if !defined(__APPLE__) && !defined(__NetBSD__)
+static const int hwcap_types[ARM64ID_NHWCAPS] = {
+	AT_HWCAP,
+	AT_HWCAP2,
+#ifdef AT_HWCAP3
+	AT_HWCAP3,
+#else
+	-1,
+#endif
+#ifdef AT_HWCAP4
+	AT_HWCAP4,
+#else
+	-1,
+#endif
+};
+
+static bool
+get_caps(int cap, unsigned long *caps)
+{
+#if defined(__FreeBSD__) || defined(__OpenBSD__)
+	return (elf_aux_info(cap, caps, sizeof(*caps)) == 0);
+#elif defined(__linux__)
+	*caps = getauxval(cap);
+	return (true);
+#else
+#error Unknown OS
+#endif
+}
+#endif /* !__APPLE__ && !__NetBSD__ */
+
+static void
+snapshot_hwcaps(struct arm64id_snapshot *snap)
+{
+#if !defined(__APPLE__) && !defined(__NetBSD__)
+	unsigned long caps;
+
+	for (u_int i = 0; i < ARM64ID_NHWCAPS; i++) {
+		if (hwcap_types[i] == -1)
+			continue;
+		if (!get_caps(hwcap_types[i], &caps))
+			continue;
+		snap->hwcaps[i] = caps;
+		snap->hwcap_valid |= 1u << i;
+	}
+#else
+	(void)snap;
+#endif
+}
+
+static uint32_t
+reg_encoding(const struct special_reg *sr)
+{
+	return (ARM64ID_ENC(sr->op1, sr->crn, sr->crm, sr->op2));
+}
+
+static int
+reg_compare(const void *a, const void *b)
+{
+	uint32_t ea, eb;
+
+	ea = reg_encoding(*(const struct special_reg * const *)a);
+	eb = reg_encoding(*(const struct special_reg * const *)b);
+	return (ea < eb ? -1 : ea > eb);
+}
+
+static uint32_t
+reg_hash(const char *name)
+{
+	uint32_t hash;
+
+	hash = 2166136261u;
+	for (; *name != '\0'; name++) {
+		hash ^= (uint8_t)tolower((unsigned char)*name);
+		hash *= 16777619u;
+	}
+	return (hash);
+}
+
+static void
+reg_hash_insert(const char *name, u_int idx)
+{
+	uint32_t slot;
+
+	slot = reg_hash(name) & (REG_HASH_SIZE - 1);
+	while (reg_hash_name[slot] != NULL)
+		slot = (slot + 1) & (REG_HASH_SIZE - 1);
+	reg_hash_name[slot] = name;
+	reg_hash_idx[slot] = idx;
+}
+
+static void
+reg_table_init(void)
+{
+	struct special_reg **sr;
+	u_int idx;
+
+	_Static_assert(ARM64ID_NREGS <= UINT8_MAX, "reg_hash_idx is too small");
+	_Static_assert(REG_HASH_SIZE >= 4 * ARM64ID_NREGS,
+	    "REG_HASH_SIZE is too small");
+
+	if (LS_SET_COUNT(special_reg) != ARM64ID_NREGS)
+		return;
+
+	idx = 0;
+	LS_SET_FOREACH(sr, special_reg)
+		reg_table[idx++] = *sr;
+	qsort(reg_table, ARM64ID_NREGS, sizeof(reg_table[0]), reg_compare);
+
+	for (idx = 0; idx < ARM64ID_NREGS; idx++) {
+		reg_hash_insert(reg_table[idx]->reg_name, idx);
+		if (reg_table[idx]->alias != NULL)
+			reg_hash_insert(reg_table[idx]->alias, idx);
+	}
+	reg_table_valid = true;
+}
+
+static const struct special_reg *
+reg_lookup(u_int idx)
+{
+	pthread_once(&reg_table_once, reg_table_init);
+	if (!reg_table_valid || idx >= ARM64ID_NREGS)
+		return (NULL);
+	return (reg_table[idx]);
+}
+
+/*
+ * The ID registers, op0 == 3, op1 == 0, CRn == 0, can't be read from EL0.
+ * The kernel will emulate reading them when HWCAP_CPUID is set, otherwise
+ * they raise SIGILL.
+ */
+static bool
+reg_is_emulated(const struct special_reg *sr)
+{
+	return (sr->op1 == 0 && sr->crn == 0);
+}
+
+static bool
+reg_read_sysfs(int cpu, const char *file, uint64_t *res)
+{
+#ifdef __linux__
+	char path[128], buf[32], *end;
+	ssize_t len;
+	int fd;
+
+	if (cpu < 0)
+		return (false);
+
+	snprintf(path, sizeof(path),
+	    "/sys/devices/system/cpu/cpu%d/regs/identification/%s", cpu, file);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return (false);
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return (false);
+	buf[len] = '\0';
+
+	*res = strtoull(buf, &end, 16);
+	return (end != buf && (*end == '\n' || *end == '\0'));
+#else
+	(void)cpu;
+	(void)file;
+	(void)res;
+	return (false);
+#endif
+}
+
+static int
+probe_cpu(void)
+{
+#ifdef __linux__
+	return (sched_getcpu());
+#else
+	return (-1);
+#endif
+}
+
+/*
+ * Read the registers for arm64id_probe_regs. The sysfs values are read for
+ * cpu, or not at all when it is -1.
+ */
+static void
+probe_regs_read(struct arm64id_snapshot *snap,
+    const struct arm64id_regset *set, bool fast, bool cpuid, int cpu,
+    struct arm64id_probe_stats *st)
+{
+	const struct special_reg *sr;
+	uint64_t reg;
+	u_int idx;
+
+	for (idx = 0; idx < ARM64ID_NREGS; idx++) {
+		if (set != NULL && !arm64id_regset_isset(set, idx))
+			continue;
+		sr = reg_table[idx];
+		if (fast && (sr->flags & REG_F_SYSFS) != 0 &&
+		    reg_read_sysfs(cpu, sr->alias, &reg)) {
+			st->sysfs++;
+		} else if (fast && reg_is_emulated(sr) && !cpuid) {
+			st->skipped++;
+			continue;
+		} else if (fast && sr->hwcap != 0 &&
+		    arm64id_hwcap_valid(snap, sr->hwcap_word) &&
+		    (snap->hwcaps[sr->hwcap_word] & sr->hwcap) == 0) {
+			st->skipped++;
+			continue;
+		} else {
+			st->mrs++;
+			if (sr->reader(&reg) != 0) {
+				st->faulted++;
+				continue;
+			}
+		}
+		snap->regs[idx] = reg;
+		snap->reg_valid[idx / 64] |= (uint64_t)1 << (idx % 64);
+	}
+}
+
+/*
+ * Read the registers in set on the current thread, or all registers if set
+ * is NULL. Registers not in the set are never read so can't trap. This is
+ * safe to call from multiple threads at once, the callers signal handlers
+ * are restored once all threads have finished probing.
+ *
+ * With ARM64ID_PROBE_FAST values are taken from sysfs where possible, and
+ * registers that are known to fault from the HWCAP values are skipped.
+ */
+int
+arm64id_probe_regs(struct arm64id_snapshot *snap,
+    const struct arm64id_regset *set, int flags,
+    struct arm64id_probe_stats *stats)
+{
+	struct arm64id_probe_stats st;
+	int cpu, error;
+	bool fast, cpuid;
+
+	if (!PROBE_CAN_READ)
+		return (EOPNOTSUPP);
+	if (reg_lookup(0) == NULL)
+		return (EINVAL);
+
+	memset(snap, 0, sizeof(*snap));
+	snap->version = ARM64ID_SNAPSHOT_VERSION;
+	snap->nregs = ARM64ID_NREGS;
+	snapshot_hwcaps(snap);
+
+	memset(&st, 0, sizeof(st));
+	fast = (flags & ARM64ID_PROBE_FAST) != 0;
+	/* Without the HWCAP values assume the kernel emulates the ID regs */
+	cpuid = !arm64id_hwcap_valid(snap, 0) ||
+	    (snap->hwcaps[0] & HWCAP_CPUID) != 0;
+	cpu = fast ? probe_cpu() : -1;
+
+	error = probe_begin();
+	if (error != 0)
+		return (error);
+
+	probe_regs_read(snap, set, fast, cpuid, cpu, &st);
+	/*
+	 * The sysfs values are from the CPU we started on. If the thread has
+	 * moved since they may be mixed with mrs reads from another CPU, so
+	 * read everything again from the current CPU.
+	 */
+	if (cpu >= 0 && st.sysfs != 0 && probe_cpu() != cpu) {
+		memset(snap->reg_valid, 0, sizeof(snap->reg_valid));
+		memset(snap->regs, 0, sizeof(snap->regs));
+		memset(&st, 0, sizeof(st));
+		probe_regs_read(snap, set, fast, cpuid, -1, &st);
+	}
+
+	probe_end();
+
+	if (stats != NULL)
+		*stats = st;
+	return (0);
+}
+
+int
+arm64id_probe_flags(struct arm64id_snapshot *snap, int flags,
+    struct arm64id_probe_stats *stats)
+{
+	return (arm64id_probe_regs(snap, NULL, flags, stats));
+}
+
+int
+arm64id_probe(struct arm64id_snapshot *snap)
+{
+	return (arm64id_probe_flags(snap, 0, NULL));
+}
+
+static void
+snapshot_init(void)
+{
+	snapshot_error = arm64id_probe(&snapshot);
+}
+
+/*
+ * Return a pointer to the process-wide snapshot. The registers are only
+ * read the first time this is called, later calls return the same data.
+ */
+const struct arm64id_snapshot *
+arm64id_snapshot_get(void)
+{
+	pthread_once(&snapshot_once, snapshot_init);
+	if (snapshot_error != 0) {
+		errno = snapshot_error;
+		return (NULL);
+	}
+	return (&snapshot);
+}
+
+int
+arm64id_snapshot(struct arm64id_snapshot *snap)
+{
+	const struct arm64id_snapshot *cur;
+
+	cur = arm64id_snapshot_get();
+	if (cur == NULL)
+		return (errno);
+	memcpy(snap, cur, sizeof(*snap));
+	return (0);
+}
+
+const char *
+arm64id_reg_sysname(u_int idx)
+{
+	const struct special_reg *sr;
+
+	sr = reg_lookup(idx);
+	if (sr == NULL)
+		return (NULL);
+	return (sr->reg_name);
+}
+
+const char *
+arm64id_reg_name(u_int idx)
+{
+	const struct special_reg *sr;
+
+	sr = reg_lookup(idx);
+	if (sr == NULL)
+		return (NULL);
+	return (sr->alias != NULL ? sr->alias : sr->reg_name);
+}
+
+/*
+ * Return the op1/CRn/CRm/op2 encoding of a register, decode it with the
+ * ARM64ID_ENC_* macros.
+ */
+uint32_t
+arm64id_reg_encoding(u_int idx)
+{
+	const struct special_reg *sr;
+
+	sr = reg_lookup(idx);
+	if (sr == NULL)
+		return (0);
+	return (reg_encoding(sr));
+}
+
+/*
+ * Find the index of a register from its encoding, or -1 if it isn't in the
+ * snapshot.
+ */
+int
+arm64id_reg_index(uint32_t enc)
+{
+	u_int lo, hi, mid;
+	uint32_t cur;
+
+	if (reg_lookup(0) == NULL)
+		return (-1);
+
+	lo = 0;
+	hi = ARM64ID_NREGS;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cur = reg_encoding(reg_table[mid]);
+		if (cur == enc)
+			return (mid);
+		if (cur < enc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (-1);
+}
+
+/*
+ * Find the index of a register from either its alias, e.g. id_aa64isar0_el1,
+ * or its system register name, e.g. S3_0_C0_C6_0. The name is matched
+ * case-insensitively. Returns -1 if there is no such register.
+ */
+int
+arm64id_reg_lookup(const char *name)
+{
+	uint32_t slot;
+
+	if (reg_lookup(0) == NULL)
+		return (-1);
+
+	slot = reg_hash(name) & (REG_HASH_SIZE - 1);
+	while (reg_hash_name[slot] != NULL) {
+		if (strcasecmp(reg_hash_name[slot], name) == 0)
+			return (reg_hash_idx[slot]);
+		slot = (slot + 1) & (REG_HASH_SIZE - 1);
+	}
+	return (-1);
+}
+
+/*
+ * Add the registers matching pattern to set. The pattern is either a name
+ * as accepted by arm64id_reg_lookup, or a shell glob, e.g. id_aa64isar*,
+ * matched against both names. Returns the number of registers that matched.
+ */
+u_int
+arm64id_regset_add(struct arm64id_regset *set, const char *pattern)
+{
+	const struct special_reg *sr;
+	u_int count;
+	int idx;
+
+	if (reg_lookup(0) == NULL)
+		return (0);
+
+	idx = arm64id_reg_lookup(pattern);
+	if (idx >= 0) {
+		set->bits[idx / 64] |= (uint64_t)1 << (idx % 64);
+		return (1);
+	}
+	if (strpbrk(pattern, "*?[") == NULL)
+		return (0);
+
+	count = 0;
+	for (idx = 0; idx < ARM64ID_NREGS; idx++) {
+		sr = reg_table[idx];
+		if (fnmatch(pattern, sr->reg_name, FNM_CASEFOLD) != 0 &&
+		    (sr->alias == NULL ||
+		    fnmatch(pattern, sr->alias, FNM_CASEFOLD) != 0))
+			continue;
+		set->bits[idx / 64] |= (uint64_t)1 << (idx % 64);
+		count++;
+	}
+	return (count);
+}
+
+bool
+arm64id_reg_volatile(u_int idx)
+{
+	const struct special_reg *sr;
+
+	sr = reg_lookup(idx);
+	return (sr != NULL && (sr->flags & REG_F_VOLATILE) != 0);
+}
+
+const struct arm64id_hwcap *
+arm64id_hwcap_list(u_int word, size_t *countp)
+{
+	if (word >= ARM64ID_NHWCAPS) {
+		*countp = 0;
+		return (NULL);
+	}
+	*countp = hwcap_lists[word].count;
+	return (hwcap_lists[word].list);
+}
+
+/*
+ * Find a HWCAP by its name, e.g. "atomics" or "SVE2", ignoring case. The
+ * index of the AT_HWCAP word it is in is returned in wordp.
+ */
+const struct arm64id_hwcap *
+arm64id_hwcap_lookup(const char *name, u_int *wordp)
+{
+	for (u_int word = 0; word < ARM64ID_NHWCAPS; word++) {
+		for (size_t i = 0; i < hwcap_lists[word].count; i++) {
+			if (strcasecmp(hwcap_lists[word].list[i].name,
+			    name) != 0)
+				continue;
+			*wordp = word;
+			return (&hwcap_lists[word].list[i]);
+		}
+	}
+	return (NULL);
+}
@@ -0,0 +1,315 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Recommend compiler flags for a snapshot, or for the common baseline of a
+ * set of snapshots. Features are taken from the HWCAPs rather than the ID
+ * registers as they also reflect what the kernel supports, e.g. SVE may be
+ * implemented but disabled.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+/* The level of features implied by armv9-a */
+#define	MARCH_V9	9
+/* The last armv8.x-a and armv9.x-a versions we know about */
+#define	MARCH_V8_MAX	8
+#define	MARCH_V9_MAX	3
+
+#define	MARCH_MAX_CPUS	16
+
+/*
+ * A feature with the HWCAPs it needs, the GCC and Clang -march extension
+ * and function multiversioning names, and the armv8.<level>-a version that
+ * implies the -march extension, or 0 if no version does.
+ */
+static const struct march_feature {
+	const char	*hwcap[2];
+	const char	*ext;
+	const char	*fmv;
+	u_int		 level;
+} march_features[] = {
+	{ { "FP" },		NULL,		"fp",		0 },
+	{ { "ASIMD" },		NULL,		"simd",		0 },
+	{ { "CRC32" },		"crc",		"crc",		1 },
+	{ { "ATOMICS" },	"lse",		"lse",		1 },
+	{ { "ASIMDRDM" },	"rdma",		"rdm",		1 },
+	{ { "DCPOP" },		NULL,		"dpb",		2 },
+	{ { "DCPODP" },		NULL,		"dpb2",		0 },
+	{ { "FPHP", "ASIMDHP" }, "fp16",	"fp16",		0 },
+	{ { "ASIMDFHM" },	"fp16fml",	"fp16fml",	0 },
+	{ { "JSCVT" },		NULL,		"jscvt",	3 },
+	{ { "FCMA" },		NULL,		"fcma",		3 },
+	{ { "LRCPC" },		"rcpc",		"rcpc",		3 },
+	{ { "ILRCPC" },		NULL,		"rcpc2",	4 },
+	{ { "LRCPC3" },		"rcpc3",	"rcpc3",	0 },
+	{ { "ASIMDDP" },	"dotprod",	"dotprod",	4 },
+	{ { "FLAGM" },		"flagm",	"flagm",	4 },
+	{ { "FLAGM2" },		NULL,		"flagm2",	5 },
+	{ { "FRINT" },		NULL,		"frintts",	5 },
+	{ { "DIT" },		NULL,		"dit",		0 },
+	{ { "AES", "PMULL" },	"aes",		"aes",		0 },
+	{ { "SHA1", "SHA2" },	"sha2",		"sha2",		0 },
+	{ { "SHA3", "SHA512" },	"sha3",		"sha3",		0 },
+	{ { "SM3", "SM4" },	"sm4",		"sm4",		0 },
+	{ { "SB" },		"sb",		"sb",		5 },
+	{ { "SSBS" },		"ssbs",		"ssbs",		5 },
+	{ { "BTI" },		NULL,		"bti",		5 },
+	{ { "MTE" },		"memtag",	"memtag",	0 },
+	{ { "RNG" },		"rng",		"rng",		0 },
+	{ { "I8MM" },		"i8mm",		"i8mm",		6 },
+	{ { "BF16" },		"bf16",		"bf16",		6 },
+	{ { "LS64" },		"ls64",		NULL,		7 },
+	{ { "WFXT" },		NULL,		"wfxt",		7 },
+	{ { "MOPS" },		"mops",		"mops",		8 },
+	{ { "HBC" },		NULL,		NULL,		8 },
+	{ { "CSSC" },		"cssc",		"cssc",		0 },
+	{ { "LSE128" },		"lse128",	NULL,		0 },
+	{ { "SVE" },		"sve",		"sve",		MARCH_V9 },
+	{ { "SVEF32MM" },	"f32mm",	"f32mm",	0 },
+	{ { "SVEF64MM" },	"f64mm",	"f64mm",	0 },
+	{ { "SVE2" },		"sve2",		"sve2",		MARCH_V9 },
+	{ { "SVEAES" },		"sve2-aes",	"sve2-aes",	0 },
+	{ { "SVEBITPERM" },	"sve2-bitperm",	"sve2-bitperm",	0 },
+	{ { "SVESHA3" },	"sve2-sha3",	"sve2-sha3",	0 },
+	{ { "SVESM4" },		"sve2-sm4",	"sve2-sm4",	0 },
+	{ { "SVE2P1" },		"sve2p1",	NULL,		0 },
+	{ { "SME" },		"sme",		"sme",		0 },
+	{ { "SME_F64F64" },	"sme-f64f64",	"sme-f64f64",	0 },
+	{ { "SME_I16I64" },	"sme-i16i64",	"sme-i16i64",	0 },
+	{ { "SME2" },		"sme2",		"sme2",		0 },
+};
+
+/* HWCAPs needed by an architecture version that aren't -march extensions */
+static const struct {
+	u_int		 level;
+	const char	*hwcap;
+} march_level_hwcaps[] = {
+	{ 1, "FP" },
+	{ 1, "ASIMD" },
+	{ 2, "DCPOP" },
+	{ 3, "PACA" },
+	{ 3, "PACG" },
+	{ 4, "USCAT" },
+};
+
+struct march_state {
+	size_t		nsnaps;
+	uint64_t	hwcaps[ARM64ID_NHWCAPS];
+	uint32_t	midr[MARCH_MAX_CPUS];
+	u_int		nmidr;
+	bool		midr_unknown;
+};
+
+static bool
+march_have(const struct march_state *ms, const char *name)
+{
+	const struct arm64id_hwcap *cap;
+	u_int word;
+
+	cap = arm64id_hwcap_lookup(name, &word);
+	return (cap != NULL && (ms->hwcaps[word] & cap->cap) != 0);
+}
+
+static bool
+march_feature_have(const struct march_state *ms,
+    const struct march_feature *feat)
+{
+	for (size_t i = 0; i < nitems(feat->hwcap); i++) {
+		if (feat->hwcap[i] != NULL && !march_have(ms, feat->hwcap[i]))
+			return (false);
+	}
+	return (true);
+}
+
+static bool
+march_level_ok(const struct march_state *ms, u_int level)
+{
+	for (size_t i = 0; i < nitems(march_features); i++) {
+		if (march_features[i].level == level &&
+		    !march_feature_have(ms, &march_features[i]))
+			return (false);
+	}
+	for (size_t i = 0; i < nitems(march_level_hwcaps); i++) {
+		if (march_level_hwcaps[i].level == level &&
+		    !march_have(ms, march_level_hwcaps[i].hwcap))
+			return (false);
+	}
+	return (true);
+}
+
+static const char *
+march_cpu_name(uint32_t midr)
+{
+	const struct arm64id_core *core;
+
+	core = arm64id_core_lookup(midr);
+	return (core != NULL ? core->tune : NULL);
+}
+
+struct march_state *
+march_alloc(void)
+{
+	struct march_state *ms;
+
+	ms = calloc(1, sizeof(*ms));
+	if (ms == NULL)
+		err(1, "calloc");
+	return (ms);
+}
+
+/*
+ * Add a snapshot to the baseline. HWCAP words the snapshot doesn't have are
+ * taken to be empty so they don't add features.
+ */
+void
+march_add(const struct arm64id_snapshot *snap, void *arg)
+{
+	struct march_state *ms;
+	uint32_t midr;
+	u_int i;
+	int idx;
+
+	ms = arg;
+	for (i = 0; i < ARM64ID_NHWCAPS; i++) {
+		if (!arm64id_hwcap_valid(snap, i))
+			ms->hwcaps[i] = 0;
+		else if (ms->nsnaps == 0)
+			ms->hwcaps[i] = snap->hwcaps[i];
+		else
+			ms->hwcaps[i] &= snap->hwcaps[i];
+	}
+	ms->nsnaps++;
+
+	idx = arm64id_reg_lookup("midr_el1");
+	if (idx < 0 || !arm64id_reg_valid(snap, idx)) {
+		ms->midr_unknown = true;
+		return;
+	}
+	/* Only the implementer and part number select a -mcpu */
+	midr = snap->regs[idx] & 0xff00fff0;
+	for (i = 0; i < ms->nmidr; i++) {
+		if (ms->midr[i] == midr)
+			return;
+	}
+	if (ms->nmidr < nitems(ms->midr))
+		ms->midr[ms->nmidr++] = midr;
+	else
+		ms->midr_unknown = true;
+}
+
+void
+march_print(struct march_state *ms)
+{
+	const struct march_feature *feat;
+	const char *name, *sep;
+	u_int v8, v9;
+	bool implied;
+
+	if (ms->nsnaps == 0)
+		errx(1, "no snapshots");
+
+	/* The newest architecture version all the features are present for */
+	for (v8 = 0; v8 < MARCH_V8_MAX; v8++) {
+		if (!march_level_ok(ms, v8 + 1))
+			break;
+	}
+	v9 = 0;
+	if (v8 >= 5 && march_level_ok(ms, MARCH_V9))
+		v9 = MIN(v8 - 5, MARCH_V9_MAX) + 1;
+
+	printf("%-14s -march=", "march:");
+	if (v9 > 1)
+		printf("armv9.%u-a", v9 - 1);
+	else if (v9 == 1)
+		printf("armv9-a");
+	else if (v8 > 0)
+		printf("armv8.%u-a", v8);
+	else
+		printf("armv8-a");
+	for (size_t i = 0; i < nitems(march_features); i++) {
+		feat = &march_features[i];
+		if (feat->ext == NULL || !march_feature_have(ms, feat))
+			continue;
+		implied = (feat->level != 0 && feat->level <= v8) ||
+		    (feat->level == MARCH_V9 && v9 != 0);
+		if (!implied)
+			printf("+%s", feat->ext);
+	}
+	printf("\n");
+
+	if (ms->nmidr == 1 && !ms->midr_unknown &&
+	    (name = march_cpu_name(ms->midr[0])) != NULL) {
+		printf("%-14s -mcpu=%s\n", "mcpu:", name);
+		printf("%-14s -mtune=%s\n", "mtune:", name);
+	} else if (ms->nmidr == 1 && !ms->midr_unknown) {
+		printf("%-14s unknown, implementer 0x%02x part 0x%03x\n",
+		    "mcpu:", ms->midr[0] >> 24, (ms->midr[0] >> 4) & 0xfff);
+	} else {
+		printf("%-14s", "mcpu:");
+		if (ms->nmidr == 0)
+			printf(" unknown");
+		else
+			printf(" mixed,");
+		for (u_int i = 0; i < ms->nmidr; i++) {
+			name = march_cpu_name(ms->midr[i]);
+			if (name != NULL)
+				printf(" %s", name);
+			else
+				printf(" 0x%02x/0x%03x", ms->midr[i] >> 24,
+				    (ms->midr[i] >> 4) & 0xfff);
+		}
+		printf(", use -march with -mtune=generic\n");
+	}
+
+	printf("%-14s", "target_clones:");
+	sep = " ";
+	for (size_t i = 0; i < nitems(march_features); i++) {
+		feat = &march_features[i];
+		if (feat->fmv == NULL || !march_feature_have(ms, feat))
+			continue;
+		printf("%s%s", sep, feat->fmv);
+		sep = ",";
+	}
+	printf("\n");
+
+	if (ms->nsnaps > 1)
+		printf("%-14s %zu snapshots\n", "baseline:", ms->nsnaps);
+	free(ms);
+}
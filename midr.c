@@ -0,0 +1,251 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A database of CPU cores and their errata keyed on the MIDR_EL1 fields.
+ * The tables are sorted so lookups are a binary search, and only depend on
+ * the MIDR_EL1 value so can be used with saved snapshots.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arm64id.h"
+
+#ifndef nitems
+#define	nitems(x)	(sizeof(x)/sizeof(x[0]))
+#endif
+
+#define	MIDR_KEY(impl, part)	(((uint32_t)(impl) << 12) | (part))
+
+static const struct {
+	uint8_t		 implementer;
+	const char	*name;
+} implementers[] = {
+	{ 0x41, "Arm" },
+	{ 0x42, "Broadcom" },
+	{ 0x43, "Cavium" },
+	{ 0x46, "Fujitsu" },
+	{ 0x48, "HiSilicon" },
+	{ 0x4e, "NVIDIA" },
+	{ 0x50, "APM" },
+	{ 0x51, "Qualcomm" },
+	{ 0x53, "Samsung" },
+	{ 0x56, "Marvell" },
+	{ 0x61, "Apple" },
+	{ 0x6d, "Microsoft" },
+	{ 0x70, "Phytium" },
+	{ 0xc0, "Ampere" },
+};
+
+/* Sorted by implementer then part number */
+static const struct arm64id_core cores[] = {
+	{ 0x41, 0xd03, "Cortex-A53",	"cortex-a53" },
+	{ 0x41, 0xd04, "Cortex-A35",	"cortex-a35" },
+	{ 0x41, 0xd05, "Cortex-A55",	"cortex-a55" },
+	{ 0x41, 0xd07, "Cortex-A57",	"cortex-a57" },
+	{ 0x41, 0xd08, "Cortex-A72",	"cortex-a72" },
+	{ 0x41, 0xd09, "Cortex-A73",	"cortex-a73" },
+	{ 0x41, 0xd0a, "Cortex-A75",	"cortex-a75" },
+	{ 0x41, 0xd0b, "Cortex-A76",	"cortex-a76" },
+	{ 0x41, 0xd0c, "Neoverse N1",	"neoverse-n1" },
+	{ 0x41, 0xd0d, "Cortex-A77",	"cortex-a77" },
+	{ 0x41, 0xd40, "Neoverse V1",	"neoverse-v1" },
+	{ 0x41, 0xd41, "Cortex-A78",	"cortex-a78" },
+	{ 0x41, 0xd44, "Cortex-X1",	"cortex-x1" },
+	{ 0x41, 0xd46, "Cortex-A510",	"cortex-a510" },
+	{ 0x41, 0xd47, "Cortex-A710",	"cortex-a710" },
+	{ 0x41, 0xd48, "Cortex-X2",	"cortex-x2" },
+	{ 0x41, 0xd49, "Neoverse N2",	"neoverse-n2" },
+	{ 0x41, 0xd4a, "Neoverse E1",	"neoverse-e1" },
+	{ 0x41, 0xd4b, "Cortex-A78C",	"cortex-a78c" },
+	{ 0x41, 0xd4d, "Cortex-A715",	"cortex-a715" },
+	{ 0x41, 0xd4e, "Cortex-X3",	"cortex-x3" },
+	{ 0x41, 0xd4f, "Neoverse V2",	"neoverse-v2" },
+	{ 0x41, 0xd80, "Cortex-A520",	"cortex-a520" },
+	{ 0x41, 0xd81, "Cortex-A720",	"cortex-a720" },
+	{ 0x41, 0xd82, "Cortex-X4",	"cortex-x4" },
+	{ 0x41, 0xd84, "Neoverse V3",	"neoverse-v3" },
+	{ 0x41, 0xd8e, "Neoverse N3",	"neoverse-n3" },
+	{ 0x42, 0x516, "Vulcan",	"thunderx2t99" },
+	{ 0x43, 0x0a1, "ThunderX",	"thunderx" },
+	{ 0x43, 0x0af, "ThunderX2",	"thunderx2t99" },
+	{ 0x43, 0x0b8, "ThunderX3",	"thunderx3t110" },
+	{ 0x46, 0x001, "A64FX",		"a64fx" },
+	{ 0x48, 0xd01, "TSV110",	"tsv110" },
+	{ 0x4e, 0x004, "Carmel",	"carmel" },
+	{ 0x51, 0xc00, "Falkor",	"falkor" },
+	{ 0x51, 0xc01, "Saphira",	"saphira" },
+	{ 0x61, 0x022, "M1 Icestorm",	NULL },
+	{ 0x61, 0x023, "M1 Firestorm",	NULL },
+	{ 0x61, 0x032, "M2 Blizzard",	NULL },
+	{ 0x61, 0x033, "M2 Avalanche",	NULL },
+	{ 0xc0, 0xac3, "Ampere1",	"ampere1" },
+	{ 0xc0, 0xac4, "Ampere1A",	"ampere1a" },
+	{ 0xc0, 0xac5, "Ampere1B",	"ampere1b" },
+};
+
+#define	REV(v, r)	(((v) << 4) | (r))
+#define	REV_ALL		REV(0, 0), REV(0xf, 0xf)
+
+/*
+ * Errata with a performance impact on userspace, mostly from the kernel
+ * workarounds for them. Sorted by implementer then part number.
+ */
+static const struct arm64id_erratum errata[] = {
+	{ 0x41, 0xd03, REV(0, 0), REV(0, 2), "819472/824069/827319",
+	    "DC CVAC/CVAU are upgraded to DC CIVAC, cache cleaning is slower" },
+	{ 0x41, 0xd03, REV(0, 0), REV(0, 4), "835769",
+	    "64-bit multiply-accumulate, build with -mfix-cortex-a53-835769" },
+	{ 0x41, 0xd03, REV(0, 0), REV(0, 4), "843419",
+	    "ADRP address generation, link with --fix-cortex-a53-843419" },
+	{ 0x41, 0xd05, REV(0, 0), REV(2, 0), "1024718",
+	    "Hardware dirty bit management is disabled, more page faults" },
+	{ 0x41, 0xd05, REV(0, 0), REV(2, 0), "2441007",
+	    "TLB invalidation is repeated, munmap and mprotect are slower" },
+	{ 0x41, 0xd07, REV(0, 0), REV(1, 2), "832075",
+	    "Device load-acquire is replaced with load and barrier" },
+	{ 0x41, 0xd0b, REV(0, 0), REV(3, 0), "1286807",
+	    "TLB invalidation is repeated, munmap and mprotect are slower" },
+	{ 0x41, 0xd0b, REV(0, 0), REV(3, 1), "1418040",
+	    "AArch32 counter reads trap to the kernel" },
+	{ 0x41, 0xd0c, REV(0, 0), REV(3, 1), "1418040",
+	    "AArch32 counter reads trap to the kernel" },
+	{ 0x41, 0xd0c, REV(3, 0), REV(4, 0), "1542419",
+	    "CTR_EL0.DIC is hidden, code must use IC IVAU after writing it" },
+	{ 0x41, 0xd0c, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x41, 0xd40, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x41, 0xd46, REV(0, 0), REV(1, 1), "2441009",
+	    "TLB invalidation is repeated, munmap and mprotect are slower" },
+	{ 0x41, 0xd46, REV(0, 0), REV(1, 1), "2658417",
+	    "BF16 instructions are hidden from HWCAP2" },
+	{ 0x41, 0xd49, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x41, 0xd4f, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x41, 0xd81, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x41, 0xd82, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x41, 0xd84, REV_ALL, "3194386",
+	    "SSBS is hidden, speculative store bypass control is slower" },
+	{ 0x43, 0x0a1, REV(0, 0), REV(1, 1), "27456",
+	    "The I-cache is invalidated with each TLB invalidation" },
+	{ 0x51, 0xc00, REV_ALL, "E1009",
+	    "TLB invalidation is repeated, munmap and mprotect are slower" },
+};
+
+static int
+midr_compare(uint32_t key, uint8_t impl, uint16_t part)
+{
+	uint32_t other;
+
+	other = MIDR_KEY(impl, part);
+	return (key < other ? -1 : key > other);
+}
+
+const char *
+arm64id_implementer_name(uint8_t implementer)
+{
+	for (size_t i = 0; i < nitems(implementers); i++) {
+		if (implementers[i].implementer == implementer)
+			return (implementers[i].name);
+	}
+	return (NULL);
+}
+
+/* Find the core from MIDR_EL1, the variant and revision are ignored */
+const struct arm64id_core *
+arm64id_core_lookup(uint32_t midr)
+{
+	uint32_t key;
+	size_t lo, hi, mid;
+	int cmp;
+
+	key = MIDR_KEY(ARM64ID_MIDR_IMPLEMENTER(midr), ARM64ID_MIDR_PART(midr));
+	lo = 0;
+	hi = nitems(cores);
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = midr_compare(key, cores[mid].implementer, cores[mid].part);
+		if (cmp == 0)
+			return (&cores[mid]);
+		if (cmp > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (NULL);
+}
+
+/*
+ * Return the errata for the core in MIDR_EL1 for all revisions, use
+ * arm64id_erratum_applies to check each against the revision.
+ */
+const struct arm64id_erratum *
+arm64id_core_errata(uint32_t midr, size_t *countp)
+{
+	uint32_t key;
+	size_t lo, hi, mid, end;
+
+	key = MIDR_KEY(ARM64ID_MIDR_IMPLEMENTER(midr), ARM64ID_MIDR_PART(midr));
+	lo = 0;
+	hi = nitems(errata);
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (midr_compare(key, errata[mid].implementer,
+		    errata[mid].part) > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (end = lo; end < nitems(errata); end++) {
+		if (midr_compare(key, errata[end].implementer,
+		    errata[end].part) != 0)
+			break;
+	}
+
+	*countp = end - lo;
+	return (*countp == 0 ? NULL : &errata[lo]);
+}
+
+bool
+arm64id_erratum_applies(const struct arm64id_erratum *e, uint32_t midr)
+{
+	uint8_t rev;
+
+	rev = REV(ARM64ID_MIDR_VARIANT(midr), ARM64ID_MIDR_REVISION(midr));
+	return (ARM64ID_MIDR_IMPLEMENTER(midr) == e->implementer &&
+	    ARM64ID_MIDR_PART(midr) == e->part &&
+	    rev >= e->rev_min && rev <= e->rev_max);
+}
@@ -0,0 +1,343 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Compare the FEAT_MOPS memory copy and set instructions with libc and a
+ * NEON loop over a range of sizes and alignments. This is the "mops"
+ * benchmark.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#include "arm64id.h"
+#include "extern.h"
+
+/* Sizes are powers of two from 1 byte to MOPS_MAX */
+#define	MOPS_NSIZES	27
+#define	MOPS_MAX	((size_t)1 << (MOPS_NSIZES - 1))
+/* Bytes to move for each measurement, within the limits on calls */
+#define	MOPS_BYTES	(128 * 1024 * 1024)
+#define	MOPS_MINCALLS	4
+#define	MOPS_MAXCALLS	(1024 * 1024)
+/* Keep the last fastest unless another is faster by more than this */
+#define	MOPS_MARGIN	1.05
+
+#ifdef __aarch64__
+enum mops_impl {
+	MOPS_LIBC,
+	MOPS_NEON,
+	MOPS_MOPS,
+	MOPS_NIMPLS
+};
+
+static const char *mops_impl_names[MOPS_NIMPLS] = {
+	[MOPS_LIBC] = "libc",
+	[MOPS_NEON] = "neon",
+	[MOPS_MOPS] = "mops",
+};
+
+/* Offsets added to both buffers */
+static const size_t mops_aligns[] = { 0, 1, 8 };
+
+static void *
+mops_libc_copy(void *dst, const void *src, size_t n)
+{
+	return (memcpy(dst, src, n));
+}
+
+static void *
+mops_libc_set(void *dst, int c, size_t n)
+{
+	return (memset(dst, c, n));
+}
+
+static void *
+mops_neon_copy(void *dst, const void *src, size_t n)
+{
+	const uint8_t *s;
+	uint8_t *d;
+
+	d = dst;
+	s = src;
+	for (; n >= 64; n -= 64, d += 64, s += 64) {
+		uint8x16_t a, b, c, e;
+
+		a = vld1q_u8(s);
+		b = vld1q_u8(s + 16);
+		c = vld1q_u8(s + 32);
+		e = vld1q_u8(s + 48);
+		vst1q_u8(d, a);
+		vst1q_u8(d + 16, b);
+		vst1q_u8(d + 32, c);
+		vst1q_u8(d + 48, e);
+	}
+	for (; n >= 16; n -= 16, d += 16, s += 16)
+		vst1q_u8(d, vld1q_u8(s));
+	/* The barrier stops this loop being turned into a memcpy call */
+	for (; n > 0; n--) {
+		*d++ = *s++;
+		__asm __volatile("" ::: "memory");
+	}
+	return (dst);
+}
+
+static void *
+mops_neon_set(void *dst, int c, size_t n)
+{
+	uint8x16_t v;
+	uint8_t *d;
+
+	d = dst;
+	v = vdupq_n_u8((uint8_t)c);
+	for (; n >= 64; n -= 64, d += 64) {
+		vst1q_u8(d, v);
+		vst1q_u8(d + 16, v);
+		vst1q_u8(d + 32, v);
+		vst1q_u8(d + 48, v);
+	}
+	for (; n >= 16; n -= 16, d += 16)
+		vst1q_u8(d, v);
+	for (; n > 0; n--) {
+		*d++ = (uint8_t)c;
+		__asm __volatile("" ::: "memory");
+	}
+	return (dst);
+}
+
+static void *
+mops_mops_copy(void *dst, const void *src, size_t n)
+{
+	void *d;
+
+	d = dst;
+	__asm __volatile(
+	    ".arch_extension mops\n"
+	    "	cpyfp	[%0]!, [%1]!, %2!\n"
+	    "	cpyfm	[%0]!, [%1]!, %2!\n"
+	    "	cpyfe	[%0]!, [%1]!, %2!\n"
+	    : "+r"(d), "+r"(src), "+r"(n) :: "cc", "memory");
+	return (dst);
+}
+
+static void *
+mops_mops_set(void *dst, int c, size_t n)
+{
+	void *d;
+
+	d = dst;
+	__asm __volatile(
+	    ".arch_extension mops\n"
+	    "	setp	[%0]!, %1!, %2\n"
+	    "	setm	[%0]!, %1!, %2\n"
+	    "	sete	[%0]!, %1!, %2\n"
+	    : "+r"(d), "+r"(n) : "r"((uint64_t)c) : "cc", "memory");
+	return (dst);
+}
+
+static void *(*const mops_copies[MOPS_NIMPLS])(void *, const void *,
+    size_t) = {
+	[MOPS_LIBC] = mops_libc_copy,
+	[MOPS_NEON] = mops_neon_copy,
+	[MOPS_MOPS] = mops_mops_copy,
+};
+
+static void *(*const mops_sets[MOPS_NIMPLS])(void *, int, size_t) = {
+	[MOPS_LIBC] = mops_libc_set,
+	[MOPS_NEON] = mops_neon_set,
+	[MOPS_MOPS] = mops_mops_set,
+};
+
+/* Returns ns per call */
+static double
+mops_time(bool copy, enum mops_impl impl, char *dst, const char *src,
+    size_t size)
+{
+	uint64_t start;
+	size_t calls;
+
+	calls = MIN(MAX(MOPS_BYTES / size, MOPS_MINCALLS), MOPS_MAXCALLS);
+	start = bench_nsec();
+	if (copy) {
+		for (size_t i = 0; i < calls; i++)
+			mops_copies[impl](dst, src, size);
+	} else {
+		for (size_t i = 0; i < calls; i++)
+			mops_sets[impl](dst, (int)i, size);
+	}
+	return ((double)(bench_nsec() - start) / calls);
+}
+
+/* Check each implementation gives the same result as libc */
+static void
+mops_check(char *dst, char *src, bool have_mops)
+{
+	const size_t sizes[] = { 0, 1, 15, 16, 63, 64, 65, 4097 };
+	char *ref;
+
+	ref = malloc(8192);
+	if (ref == NULL)
+		err(1, "malloc");
+	for (size_t i = 0; i < 8192; i++)
+		src[i] = (char)(i * 7 + 1);
+	for (u_int impl = MOPS_NEON; impl < MOPS_NIMPLS; impl++) {
+		if (impl == MOPS_MOPS && !have_mops)
+			continue;
+		for (size_t i = 0; i < nitems(sizes); i++) {
+			memset(ref, 0, 8192);
+			memset(dst, 0, 8192);
+			memcpy(ref + 1, src + 3, sizes[i]);
+			mops_copies[impl](dst + 1, src + 3, sizes[i]);
+			if (memcmp(ref, dst, 8192) != 0)
+				errx(1, "mops: %s copy of %zu bytes is wrong",
+				    mops_impl_names[impl], sizes[i]);
+			memset(ref + 1, 0x5a, sizes[i]);
+			mops_sets[impl](dst + 1, 0x5a, sizes[i]);
+			if (memcmp(ref, dst, 8192) != 0)
+				errx(1, "mops: %s set of %zu bytes is wrong",
+				    mops_impl_names[impl], sizes[i]);
+		}
+	}
+	free(ref);
+}
+
+static const char *
+mops_size(char *buf, size_t len, size_t size)
+{
+	if (size >= 1024 * 1024 && size % (1024 * 1024) == 0)
+		snprintf(buf, len, "%zuMiB", size / (1024 * 1024));
+	else if (size >= 1024 && size % 1024 == 0)
+		snprintf(buf, len, "%zuKiB", size / 1024);
+	else
+		snprintf(buf, len, "%zuB", size);
+	return (buf);
+}
+
+/*
+ * Print the sizes where each implementation is the fastest. best[i] is
+ * the fastest implementation for size 1 << i.
+ */
+static void
+mops_crossover(const u_int *best, u_int nsizes)
+{
+	char from[16], to[16];
+	u_int start;
+
+	printf("fastest:");
+	start = 0;
+	for (u_int i = 1; i <= nsizes; i++) {
+		if (i < nsizes && best[i] == best[start])
+			continue;
+		printf(" %s %s", mops_impl_names[best[start]],
+		    mops_size(from, sizeof(from), (size_t)1 << start));
+		if (i - 1 != start)
+			printf("-%s",
+			    mops_size(to, sizeof(to), (size_t)1 << (i - 1)));
+		start = i;
+	}
+	printf("\n");
+}
+#endif
+
+void
+bench_mops(void)
+{
+#ifdef __aarch64__
+	const struct arm64id_snapshot *snap;
+	u_int best[MOPS_NSIZES], nimpls;
+	char *dst, *src, buf[16];
+	double gbs[MOPS_NIMPLS], ghz, ns;
+	size_t size;
+	bool have_mops;
+
+	snap = arm64id_snapshot_get();
+	if (snap == NULL)
+		errx(1, "unable to read the ID registers");
+	have_mops = arm64id_requires(snap, "MOPS");
+	nimpls = have_mops ? MOPS_NIMPLS : MOPS_MOPS;
+
+	if (posix_memalign((void **)&dst, 4096, MOPS_MAX + 64) != 0 ||
+	    posix_memalign((void **)&src, 4096, MOPS_MAX + 64) != 0)
+		err(1, "posix_memalign");
+	memset(dst, 0, MOPS_MAX + 64);
+	memset(src, 1, MOPS_MAX + 64);
+	mops_check(dst, src, have_mops);
+
+	ghz = bench_ghz();
+	printf("clock estimate %.2f GHz", ghz);
+	if (!have_mops)
+		printf(", no MOPS so only libc and neon are compared");
+	printf("\n");
+
+	for (u_int op = 0; op < 2; op++) {
+		for (size_t a = 0; a < nitems(mops_aligns); a++) {
+			printf("\n%s, offset %zu\n%10s", op == 0 ? "copy" : "set",
+			    mops_aligns[a], "size");
+			for (u_int impl = 0; impl < nimpls; impl++)
+				printf(" %10s %10s", mops_impl_names[impl],
+				    "cycles");
+			printf("\n");
+
+			for (u_int i = 0; i < MOPS_NSIZES; i++) {
+				size = (size_t)1 << i;
+				printf("%10s", mops_size(buf, sizeof(buf),
+				    size));
+				best[i] = i == 0 ? MOPS_LIBC : best[i - 1];
+				for (u_int impl = 0; impl < nimpls; impl++) {
+					ns = mops_time(op == 0, impl,
+					    dst + mops_aligns[a],
+					    src + mops_aligns[a], size);
+					gbs[impl] = size / ns;
+					printf(" %5.1f GB/s %10.0f", gbs[impl],
+					    ns * ghz);
+				}
+				printf("\n");
+				for (u_int impl = 0; impl < nimpls; impl++) {
+					if (gbs[impl] > gbs[best[i]] * MOPS_MARGIN)
+						best[i] = impl;
+				}
+			}
+			mops_crossover(best, MOPS_NSIZES);
+		}
+	}
+	free(dst);
+	free(src);
+#else
+	printf("mops: needs arm64\n");
+#endif
+}
@@ -0,0 +1,387 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Measure what memory tagging costs in each tag check mode, to see if a
+ * tagging allocator is affordable. An allocation kernel retags each object
+ * as it is handed out, like a tagging malloc, and a copy kernel moves data
+ * between tagged buffers with the libc memcpy. Each runs on a PROT_MTE
+ * mapping with tag checks off, sync, async, asymmetric and store only
+ * where the CPU supports them, and the throughput is compared with the
+ * same kernel on untagged memory. This is the "mte" benchmark.
+ *
+ * The modes are set with prctl so this is Linux only. qemu-user emulates
+ * MTE with "-cpu max" so the harness can be tested there, the numbers are
+ * then not meaningful.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#endif
+
+#include <err.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#if defined(__aarch64__) && defined(__linux__)
+#define	HAVE_MTE_PRCTL
+
+#ifndef PR_SET_TAGGED_ADDR_CTRL
+#define	PR_SET_TAGGED_ADDR_CTRL	55
+#define	PR_GET_TAGGED_ADDR_CTRL	56
+#define	PR_TAGGED_ADDR_ENABLE	(1UL << 0)
+#endif
+#ifndef PR_MTE_TCF_SHIFT
+#define	PR_MTE_TCF_SHIFT	1
+#define	PR_MTE_TCF_NONE		(0UL << PR_MTE_TCF_SHIFT)
+#define	PR_MTE_TCF_SYNC		(1UL << PR_MTE_TCF_SHIFT)
+#define	PR_MTE_TCF_ASYNC	(2UL << PR_MTE_TCF_SHIFT)
+#define	PR_MTE_TAG_SHIFT	3
+#endif
+#ifndef PR_MTE_STORE_ONLY
+#define	PR_MTE_STORE_ONLY	(1UL << 19)
+#endif
+#ifndef PROT_MTE
+#define	PROT_MTE		0x20
+#endif
+#endif
+
+/* Tags IRG may pick, tag 0 is left for untagged pointers */
+#define	MTE_TAG_INCLUDE	0xfffe
+
+/* The allocation kernel hands out objects of 16 to 256 bytes from slots */
+#define	MTE_SLOT_SIZE	256
+#define	MTE_SLOTS	4096
+#define	MTE_ALLOCS	(4 * 1024 * 1024)
+
+/* Max CPUs whose mte_tcf_preferred is checked */
+#define	MTE_MAXCPUS	1024
+
+/* The copy kernel copies between two buffers of this size */
+#define	MTE_COPY_BUF	(1024 * 1024)
+#define	MTE_COPY_BYTES	(256 * 1024 * 1024)
+
+#ifdef HAVE_MTE_PRCTL
+struct mte_mode {
+	const char	*name;
+	const char	*requires;	/* For arm64id_requires */
+	bool		 tagged;	/* Use PROT_MTE memory and tag it */
+	unsigned long	 ctrl;		/* PR_MTE_* flags */
+};
+
+/*
+ * With both sync and async set the kernel uses the mode in each CPU's
+ * mte_tcf_preferred, asymmetric mode needs it set to "asymm". The thread
+ * isn't pinned so this is only asymmetric when every CPU it may run on
+ * prefers it, see mte_preferred.
+ */
+static const struct mte_mode mte_modes[] = {
+	{ "untagged", "MTE", false, PR_MTE_TCF_NONE },
+	{ "none", "MTE", true, PR_MTE_TCF_NONE },
+	{ "sync", "MTE", true, PR_MTE_TCF_SYNC },
+	{ "async", "MTE", true, PR_MTE_TCF_ASYNC },
+	{ "asymm", "MTE3", true, PR_MTE_TCF_SYNC | PR_MTE_TCF_ASYNC },
+	{ "sync store-only", "MTE_STORE_ONLY", true,
+	    PR_MTE_TCF_SYNC | PR_MTE_STORE_ONLY },
+	{ "async store-only", "MTE_STORE_ONLY", true,
+	    PR_MTE_TCF_ASYNC | PR_MTE_STORE_ONLY },
+};
+
+static const size_t mte_copy_sizes[] = { 256, 64 * 1024 };
+
+struct mte_result {
+	double		 allocs;	/* Per us */
+	double		 copy[nitems(mte_copy_sizes)];	/* GB/s */
+};
+
+/* A pointer to p with a random tag from MTE_TAG_INCLUDE */
+static inline void *
+mte_irg(void *p)
+{
+	__asm __volatile(
+	    ".arch_extension memtag\n"
+	    "	irg	%0, %0\n"
+	    : "+r"(p));
+	return (p);
+}
+
+/* Set the allocation tags of len bytes at p, a multiple of 16, to p's tag */
+static inline void
+mte_set_tags(void *p, size_t len)
+{
+	char *c;
+
+	c = p;
+	for (; len >= 32; len -= 32, c += 32)
+		__asm __volatile(
+		    ".arch_extension memtag\n"
+		    "	st2g	%0, [%0]\n"
+		    :: "r"(c) : "memory");
+	if (len != 0)
+		__asm __volatile(
+		    ".arch_extension memtag\n"
+		    "	stg	%0, [%0]\n"
+		    :: "r"(c) : "memory");
+}
+
+static char *
+mte_map(size_t len, bool tagged)
+{
+	void *p;
+
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE | (tagged ? PROT_MTE : 0),
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		err(1, "mmap");
+	return (p);
+}
+
+/*
+ * Hand out an object from a random slot, retagging it like a tagging
+ * allocator would so old pointers to the slot fault, then fill it.
+ * Returns the best allocations per us of three runs.
+ */
+static double
+mte_alloc(char *arena, bool tagged)
+{
+	volatile uint64_t sink;
+	uint64_t *obj, rnd, start, sum;
+	size_t size;
+	double best;
+
+	best = 0;
+	for (u_int r = 0; r < 3; r++) {
+		rnd = 0x9e3779b97f4a7c15ULL;
+		sum = 0;
+		start = bench_nsec();
+		for (u_int i = 0; i < MTE_ALLOCS; i++) {
+			rnd ^= rnd << 13;
+			rnd ^= rnd >> 7;
+			rnd ^= rnd << 17;
+			obj = (uint64_t *)(arena +
+			    (rnd % MTE_SLOTS) * MTE_SLOT_SIZE);
+			size = 16 * (1 + (rnd >> 32) % (MTE_SLOT_SIZE / 16));
+			if (tagged) {
+				obj = mte_irg(obj);
+				mte_set_tags(obj, size);
+			}
+			for (size_t j = 0; j < size / sizeof(*obj); j++)
+				obj[j] = i;
+			sum += obj[0];
+		}
+		best = MAX(best,
+		    (double)MTE_ALLOCS * 1000 / (bench_nsec() - start));
+		sink = sum;
+	}
+	(void)sink;
+	return (best);
+}
+
+/* Returns the best GB/s of three runs copying size bytes at a time */
+static double
+mte_copy(char *dst, const char *src, size_t size)
+{
+	uint64_t start;
+	double best;
+
+	best = 0;
+	for (u_int r = 0; r < 3; r++) {
+		start = bench_nsec();
+		for (size_t done = 0; done < MTE_COPY_BYTES;) {
+			for (size_t off = 0; off < MTE_COPY_BUF; off += size) {
+				memcpy(dst + off, src + off, size);
+				__asm __volatile("" ::: "memory");
+			}
+			done += MTE_COPY_BUF;
+		}
+		best = MAX(best,
+		    (double)MTE_COPY_BYTES / (bench_nsec() - start));
+	}
+	return (best);
+}
+
+static bool
+mte_mode_run(const struct mte_mode *m, struct mte_result *res)
+{
+	char *arena, *dst, *src;
+	unsigned long ctrl;
+
+	ctrl = PR_TAGGED_ADDR_ENABLE | m->ctrl |
+	    ((unsigned long)MTE_TAG_INCLUDE << PR_MTE_TAG_SHIFT);
+	if (prctl(PR_SET_TAGGED_ADDR_CTRL, ctrl, 0, 0, 0) != 0)
+		return (false);
+
+	arena = mte_map(MTE_SLOTS * MTE_SLOT_SIZE, m->tagged);
+	src = mte_map(MTE_COPY_BUF, m->tagged);
+	dst = mte_map(MTE_COPY_BUF, m->tagged);
+	if (m->tagged) {
+		src = mte_irg(src);
+		mte_set_tags(src, MTE_COPY_BUF);
+		dst = mte_irg(dst);
+		mte_set_tags(dst, MTE_COPY_BUF);
+	}
+	memset(src, 0x5a, MTE_COPY_BUF);
+	memset(dst, 0, MTE_COPY_BUF);
+
+	res->allocs = mte_alloc(arena, m->tagged);
+	for (size_t i = 0; i < nitems(mte_copy_sizes); i++)
+		res->copy[i] = mte_copy(dst, src, mte_copy_sizes[i]);
+
+	/* munmap ignores the tag in the address */
+	munmap(arena, MTE_SLOTS * MTE_SLOT_SIZE);
+	munmap(src, MTE_COPY_BUF);
+	munmap(dst, MTE_COPY_BUF);
+	return (true);
+}
+
+/*
+ * Read mte_tcf_preferred for each CPU we may run on into buf. Returns
+ * false and sets buf to "mixed" if the CPUs differ.
+ */
+static bool
+mte_preferred(char *buf, size_t len)
+{
+	int cpus[MTE_MAXCPUS];
+	char path[64], val[32];
+	FILE *fp;
+	u_int ncpus;
+	bool found;
+
+	snprintf(buf, len, "unknown");
+	ncpus = bench_cpus(cpus, nitems(cpus));
+	found = false;
+	for (u_int i = 0; i < ncpus; i++) {
+		snprintf(path, sizeof(path),
+		    "/sys/devices/system/cpu/cpu%d/mte_tcf_preferred", cpus[i]);
+		fp = fopen(path, "re");
+		if (fp == NULL)
+			return (false);
+		if (fgets(val, sizeof(val), fp) == NULL)
+			val[0] = '\0';
+		fclose(fp);
+		val[strcspn(val, "\n")] = '\0';
+		if (found && strcmp(buf, val) != 0) {
+			snprintf(buf, len, "mixed");
+			return (false);
+		}
+		snprintf(buf, len, "%s", val);
+		found = true;
+	}
+	return (found);
+}
+
+static void
+mte_print(double val, double base)
+{
+	printf(" %10.2f", val);
+	if (base == 0 || val == base)
+		printf(" %7s", "-");
+	else
+		printf(" %6.1f%%", (1 - val / base) * 100);
+}
+#endif
+
+void
+bench_mte(void)
+{
+#ifdef HAVE_MTE_PRCTL
+	const struct arm64id_snapshot *snap;
+	struct mte_result base, res;
+	const char *name;
+	char buf[32];
+	int orig;
+	bool asymm;
+
+	snap = arm64id_snapshot_get();
+	if (snap == NULL)
+		errx(1, "unable to read the ID registers");
+	if (!arm64id_requires(snap, "MTE")) {
+		printf("mte: needs MTE\n");
+		return;
+	}
+	orig = prctl(PR_GET_TAGGED_ADDR_CTRL, 0, 0, 0, 0);
+	if (orig < 0)
+		err(1, "PR_GET_TAGGED_ADDR_CTRL");
+
+	printf("MTE3 %s, MTE_STORE_ONLY %s, MTE_FAR %s",
+	    arm64id_requires(snap, "MTE3") ? "yes" : "no",
+	    arm64id_requires(snap, "MTE_STORE_ONLY") ? "yes" : "no",
+	    arm64id_requires(snap, "MTE_FAR") ? "yes" : "no");
+	asymm = mte_preferred(buf, sizeof(buf)) && strcmp(buf, "asymm") == 0;
+	printf(", mte_tcf_preferred %s", buf);
+	printf("\ncopies are in GB/s, loss is against untagged memory\n");
+	printf("\n%-30s %10s %7s", "mode", "allocs/us", "loss");
+	for (size_t i = 0; i < nitems(mte_copy_sizes); i++) {
+		if (mte_copy_sizes[i] >= 1024)
+			snprintf(buf, sizeof(buf), "copy %zuKiB",
+			    mte_copy_sizes[i] / 1024);
+		else
+			snprintf(buf, sizeof(buf), "copy %zuB",
+			    mte_copy_sizes[i]);
+		printf(" %10s %7s", buf, "loss");
+	}
+	printf("\n");
+
+	memset(&base, 0, sizeof(base));
+	for (size_t i = 0; i < nitems(mte_modes); i++) {
+		if (!arm64id_requires(snap, mte_modes[i].requires))
+			continue;
+		name = mte_modes[i].name;
+		if ((mte_modes[i].ctrl & PR_MTE_TCF_SYNC) != 0 &&
+		    (mte_modes[i].ctrl & PR_MTE_TCF_ASYNC) != 0 && !asymm)
+			name = "sync|async (per-CPU preferred)";
+		printf("%-30s", name);
+		fflush(stdout);
+		if (!mte_mode_run(&mte_modes[i], &res)) {
+			printf(" not supported by the kernel: %s\n",
+			    strerror(errno));
+			continue;
+		}
+		if (i == 0)
+			base = res;
+		mte_print(res.allocs, base.allocs);
+		for (size_t j = 0; j < nitems(mte_copy_sizes); j++)
+			mte_print(res.copy[j], base.copy[j]);
+		printf("\n");
+	}
+
+	if (prctl(PR_SET_TAGGED_ADDR_CTRL, (unsigned long)orig, 0, 0, 0) != 0)
+		warn("unable to restore the tag check mode");
+#else
+	printf("mte: needs Linux on arm64\n");
+#endif
+}
@@ -0,0 +1,230 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A small measurement harness on top of perf_event_open(2). The calling
+ * thread's cycles, instructions, L1D and last level cache misses, and
+ * branch misses are counted between arm64id_perf_start and
+ * arm64id_perf_stop. Any event the kernel won't count, e.g. in a
+ * container with perf_event_paranoid set or in a VM without a virtual PMU,
+ * is left invalid. The elapsed time is always measured from the generic
+ * timer, CNTVCT_EL0, so callers can fall back to timing.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+
+#ifdef __linux__
+static const struct {
+	uint32_t	type;
+	uint64_t	config;
+} perf_events[ARM64ID_PERF_NEVENTS] = {
+	[ARM64ID_PERF_CYCLES] =
+	    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	[ARM64ID_PERF_INSTRUCTIONS] =
+	    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	[ARM64ID_PERF_L1D_MISSES] =
+	    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+	    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	[ARM64ID_PERF_LLC_MISSES] =
+	    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+	    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	[ARM64ID_PERF_BRANCH_MISSES] =
+	    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+#endif
+
+static const char *perf_names[ARM64ID_PERF_NEVENTS] = {
+	[ARM64ID_PERF_CYCLES] = "cycles",
+	[ARM64ID_PERF_INSTRUCTIONS] = "instructions",
+	[ARM64ID_PERF_L1D_MISSES] = "l1d-misses",
+	[ARM64ID_PERF_LLC_MISSES] = "llc-misses",
+	[ARM64ID_PERF_BRANCH_MISSES] = "branch-misses",
+};
+
+static uint64_t
+perf_timer(void)
+{
+#ifdef __aarch64__
+	uint64_t val;
+
+	__asm __volatile("isb\n mrs %0, cntvct_el0" : "=r"(val) :: "memory");
+	return (val);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#endif
+}
+
+static uint64_t
+perf_timer_freq(void)
+{
+#ifdef __aarch64__
+	uint64_t val;
+
+	__asm __volatile("mrs %0, cntfrq_el0" : "=r"(val));
+	if (val != 0)
+		return (val);
+#endif
+	return (1000000000);
+}
+
+const char *
+arm64id_perf_event_name(enum arm64id_perf_event ev)
+{
+	if ((u_int)ev >= ARM64ID_PERF_NEVENTS)
+		return (NULL);
+	return (perf_names[ev]);
+}
+
+/*
+ * Open a counter for ev on the calling thread, counting only userspace.
+ * Returns the file descriptor or -1 with errno set.
+ */
+int
+arm64id_perf_event_open(enum arm64id_perf_event ev, int group_fd,
+    uint64_t config1)
+{
+#ifdef __linux__
+	struct perf_event_attr attr;
+
+	if ((u_int)ev >= ARM64ID_PERF_NEVENTS) {
+		errno = EINVAL;
+		return (-1);
+	}
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = perf_events[ev].type;
+	attr.config = perf_events[ev].config;
+	attr.config1 = config1;
+	attr.disabled = group_fd == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	    PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (syscall(SYS_perf_event_open, &attr, 0, -1, group_fd,
+	    PERF_FLAG_FD_CLOEXEC));
+#else
+	(void)ev;
+	(void)group_fd;
+	(void)config1;
+	errno = ENOSYS;
+	return (-1);
+#endif
+}
+
+/*
+ * Open a counter for each event. Returns 0 if the cycle counter could be
+ * opened, otherwise the error from opening it. The harness can be used
+ * either way, only the timer is valid if nothing could be opened.
+ */
+int
+arm64id_perf_open(struct arm64id_perf *perf)
+{
+	memset(perf, 0, sizeof(*perf));
+	perf->timer_freq = perf_timer_freq();
+	for (u_int i = 0; i < ARM64ID_PERF_NEVENTS; i++) {
+		perf->fds[i] = arm64id_perf_event_open(i, -1, 0);
+		perf->errors[i] = perf->fds[i] < 0 ? errno : 0;
+	}
+	return (perf->errors[ARM64ID_PERF_CYCLES]);
+}
+
+void
+arm64id_perf_close(struct arm64id_perf *perf)
+{
+	for (u_int i = 0; i < ARM64ID_PERF_NEVENTS; i++) {
+		if (perf->fds[i] >= 0)
+			close(perf->fds[i]);
+		perf->fds[i] = -1;
+	}
+}
+
+void
+arm64id_perf_start(struct arm64id_perf *perf)
+{
+#ifdef __linux__
+	for (u_int i = 0; i < ARM64ID_PERF_NEVENTS; i++) {
+		if (perf->fds[i] < 0)
+			continue;
+		ioctl(perf->fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(perf->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+	perf->timer_start = perf_timer();
+}
+
+/*
+ * Stop counting and fill in counts. Counters that were multiplexed with
+ * other events are scaled up to the time they were enabled, counters that
+ * never ran are left invalid.
+ */
+void
+arm64id_perf_stop(struct arm64id_perf *perf, struct arm64id_perf_counts *c)
+{
+	uint64_t end;
+
+	end = perf_timer();
+	memset(c, 0, sizeof(*c));
+	c->ticks = end - perf->timer_start;
+	c->nsec = (uint64_t)((double)c->ticks * 1e9 / perf->timer_freq);
+
+#ifdef __linux__
+	uint64_t buf[3];
+
+	for (u_int i = 0; i < ARM64ID_PERF_NEVENTS; i++) {
+		if (perf->fds[i] < 0)
+			continue;
+		ioctl(perf->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		/* value, time enabled, time running */
+		if (read(perf->fds[i], buf, sizeof(buf)) != sizeof(buf) ||
+		    buf[2] == 0)
+			continue;
+		c->counts[i] = buf[2] < buf[1] ?
+		    (uint64_t)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+		c->valid |= 1u << i;
+	}
+#endif
+}
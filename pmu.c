@@ -0,0 +1,353 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Report what the PMU can do for a userspace benchmark on this node: the
+ * PMU version from ID_AA64DFR0_EL1, whether the kernel lets us count
+ * events, how many counters can be used at once, whether the counters can
+ * be read directly from EL0, and a sample measurement with the
+ * arm64id_perf harness. This is arm64id -b pmu.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/perf_event.h>
+#endif
+
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#define	PMU_SYSCTL	"/proc/sys/kernel"
+#define	PMU_DEVICES	"/sys/bus/event_source/devices"
+/* PMUv3 has at most 31 event counters */
+#define	PMU_MAXCOUNTERS	31
+/* Bytes walked by the sample measurement, larger than most LLCs */
+#define	PMU_WALK_SIZE	(64 * 1024 * 1024)
+#define	PMU_WALK_PASSES	4
+
+static bool
+pmu_read_line(const char *path, char *buf, size_t len)
+{
+	FILE *fp;
+	bool ok;
+
+	fp = fopen(path, "re");
+	if (fp == NULL)
+		return (false);
+	ok = fgets(buf, len, fp) != NULL;
+	fclose(fp);
+	if (ok)
+		buf[strcspn(buf, "\n")] = '\0';
+	return (ok);
+}
+
+/*
+ * Check if the kernel has a CPU PMU, or an SPE PMU if spe is set. Used to
+ * tell a field the kernel hides from EL0 from a missing feature.
+ */
+static bool
+pmu_kernel_has(bool spe)
+{
+	char buf[256], path[PATH_MAX];
+	struct dirent *de;
+	DIR *dir;
+	bool found;
+
+	found = false;
+	dir = opendir(PMU_DEVICES);
+	while (!found && dir != NULL && (de = readdir(dir)) != NULL) {
+		if (de->d_name[0] == '.')
+			continue;
+		if (spe) {
+			found = strncmp(de->d_name, "arm_spe_", 8) == 0;
+			continue;
+		}
+		snprintf(path, sizeof(path), PMU_DEVICES "/%s/cpus",
+		    de->d_name);
+		found = pmu_read_line(path, buf, sizeof(buf));
+	}
+	if (dir != NULL)
+		closedir(dir);
+	return (found);
+}
+
+/*
+ * Linux hides the ID_AA64DFR0_EL1 PMU fields from EL0 so they read as 0
+ * even when the PMU is there. Report this when the kernel lists a PMU.
+ */
+static void
+pmu_print_fields(const struct arm64id_snapshot *snap)
+{
+	static const enum arm64id_field fields[] = {
+		ARM64ID_ID_AA64DFR0_EL1_PMUVer,
+		ARM64ID_ID_AA64DFR0_EL1_PMSVer,
+		ARM64ID_ID_AA64DFR0_EL1_BRBE,
+		ARM64ID_ID_AA64DFR0_EL1_MTPMU,
+	};
+	const struct arm64id_field_desc *desc;
+	const char *name;
+	int64_t val;
+	bool cpu_pmu, spe;
+
+	cpu_pmu = pmu_kernel_has(false);
+	spe = pmu_kernel_has(true);
+	for (size_t i = 0; i < nitems(fields); i++) {
+		desc = arm64id_field_desc(fields[i]);
+		if (snap == NULL || !arm64id_field_get(snap, fields[i], &val)) {
+			printf("%20s = <invalid>\n", desc->name);
+			continue;
+		}
+		if (val == 0 &&
+		    (fields[i] == ARM64ID_ID_AA64DFR0_EL1_PMSVer ? spe :
+		    cpu_pmu)) {
+			printf("%20s = hidden by the kernel\n", desc->name);
+			continue;
+		}
+		name = arm64id_field_value_name(fields[i], val);
+		printf("%20s = %"PRId64" (%s)\n", desc->name, val,
+		    name != NULL ? name : "unknown");
+	}
+}
+
+static void
+pmu_print_kernel(void)
+{
+	char buf[256], path[PATH_MAX];
+	struct dirent *de;
+	DIR *dir;
+	bool found;
+
+	if (!pmu_read_line(PMU_SYSCTL "/perf_event_paranoid", buf,
+	    sizeof(buf)))
+		snprintf(buf, sizeof(buf), "unknown");
+	printf("%20s = %s\n", "perf_event_paranoid", buf);
+	/* Added in Linux 5.17, without it EL0 counter access is disabled */
+	if (!pmu_read_line(PMU_SYSCTL "/perf_user_access", buf, sizeof(buf)))
+		snprintf(buf, sizeof(buf), "unsupported");
+	printf("%20s = %s\n", "perf_user_access", buf);
+
+	/* CPU PMUs list the CPUs they cover, uncore PMUs have a cpumask */
+	found = false;
+	dir = opendir(PMU_DEVICES);
+	while (dir != NULL && (de = readdir(dir)) != NULL) {
+		if (de->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), PMU_DEVICES "/%s/cpus",
+		    de->d_name);
+		if (!pmu_read_line(path, buf, sizeof(buf)))
+			continue;
+		printf("%20s = %s, cpus %s\n", "pmu", de->d_name, buf);
+		found = true;
+	}
+	if (dir != NULL)
+		closedir(dir);
+	if (!found)
+		printf("%20s = none found\n", "pmu");
+}
+
+#ifdef __linux__
+static void
+pmu_spin(void)
+{
+	for (volatile u_int i = 0; i < 100000; i++)
+		continue;
+}
+
+/*
+ * Find how many counters can count at once by growing a group of
+ * instruction counters until the kernel can't schedule it. Each takes a
+ * general purpose counter, the cycle counter is separate. Counters used
+ * by the kernel, e.g. for the NMI watchdog, aren't available. Returns -1
+ * if no counter could be opened.
+ */
+static int
+pmu_counters(void)
+{
+	uint64_t buf[3];
+	int fds[PMU_MAXCOUNTERS];
+	int k, n;
+	bool ran;
+
+	for (k = 1; k <= PMU_MAXCOUNTERS; k++) {
+		for (n = 0; n < k; n++) {
+			fds[n] = arm64id_perf_event_open(
+			    ARM64ID_PERF_INSTRUCTIONS, n == 0 ? -1 : fds[0], 0);
+			if (fds[n] < 0)
+				break;
+		}
+		ran = false;
+		if (n == k) {
+			ioctl(fds[0], PERF_EVENT_IOC_ENABLE,
+			    PERF_IOC_FLAG_GROUP);
+			pmu_spin();
+			ioctl(fds[0], PERF_EVENT_IOC_DISABLE,
+			    PERF_IOC_FLAG_GROUP);
+			/* value, time enabled, time running */
+			ran = read(fds[0], buf, sizeof(buf)) == sizeof(buf) &&
+			    buf[2] != 0;
+		}
+		while (n-- > 0)
+			close(fds[n]);
+		if (!ran)
+			return (k - 1 == 0 ? -1 : k - 1);
+	}
+	return (PMU_MAXCOUNTERS);
+}
+
+/*
+ * Check if the kernel lets us read the counters with mrs. On arm64 this
+ * needs perf_user_access set and the event opened with config1 bit 1.
+ */
+static bool
+pmu_user_access(void)
+{
+	struct perf_event_mmap_page *pc;
+	long pagesize;
+	bool ok;
+	int fd;
+
+	fd = arm64id_perf_event_open(ARM64ID_PERF_CYCLES, -1, 0x2);
+	if (fd < 0)
+		return (false);
+	pagesize = sysconf(_SC_PAGESIZE);
+	pc = mmap(NULL, pagesize, PROT_READ, MAP_SHARED, fd, 0);
+	ok = false;
+	if (pc != MAP_FAILED) {
+		ok = pc->cap_user_rdpmc != 0;
+		munmap(pc, pagesize);
+	}
+	close(fd);
+	return (ok);
+}
+#endif
+
+static void
+pmu_print_events(const struct arm64id_perf *perf)
+{
+	const char *name;
+
+	for (u_int i = 0; i < ARM64ID_PERF_NEVENTS; i++) {
+		name = arm64id_perf_event_name(i);
+		if (perf->errors[i] == 0)
+			printf("%20s = ok\n", name);
+		else
+			printf("%20s = %s\n", name, strerror(perf->errors[i]));
+	}
+#ifdef __linux__
+	int n;
+
+	n = pmu_counters();
+	if (n < 0)
+		printf("%20s = unknown\n", "counters");
+	else
+		printf("%20s = %d usable at once, plus the cycle counter\n",
+		    "counters", n);
+	printf("%20s = %s\n", "el0 access",
+	    pmu_user_access() ? "yes" : "no");
+#endif
+}
+
+/* Walk a buffer larger than the caches and report what was counted */
+static void
+pmu_measure(struct arm64id_perf *perf)
+{
+	struct arm64id_perf_counts c;
+	uint8_t *buf;
+	uint64_t sum;
+
+	buf = malloc(PMU_WALK_SIZE);
+	if (buf == NULL)
+		err(1, "malloc");
+	memset(buf, 1, PMU_WALK_SIZE);
+
+	sum = 0;
+	arm64id_perf_start(perf);
+	for (u_int pass = 0; pass < PMU_WALK_PASSES; pass++) {
+		for (size_t i = 0; i < PMU_WALK_SIZE; i += 64)
+			sum += buf[i];
+		/* Read the buffer again on each pass */
+		__asm __volatile("" :: "r"(buf) : "memory");
+	}
+	__asm __volatile("" :: "r"(sum));
+	arm64id_perf_stop(perf, &c);
+	free(buf);
+
+	printf("\nwalking %u MiB %u times, %"PRIu64" ns, %"PRIu64" timer "
+	    "ticks at %"PRIu64" Hz\n", PMU_WALK_SIZE / (1024 * 1024),
+	    PMU_WALK_PASSES, c.nsec, c.ticks, perf->timer_freq);
+	if (c.valid == 0) {
+		printf("no events counted, only timing is available\n");
+		return;
+	}
+	for (u_int i = 0; i < ARM64ID_PERF_NEVENTS; i++) {
+		if (arm64id_perf_valid(&c, i))
+			printf("%20s = %"PRIu64"\n",
+			    arm64id_perf_event_name(i), c.counts[i]);
+	}
+	if (arm64id_perf_valid(&c, ARM64ID_PERF_CYCLES) &&
+	    arm64id_perf_valid(&c, ARM64ID_PERF_INSTRUCTIONS) &&
+	    c.counts[ARM64ID_PERF_CYCLES] != 0)
+		printf("%20s = %.2f\n", "ipc",
+		    (double)c.counts[ARM64ID_PERF_INSTRUCTIONS] /
+		    c.counts[ARM64ID_PERF_CYCLES]);
+	if (arm64id_perf_valid(&c, ARM64ID_PERF_CYCLES) && c.nsec != 0)
+		printf("%20s = %.2f\n", "ghz",
+		    (double)c.counts[ARM64ID_PERF_CYCLES] / c.nsec);
+	(void)sum;
+}
+
+void
+bench_pmu(void)
+{
+	struct arm64id_perf perf;
+
+	printf("ID_AA64DFR0_EL1 as seen from userspace:\n");
+	pmu_print_fields(arm64id_snapshot_get());
+	printf("\nkernel:\n");
+	pmu_print_kernel();
+
+	arm64id_perf_open(&perf);
+	printf("\nperf_event_open:\n");
+	pmu_print_events(&perf);
+	pmu_measure(&perf);
+	arm64id_perf_close(&perf);
+}
@@ -0,0 +1,424 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * A Prometheus exporter, arm64id -P. Every CPU is probed once and the
+ * register values, HWCAPs and CPU classes are rendered into a single
+ * buffer in the Prometheus text format. The buffer is either written to
+ * a file for the node_exporter textfile collector, replaced atomically,
+ * or served over HTTP on the loopback address.
+ *
+ * The buffer holds the whole HTTP response so a scrape is a single write
+ * of it with no allocation or formatting. With an interval every CPU is
+ * probed again that often and the buffer is only replaced, or the file
+ * rewritten, when the output has changed.
+ */
+
+#ifdef __linux__
+#define	_GNU_SOURCE	/* For asprintf */
+#endif
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#define	PROM_CONTENT_TYPE	"text/plain; version=0.0.4; charset=utf-8"
+/* How long a client has to send its request or read the response */
+#define	PROM_CLIENT_TIMEOUT	2
+
+struct prom {
+	int		 flags;
+	char		*resp;		/* HTTP header followed by body */
+	size_t		 resp_len;
+	size_t		 body_off;
+};
+
+static const char prom_not_found[] =
+    "HTTP/1.0 404 Not Found\r\n"
+    "Content-Type: text/plain\r\n"
+    "Content-Length: 10\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "not found\n";
+
+static void
+prom_header(FILE *fp, const char *name, const char *help)
+{
+	fprintf(fp, "# HELP arm64id_%s %s\n", name, help);
+	fprintf(fp, "# TYPE arm64id_%s gauge\n", name);
+}
+
+/*
+ * Render the metrics. Label values all come from the built in tables so
+ * don't need escaping.
+ */
+static void
+prom_render(FILE *fp, const struct arm64id_cpu *cpus, u_int ncpus,
+    u_int nclasses)
+{
+	const struct arm64id_snapshot *snaps[MAX(nclasses, 1)];
+	const struct arm64id_hwcap *caps;
+	const struct arm64id_core *core;
+	const char *impl;
+	size_t ncaps;
+	uint32_t midr;
+	u_int counts[MAX(nclasses, 1)];
+	int midr_idx;
+
+	for (u_int c = 0; c < nclasses; c++) {
+		snaps[c] = NULL;
+		counts[c] = 0;
+		for (u_int i = 0; i < ncpus; i++) {
+			if (cpus[i].cpu_class != c)
+				continue;
+			if (snaps[c] == NULL)
+				snaps[c] = &cpus[i].snap;
+			counts[c]++;
+		}
+	}
+
+	prom_header(fp, "cpus", "Number of CPUs arm64id could run on.");
+	fprintf(fp, "arm64id_cpus %u\n", ncpus);
+	prom_header(fp, "classes",
+	    "Number of classes of CPU with the same ID registers.");
+	fprintf(fp, "arm64id_classes %u\n", nclasses);
+
+	prom_header(fp, "class_cpus", "Number of CPUs in each class.");
+	for (u_int c = 0; c < nclasses; c++)
+		fprintf(fp, "arm64id_class_cpus{class=\"%u\"} %u\n", c,
+		    counts[c]);
+
+	midr_idx = arm64id_reg_lookup("midr_el1");
+	prom_header(fp, "class_info", "The core in each class of CPU.");
+	for (u_int c = 0; c < nclasses; c++) {
+		if (midr_idx < 0 || !arm64id_reg_valid(snaps[c], midr_idx))
+			continue;
+		midr = snaps[c]->regs[midr_idx];
+		impl = arm64id_implementer_name(ARM64ID_MIDR_IMPLEMENTER(midr));
+		core = arm64id_core_lookup(midr);
+		fprintf(fp, "arm64id_class_info{class=\"%u\",midr=\"0x%08x\","
+		    "implementer=\"%s\",core=\"%s\",revision=\"r%up%u\"} 1\n",
+		    c, midr, impl != NULL ? impl : "unknown",
+		    core != NULL ? core->name : "unknown",
+		    ARM64ID_MIDR_VARIANT(midr), ARM64ID_MIDR_REVISION(midr));
+	}
+
+	prom_header(fp, "register_info",
+	    "The value of each ID register that reads the same on every CPU "
+	    "in a class.");
+	for (u_int c = 0; c < nclasses; c++) {
+		for (u_int r = 0; r < snaps[c]->nregs; r++) {
+			if (arm64id_reg_volatile(r) ||
+			    !arm64id_reg_valid(snaps[c], r))
+				continue;
+			fprintf(fp, "arm64id_register_info{class=\"%u\","
+			    "register=\"%s\",value=\"0x%016"PRIx64"\"} 1\n", c,
+			    arm64id_reg_name(r), snaps[c]->regs[r]);
+		}
+	}
+
+	/* The HWCAPs are from the process so are the same in every class */
+	prom_header(fp, "hwcap",
+	    "1 if the kernel reports the HWCAP, 0 if it doesn't.");
+	for (u_int word = 0; nclasses > 0 && word < ARM64ID_NHWCAPS; word++) {
+		if (!arm64id_hwcap_valid(snaps[0], word))
+			continue;
+		caps = arm64id_hwcap_list(word, &ncaps);
+		for (size_t i = 0; i < ncaps; i++)
+			fprintf(fp, "arm64id_hwcap{name=\"%s\"} %d\n",
+			    caps[i].name,
+			    (snaps[0]->hwcaps[word] & caps[i].cap) != 0);
+	}
+}
+
+/*
+ * Probe every CPU and render the response. Returns true if it differs
+ * from the cached response, which is then replaced.
+ */
+static bool
+prom_refresh(struct prom *p)
+{
+	struct arm64id_cpu *cpus;
+	FILE *fp;
+	char *body, *resp;
+	size_t body_len;
+	u_int ncpus, nclasses;
+	int error, len;
+
+	error = arm64id_probe_cpus(&cpus, &ncpus, p->flags);
+	if (error != 0) {
+		errno = error;
+		err(1, "unable to probe all CPUs");
+	}
+	nclasses = arm64id_classify_cpus(cpus, ncpus);
+
+	fp = open_memstream(&body, &body_len);
+	if (fp == NULL)
+		err(1, "open_memstream");
+	prom_render(fp, cpus, ncpus, nclasses);
+	if (fclose(fp) != 0)
+		err(1, "open_memstream");
+	free(cpus);
+
+	if (p->resp != NULL && body_len == p->resp_len - p->body_off &&
+	    memcmp(body, p->resp + p->body_off, body_len) == 0) {
+		free(body);
+		return (false);
+	}
+
+	len = asprintf(&resp, "HTTP/1.0 200 OK\r\n"
+	    "Content-Type: " PROM_CONTENT_TYPE "\r\n"
+	    "Content-Length: %zu\r\n"
+	    "Connection: close\r\n"
+	    "\r\n"
+	    "%s", body_len, body);
+	if (len < 0)
+		err(1, "asprintf");
+	free(p->resp);
+	p->resp = resp;
+	p->resp_len = len;
+	p->body_off = len - body_len;
+	free(body);
+	return (true);
+}
+
+static int
+prom_write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return (errno);
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return (0);
+}
+
+/* Replace path with the body, as the textfile collector may read it */
+static void
+prom_write_file(const struct prom *p, const char *path)
+{
+	char tmp[PATH_MAX];
+	int error, fd;
+
+	if (strcmp(path, "-") == 0) {
+		error = prom_write_all(STDOUT_FILENO, p->resp + p->body_off,
+		    p->resp_len - p->body_off);
+		if (error != 0) {
+			errno = error;
+			err(1, "stdout");
+		}
+		return;
+	}
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp))
+		errx(1, "%s: path too long", path);
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		err(1, "%s", tmp);
+	error = prom_write_all(fd, p->resp + p->body_off,
+	    p->resp_len - p->body_off);
+	if (error == 0 && fchmod(fd, 0644) != 0)
+		error = errno;
+	if (close(fd) != 0 && error == 0)
+		error = errno;
+	if (error == 0 && rename(tmp, path) != 0)
+		error = errno;
+	if (error != 0) {
+		unlink(tmp);
+		errno = error;
+		err(1, "%s", path);
+	}
+}
+
+static int
+prom_listen(u_int port)
+{
+	struct sockaddr_in sin;
+	int fd, on;
+
+	/* Not SOCK_CLOEXEC, macOS doesn't have it */
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		err(1, "socket");
+	if (fcntl(fd, F_SETFD, FD_CLOEXEC) != 0)
+		err(1, "fcntl");
+	on = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0)
+		err(1, "setsockopt");
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0)
+		err(1, "bind 127.0.0.1:%u", port);
+	if (listen(fd, 16) != 0)
+		err(1, "listen");
+	return (fd);
+}
+
+/*
+ * Answer one scrape. Only the request line is looked at, anything other
+ * than GET /metrics is not found. Errors from the client are ignored.
+ */
+static void
+prom_serve(const struct prom *p, int lfd)
+{
+	struct timeval tv;
+	char req[1024];
+	size_t len;
+	ssize_t ret;
+	int fd;
+
+	fd = accept(lfd, NULL, NULL);
+	if (fd < 0)
+		return;
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	tv.tv_sec = PROM_CLIENT_TIMEOUT;
+	tv.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	/* Read until the end of the request line */
+	len = 0;
+	while (len < sizeof(req) - 1 && memchr(req, '\n', len) == NULL) {
+		ret = read(fd, req + len, sizeof(req) - 1 - len);
+		if (ret <= 0) {
+			if (ret < 0 && errno == EINTR)
+				continue;
+			close(fd);
+			return;
+		}
+		len += ret;
+	}
+	req[len] = '\0';
+
+	if (strncmp(req, "GET /metrics ", 13) == 0 ||
+	    strncmp(req, "GET /metrics?", 13) == 0)
+		prom_write_all(fd, p->resp, p->resp_len);
+	else
+		prom_write_all(fd, prom_not_found, sizeof(prom_not_found) - 1);
+	shutdown(fd, SHUT_WR);
+	close(fd);
+}
+
+static uint64_t
+prom_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*
+ * Serve the metrics on port of the loopback address, or write them to
+ * output. With a non-zero interval every CPU is probed again every
+ * interval seconds and this never returns.
+ */
+int
+prom_main(double interval, bool fast, u_int port, const char *output)
+{
+	struct timespec ts;
+	struct pollfd pfd;
+	struct prom p;
+	uint64_t next, now;
+	int timeout;
+
+	memset(&p, 0, sizeof(p));
+	p.flags = fast ? ARM64ID_PROBE_FAST : 0;
+	prom_refresh(&p);
+
+	if (port == 0) {
+		if (output == NULL)
+			output = "-";
+		prom_write_file(&p, output);
+		ts.tv_sec = (time_t)interval;
+		ts.tv_nsec = (long)((interval - ts.tv_sec) * 1e9);
+		while (interval != 0) {
+			nanosleep(&ts, NULL);
+			if (prom_refresh(&p))
+				prom_write_file(&p, output);
+		}
+		free(p.resp);
+		return (0);
+	}
+
+	/* A scraper closing the connection early shouldn't kill us */
+	signal(SIGPIPE, SIG_IGN);
+	pfd.fd = prom_listen(port);
+	pfd.events = POLLIN;
+	next = prom_msec() + (uint64_t)(interval * 1000);
+	for (;;) {
+		timeout = -1;
+		if (interval != 0) {
+			now = prom_msec();
+			if (now >= next) {
+				prom_refresh(&p);
+				next = now + (uint64_t)(interval * 1000);
+			}
+			now = prom_msec();
+			timeout = now < next ? next - now : 0;
+		}
+		if (poll(&pfd, 1, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			err(1, "poll");
+		}
+		if ((pfd.revents & POLLIN) != 0)
+			prom_serve(&p, pfd.fd);
+	}
+}
@@ -0,0 +1,160 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+
+_Static_assert(sizeof(struct arm64id_record) % 8 == 0,
+    "arm64id_record must be a multiple of 8 bytes");
+_Static_assert(sizeof(struct arm64id_record) < UINT16_MAX,
+    "arm64id_record is too large");
+
+#if BYTE_ORDER != LITTLE_ENDIAN
+#error The binary record format is only supported on little endian hosts
+#endif
+
+/*
+ * Fill in a record from a snapshot. The hostname is taken from the local
+ * host.
+ */
+void
+arm64id_record_init(struct arm64id_record *rec,
+    const struct arm64id_snapshot *snap, u_int cpu_class, u_int nclasses,
+    u_int ncpus)
+{
+	memset(rec, 0, sizeof(*rec));
+	rec->magic = ARM64ID_RECORD_MAGIC;
+	rec->version = ARM64ID_RECORD_VERSION;
+	rec->size = sizeof(*rec);
+	rec->cpu_class = cpu_class;
+	rec->nclasses = nclasses;
+	rec->ncpus = ncpus;
+	if (gethostname(rec->hostname, sizeof(rec->hostname)) != 0)
+		rec->hostname[0] = '\0';
+	rec->hostname[sizeof(rec->hostname) - 1] = '\0';
+	memcpy(&rec->snap, snap, sizeof(rec->snap));
+}
+
+bool
+arm64id_record_valid(const struct arm64id_record *rec)
+{
+	return (rec->magic == ARM64ID_RECORD_MAGIC &&
+	    rec->version == ARM64ID_RECORD_VERSION &&
+	    rec->size == sizeof(*rec) &&
+	    rec->snap.version == ARM64ID_SNAPSHOT_VERSION &&
+	    rec->snap.nregs == ARM64ID_NREGS);
+}
+
+int
+arm64id_record_write(int fd, const struct arm64id_record *recs, size_t nrecs)
+{
+	const char *buf;
+	size_t len;
+	ssize_t ret;
+
+	buf = (const char *)recs;
+	len = nrecs * sizeof(*recs);
+	while (len > 0) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return (errno);
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return (0);
+}
+
+/*
+ * Map an archive of concatenated records so they can be accessed in place
+ * with ARM64ID_ARCHIVE_FOREACH. Only the first record is checked here to
+ * avoid touching the whole file, callers should skip records where
+ * arm64id_record_valid() is false.
+ */
+int
+arm64id_archive_open(const char *path, struct arm64id_archive *ar)
+{
+	struct stat sb;
+	void *map;
+	size_t nrecs;
+	int error, fd;
+
+	memset(ar, 0, sizeof(*ar));
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return (errno);
+	if (fstat(fd, &sb) != 0) {
+		error = errno;
+		close(fd);
+		return (error);
+	}
+	if (sb.st_size == 0 || sb.st_size % sizeof(struct arm64id_record) != 0) {
+		close(fd);
+		return (EINVAL);
+	}
+
+	map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	error = errno;
+	close(fd);
+	if (map == MAP_FAILED)
+		return (error);
+	(void)madvise(map, sb.st_size, MADV_SEQUENTIAL);
+
+	nrecs = sb.st_size / sizeof(struct arm64id_record);
+	ar->records = map;
+	ar->nrecords = nrecs;
+	ar->map_size = sb.st_size;
+
+	if (!arm64id_record_valid(&ar->records[0])) {
+		arm64id_archive_close(ar);
+		return (EINVAL);
+	}
+
+	return (0);
+}
+
+void
+arm64id_archive_close(struct arm64id_archive *ar)
+{
+	if (ar->records != NULL)
+		munmap((void *)(uintptr_t)ar->records, ar->map_size);
+	memset(ar, 0, sizeof(*ar));
+}
@@ -0,0 +1,209 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef __linux__
+#define	_GNU_SOURCE	/* For sched_setaffinity */
+#endif
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm64id.h"
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#define	HAVE_SCHED_AFFINITY
+#endif
+
+struct sweep_worker {
+	pthread_t		 thread;
+	struct arm64id_cpu	*cpu;
+	int			 flags;
+	bool			 started;
+};
+
+#ifdef HAVE_SCHED_AFFINITY
+static void *
+sweep_thread(void *arg)
+{
+	struct sweep_worker *worker;
+	struct arm64id_cpu *cpu;
+	cpu_set_t set;
+
+	worker = arg;
+	cpu = worker->cpu;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu->cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+		cpu->error = errno;
+		return (NULL);
+	}
+
+	cpu->error = arm64id_probe_flags(&cpu->snap, worker->flags, NULL);
+	return (NULL);
+}
+#endif
+
+/*
+ * Probe every CPU the process is allowed to run on. One thread is started
+ * per CPU and pinned to it so all CPUs are probed in parallel. On success
+ * *cpusp is set to an array of *ncpusp entries the caller should free.
+ */
+int
+arm64id_probe_cpus(struct arm64id_cpu **cpusp, u_int *ncpusp, int flags)
+{
+#ifdef HAVE_SCHED_AFFINITY
+	struct sweep_worker *workers;
+	struct arm64id_cpu *cpus;
+	cpu_set_t online;
+	u_int i, ncpus;
+	int error;
+
+	CPU_ZERO(&online);
+	if (sched_getaffinity(0, sizeof(online), &online) != 0)
+		return (errno);
+
+	ncpus = CPU_COUNT(&online);
+	if (ncpus == 0)
+		return (ENXIO);
+
+	cpus = calloc(ncpus, sizeof(*cpus));
+	workers = calloc(ncpus, sizeof(*workers));
+	if (cpus == NULL || workers == NULL) {
+		free(cpus);
+		free(workers);
+		return (ENOMEM);
+	}
+
+	i = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE && i < ncpus; cpu++) {
+		if (!CPU_ISSET(cpu, &online))
+			continue;
+		cpus[i].cpu = cpu;
+		workers[i].cpu = &cpus[i];
+		workers[i].flags = flags;
+		i++;
+	}
+
+	for (i = 0; i < ncpus; i++) {
+		error = pthread_create(&workers[i].thread, NULL, sweep_thread,
+		    &workers[i]);
+		if (error != 0) {
+			cpus[i].error = error;
+			continue;
+		}
+		workers[i].started = true;
+	}
+
+	for (i = 0; i < ncpus; i++) {
+		if (workers[i].started)
+			pthread_join(workers[i].thread, NULL);
+	}
+	free(workers);
+
+	*cpusp = cpus;
+	*ncpusp = ncpus;
+	return (0);
+#else
+	(void)cpusp;
+	(void)ncpusp;
+	(void)flags;
+	return (EOPNOTSUPP);
+#endif
+}
+
+/*
+ * Compare two snapshots ignoring registers that are expected to differ
+ * between identical CPUs, e.g. MPIDR_EL1 and the counters.
+ */
+bool
+arm64id_snapshot_same_class(const struct arm64id_snapshot *a,
+    const struct arm64id_snapshot *b)
+{
+	bool va, vb;
+
+	if (a->nregs != b->nregs)
+		return (false);
+	for (u_int i = 0; i < a->nregs; i++) {
+		if (arm64id_reg_volatile(i))
+			continue;
+		va = arm64id_reg_valid(a, i);
+		vb = arm64id_reg_valid(b, i);
+		if (va != vb)
+			return (false);
+		if (va && a->regs[i] != b->regs[i])
+			return (false);
+	}
+	if (a->hwcap_valid != b->hwcap_valid)
+		return (false);
+	return (memcmp(a->hwcaps, b->hwcaps, sizeof(a->hwcaps)) == 0);
+}
+
+/*
+ * Group CPUs with the same register values into classes. The class of
+ * each CPU is stored in cpu_class, classes are numbered in order of the
+ * first CPU in them. CPUs that failed to probe are left in no class.
+ * Returns the number of classes.
+ */
+u_int
+arm64id_classify_cpus(struct arm64id_cpu *cpus, u_int ncpus)
+{
+	u_int *first, nclasses;
+
+	first = calloc(ncpus, sizeof(*first));
+	if (first == NULL)
+		return (0);
+
+	nclasses = 0;
+	for (u_int i = 0; i < ncpus; i++) {
+		u_int c;
+
+		cpus[i].cpu_class = UINT_MAX;
+		if (cpus[i].error != 0)
+			continue;
+		for (c = 0; c < nclasses; c++) {
+			if (arm64id_snapshot_same_class(&cpus[first[c]].snap,
+			    &cpus[i].snap))
+				break;
+		}
+		if (c == nclasses)
+			first[nclasses++] = i;
+		cpus[i].cpu_class = c;
+	}
+
+	free(first);
+	return (nclasses);
+}
@@ -0,0 +1,403 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Characterise the generic timer counters as a clock: the cost of a read
+ * with and without an ISB, the resolution compared with CNTFRQ_EL0, if
+ * back-to-back reads are monotonic, and the skew between CPUs. Results
+ * are per class of CPU. This is the "timer" benchmark.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#define	TIMER_READS	(1000 * 1000)
+/* How long to compare the counter with CLOCK_MONOTONIC for */
+#define	TIMER_RATE_USEC	(100 * 1000)
+#define	SKEW_ROUNDS	(100 * 1000)
+
+#ifdef __aarch64__
+enum timer_counter {
+	TIMER_CNTVCT,
+	TIMER_CNTPCT,
+	TIMER_CNTVCTSS,
+	TIMER_CNTPCTSS,
+	TIMER_NCOUNTERS
+};
+
+static const char *timer_names[TIMER_NCOUNTERS] = {
+	[TIMER_CNTVCT] = "cntvct_el0",
+	[TIMER_CNTPCT] = "cntpct_el0",
+	[TIMER_CNTVCTSS] = "cntvctss_el0",
+	[TIMER_CNTPCTSS] = "cntpctss_el0",
+};
+
+struct timer_result {
+	double		ns;		/* Per read */
+	uint64_t	step;		/* Smallest non-zero difference */
+	uint64_t	repeats;	/* Reads that returned the last value */
+	uint64_t	backwards;	/* Reads less than the last value */
+};
+
+struct skew_line {
+	volatile uint64_t seq;
+	volatile uint64_t ts;
+} __attribute__((__aligned__(128)));
+
+struct skew_shared {
+	struct skew_line request;
+	struct skew_line reply;
+	int		 cpu;
+	bool		 pinned;
+};
+
+/*
+ * Read a counter. counter and isb are constants in the callers so each
+ * loop below is built around a single mrs.
+ */
+static inline __attribute__((__always_inline__)) uint64_t
+timer_read(enum timer_counter counter, bool isb)
+{
+	uint64_t val;
+
+	if (isb)
+		__asm __volatile("isb" ::: "memory");
+	switch (counter) {
+	case TIMER_CNTVCT:
+		__asm __volatile("mrs %0, cntvct_el0" : "=r"(val));
+		break;
+	case TIMER_CNTPCT:
+		__asm __volatile("mrs %0, cntpct_el0" : "=r"(val));
+		break;
+	case TIMER_CNTVCTSS:
+		__asm __volatile("mrs %0, S3_3_C14_C0_6" : "=r"(val));
+		break;
+	case TIMER_CNTPCTSS:
+		__asm __volatile("mrs %0, S3_3_C14_C0_5" : "=r"(val));
+		break;
+	default:
+		val = 0;
+		break;
+	}
+	return (val);
+}
+
+static inline __attribute__((__always_inline__)) void
+timer_loop(struct timer_result *r, enum timer_counter counter, bool isb)
+{
+	uint64_t cur, prev, start;
+
+	start = bench_nsec();
+	for (u_int i = 0; i < TIMER_READS; i++)
+		(void)timer_read(counter, isb);
+	r->ns = (double)(bench_nsec() - start) / TIMER_READS;
+
+	r->step = UINT64_MAX;
+	r->repeats = r->backwards = 0;
+	prev = timer_read(counter, isb);
+	for (u_int i = 0; i < TIMER_READS; i++) {
+		cur = timer_read(counter, isb);
+		if (cur < prev)
+			r->backwards++;
+		else if (cur == prev)
+			r->repeats++;
+		else if (cur - prev < r->step)
+			r->step = cur - prev;
+		prev = cur;
+	}
+	if (r->step == UINT64_MAX)
+		r->step = 0;
+}
+
+/* Fill in r[0] without an ISB and r[1] with one */
+static void
+timer_measure(enum timer_counter counter, struct timer_result r[2])
+{
+	switch (counter) {
+	case TIMER_CNTVCT:
+		timer_loop(&r[0], TIMER_CNTVCT, false);
+		timer_loop(&r[1], TIMER_CNTVCT, true);
+		break;
+	case TIMER_CNTPCT:
+		timer_loop(&r[0], TIMER_CNTPCT, false);
+		timer_loop(&r[1], TIMER_CNTPCT, true);
+		break;
+	case TIMER_CNTVCTSS:
+		timer_loop(&r[0], TIMER_CNTVCTSS, false);
+		timer_loop(&r[1], TIMER_CNTVCTSS, true);
+		break;
+	case TIMER_CNTPCTSS:
+		timer_loop(&r[0], TIMER_CNTPCTSS, false);
+		timer_loop(&r[1], TIMER_CNTPCTSS, true);
+		break;
+	default:
+		break;
+	}
+}
+
+/* The counter frequency measured against CLOCK_MONOTONIC */
+static double
+timer_rate(void)
+{
+	uint64_t c0, c1, n0, n1;
+
+	n0 = bench_nsec();
+	c0 = timer_read(TIMER_CNTVCT, true);
+	usleep(TIMER_RATE_USEC);
+	c1 = timer_read(TIMER_CNTVCT, true);
+	n1 = bench_nsec();
+	return ((double)(c1 - c0) * 1000000000 / (n1 - n0));
+}
+
+/*
+ * The remote side of the skew measurement. Each round it waits for a
+ * request and replies with a timestamp.
+ */
+static void *
+skew_thread(void *arg)
+{
+	struct skew_shared *ss;
+	uint64_t ts;
+
+	ss = arg;
+	ss->pinned = bench_pin(ss->cpu);
+	__atomic_store_n(&ss->reply.seq, 0, __ATOMIC_RELEASE);
+	for (uint64_t seq = 1; seq <= SKEW_ROUNDS; seq++) {
+		while (__atomic_load_n(&ss->request.seq, __ATOMIC_ACQUIRE) !=
+		    seq)
+			;
+		ts = timer_read(TIMER_CNTVCT, true);
+		ss->reply.ts = ts;
+		__atomic_store_n(&ss->reply.seq, seq, __ATOMIC_RELEASE);
+	}
+	return (NULL);
+}
+
+/*
+ * Measure the offset of the counter on cpu from the counter on ref with a
+ * ping-pong: ref reads t1 and sends a request, cpu replies with t2 and ref
+ * reads t3 when the reply arrives. As t1 <= t2 <= t3 when the counters are
+ * in sync the offset is bounded by t2 - t3 and t2 - t1 each round. The
+ * estimate is from the round with the shortest round trip.
+ */
+static void
+timer_skew(int ref, int cpu, double frq)
+{
+	struct skew_shared *ss;
+	pthread_t thread;
+	int64_t lo, hi, off;
+	uint64_t rtt, t1, t2, t3;
+
+	if (!bench_pin(ref)) {
+		printf("  skew: unable to pin to cpu %d\n", ref);
+		return;
+	}
+	if (posix_memalign((void **)&ss, sizeof(struct skew_line),
+	    sizeof(*ss)) != 0)
+		err(1, "posix_memalign");
+	memset(ss, 0, sizeof(*ss));
+	ss->cpu = cpu;
+	ss->reply.seq = UINT64_MAX;
+	if (pthread_create(&thread, NULL, skew_thread, ss) != 0)
+		errx(1, "pthread_create");
+	while (__atomic_load_n(&ss->reply.seq, __ATOMIC_ACQUIRE) != 0)
+		;
+
+	lo = INT64_MIN;
+	hi = INT64_MAX;
+	rtt = UINT64_MAX;
+	off = 0;
+	for (uint64_t seq = 1; seq <= SKEW_ROUNDS; seq++) {
+		t1 = timer_read(TIMER_CNTVCT, true);
+		__atomic_store_n(&ss->request.seq, seq, __ATOMIC_RELEASE);
+		while (__atomic_load_n(&ss->reply.seq, __ATOMIC_ACQUIRE) !=
+		    seq)
+			;
+		t2 = ss->reply.ts;
+		t3 = timer_read(TIMER_CNTVCT, true);
+
+		lo = MAX(lo, (int64_t)(t2 - t3));
+		hi = MIN(hi, (int64_t)(t2 - t1));
+		if (t3 - t1 < rtt) {
+			rtt = t3 - t1;
+			off = (int64_t)(t2 - t1) - (int64_t)(rtt / 2);
+		}
+	}
+	pthread_join(thread, NULL);
+
+	if (!ss->pinned)
+		printf("  skew: unable to pin to cpu %d\n", cpu);
+	else
+		printf("  skew cpu %d vs cpu %d: %+.1f ns (bounds %+.1f to "
+		    "%+.1f ns, min round trip %.1f ns)%s\n", cpu, ref,
+		    off * 1e9 / frq, lo * 1e9 / frq, hi * 1e9 / frq,
+		    rtt * 1e9 / frq,
+		    lo > 0 || hi < 0 ? ", out of sync" : "");
+	free(ss);
+}
+
+/* Print the results for one class, returns the counter frequency */
+static double
+timer_class(const struct arm64id_snapshot *snap)
+{
+	const struct arm64id_core *core;
+	struct timer_result r[2];
+	double frq, rate;
+	int64_t ecv;
+	int idx;
+
+	idx = arm64id_reg_lookup("midr_el1");
+	if (idx >= 0 && arm64id_reg_valid(snap, idx)) {
+		core = arm64id_core_lookup(snap->regs[idx]);
+		if (core != NULL)
+			printf("  %s\n", core->name);
+	}
+
+	idx = arm64id_reg_lookup("cntfrq_el0");
+	frq = 0;
+	if (idx >= 0 && arm64id_reg_valid(snap, idx))
+		frq = (uint32_t)snap->regs[idx];
+	rate = timer_rate();
+	if (frq == 0) {
+		printf("  %-14s unknown, using the measured rate\n",
+		    "cntfrq_el0");
+		frq = rate;
+	} else
+		printf("  %-14s %10.3f MHz, %.2f ns/tick\n", "cntfrq_el0",
+		    frq / 1e6, 1e9 / frq);
+	printf("  %-14s %10.3f MHz (%+.3f%%)\n\n", "measured", rate / 1e6,
+	    (rate - frq) * 100 / frq);
+
+	if (!arm64id_field_get(snap, ARM64ID_ID_AA64MMFR0_EL1_ECV, &ecv))
+		ecv = 0;
+	printf("  %-14s %4s %8s %6s %10s %8s %9s\n", "counter", "isb",
+	    "ns/read", "step", "resolution", "repeats", "backwards");
+	for (u_int c = 0; c < TIMER_NCOUNTERS; c++) {
+		if ((c == TIMER_CNTVCTSS || c == TIMER_CNTPCTSS) && ecv < 1) {
+			printf("  %-14s needs ECV\n", timer_names[c]);
+			continue;
+		}
+		/* The snapshot only has the counters EL0 can read */
+		idx = arm64id_reg_lookup(timer_names[c]);
+		if (idx < 0 || !arm64id_reg_valid(snap, idx)) {
+			printf("  %-14s not readable\n", timer_names[c]);
+			continue;
+		}
+		timer_measure(c, r);
+		for (u_int i = 0; i < nitems(r); i++)
+			printf("  %-14s %4s %8.2f %6" PRIu64 " %7.2f ns "
+			    "%8" PRIu64 " %9" PRIu64 "\n", timer_names[c],
+			    i == 0 ? "no" : "yes", r[i].ns, r[i].step,
+			    r[i].step * 1e9 / frq, r[i].repeats,
+			    r[i].backwards);
+	}
+	return (frq);
+}
+#endif
+
+void
+bench_timer(void)
+{
+#ifdef __aarch64__
+	struct arm64id_snapshot *snap;
+	struct arm64id_cpu *cpus;
+	double frq;
+	u_int count, ncpus, nclasses;
+	int error, first, other, ref, target;
+
+	error = arm64id_probe_cpus(&cpus, &ncpus, 0);
+	if (error != 0) {
+		/* Without affinity measure wherever this thread runs */
+		snap = malloc(sizeof(*snap));
+		if (snap == NULL)
+			err(1, "malloc");
+		error = arm64id_probe(snap);
+		if (error != 0) {
+			errno = error;
+			err(1, "unable to read the ID registers");
+		}
+		printf("all cpus, skew not measured:\n");
+		(void)timer_class(snap);
+		free(snap);
+		return;
+	}
+	nclasses = arm64id_classify_cpus(cpus, ncpus);
+
+	/* Skew is measured against the first CPU */
+	ref = -1;
+	for (u_int i = 0; i < ncpus && ref < 0; i++) {
+		if (cpus[i].error == 0)
+			ref = cpus[i].cpu;
+	}
+
+	for (u_int c = 0; c < nclasses; c++) {
+		count = 0;
+		first = other = -1;
+		for (u_int i = 0; i < ncpus; i++) {
+			if (cpus[i].cpu_class != c)
+				continue;
+			count++;
+			if (first < 0)
+				first = i;
+			else if (other < 0)
+				other = i;
+		}
+		if (c != 0)
+			printf("\n");
+		printf("class %u: %u cpu%s, measured on cpu %d\n", c, count,
+		    count == 1 ? "" : "s", cpus[first].cpu);
+		if (!bench_pin(cpus[first].cpu))
+			printf("  unable to pin to cpu %d\n", cpus[first].cpu);
+		frq = timer_class(&cpus[first].snap);
+
+		target = cpus[first].cpu;
+		if (target == ref)
+			target = other >= 0 ? cpus[other].cpu : -1;
+		if (target < 0)
+			printf("  skew: needs two cpus\n");
+		else
+			timer_skew(ref, target, frq);
+	}
+	free(cpus);
+#else
+	printf("timer: needs the arm64 generic timer\n");
+#endif
+}
@@ -0,0 +1,883 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * The CPU topology: where each CPU is from MPIDR_EL1, which caches it
+ * shares with other CPUs from sysfs, and a plan to pin a number of worker
+ * threads so they share as few last level caches as possible. This is
+ * arm64id -T.
+ *
+ * Linux emulates MPIDR_EL1 reads from userspace with a fixed value, so when
+ * every CPU reports the same affinity the kernel's view of the topology in
+ * sysfs is used instead.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#define	TOPO_SYSFS	"/sys/devices/system/cpu"
+#define	TOPO_MAXCPUS	1024
+/* The most cacheN/indexM directories read per CPU */
+#define	TOPO_MAXCACHES	8
+/* The affinity fields of MPIDR_EL1, Aff3 and Aff2..Aff0 */
+#define	TOPO_AFF_MASK	0xff00ffffffULL
+
+struct topo_set {
+	uint64_t	bits[TOPO_MAXCPUS / 64];
+};
+
+/* A cache and the CPUs sharing it */
+struct topo_cache {
+	u_int		level;
+	char		type[16];	/* Data, Instruction or Unified */
+	uint64_t	size;		/* In bytes, 0 if unknown */
+	struct topo_set	cpus;
+};
+
+/* CPUs sharing a last level cache, the unit the workers are spread over */
+struct topo_llc {
+	int		cache;		/* Index in caches, -1 if a cluster */
+	u_int		first;		/* Index in cpus of the first CPU */
+	struct topo_set	cpus;
+	u_int		ncores;
+	u_int		nworkers;
+};
+
+struct topo_cpu {
+	int		cpu;
+	u_int		cpu_class;
+	bool		have_mpidr;
+	uint64_t	mpidr;
+	/* From MPIDR_EL1 or sysfs, see topo_locate */
+	int		package;
+	int		cluster;
+	int		core;
+	int		thread;
+	u_int		ncaches;
+	u_int		caches[TOPO_MAXCACHES];
+	u_int		llc;
+};
+
+struct topo {
+	struct topo_cpu	*cpus;
+	u_int		 ncpus;
+	u_int		 nclasses;
+	bool		 have_mpidr;	/* MPIDR_EL1 was read on every CPU */
+	bool		 from_mpidr;
+	struct topo_cache *caches;
+	u_int		 ncaches;
+	struct topo_llc	*llcs;
+	u_int		 nllcs;
+};
+
+static void
+topo_set_add(struct topo_set *set, int cpu)
+{
+	if (cpu >= 0 && cpu < TOPO_MAXCPUS)
+		set->bits[cpu / 64] |= (uint64_t)1 << (cpu % 64);
+}
+
+static bool
+topo_set_has(const struct topo_set *set, int cpu)
+{
+	return (cpu >= 0 && cpu < TOPO_MAXCPUS &&
+	    (set->bits[cpu / 64] & ((uint64_t)1 << (cpu % 64))) != 0);
+}
+
+static bool
+topo_set_equal(const struct topo_set *a, const struct topo_set *b)
+{
+	return (memcmp(a, b, sizeof(*a)) == 0);
+}
+
+static u_int
+topo_set_count(const struct topo_set *set)
+{
+	u_int n;
+
+	n = 0;
+	for (u_int i = 0; i < nitems(set->bits); i++)
+		n += __builtin_popcountll(set->bits[i]);
+	return (n);
+}
+
+/* Parse a Linux CPU list, e.g. "0-3,8,10-11" */
+static bool
+topo_set_parse(struct topo_set *set, const char *list)
+{
+	char *end;
+	long first, last;
+
+	memset(set, 0, sizeof(*set));
+	while (*list != '\0' && *list != '\n') {
+		first = strtol(list, &end, 10);
+		if (end == list || first < 0)
+			return (false);
+		last = first;
+		if (*end == '-') {
+			list = end + 1;
+			last = strtol(list, &end, 10);
+			if (end == list || last < first)
+				return (false);
+		}
+		for (long cpu = first; cpu <= last && cpu < TOPO_MAXCPUS; cpu++)
+			topo_set_add(set, cpu);
+		list = end;
+		if (*list == ',')
+			list++;
+	}
+	return (true);
+}
+
+/* Print a set in the same form as Linux CPU lists */
+static void
+topo_set_print(FILE *fp, const struct topo_set *set)
+{
+	const char *sep;
+	int first;
+
+	sep = "";
+	for (int cpu = 0; cpu < TOPO_MAXCPUS; cpu++) {
+		if (!topo_set_has(set, cpu))
+			continue;
+		first = cpu;
+		while (topo_set_has(set, cpu + 1))
+			cpu++;
+		if (first == cpu)
+			fprintf(fp, "%s%d", sep, cpu);
+		else
+			fprintf(fp, "%s%d-%d", sep, first, cpu);
+		sep = ",";
+	}
+	if (*sep == '\0')
+		fprintf(fp, "-");
+}
+
+/* Read a sysfs file for a CPU, without the trailing newline */
+static bool
+topo_read(int cpu, const char *file, char *buf, size_t len)
+{
+	char path[128];
+	FILE *fp;
+	bool ok;
+
+	snprintf(path, sizeof(path), TOPO_SYSFS "/cpu%d/%s", cpu, file);
+	fp = fopen(path, "re");
+	if (fp == NULL)
+		return (false);
+	ok = fgets(buf, len, fp) != NULL;
+	fclose(fp);
+	if (ok)
+		buf[strcspn(buf, "\n")] = '\0';
+	return (ok);
+}
+
+static bool
+topo_read_int(int cpu, const char *file, int *valp)
+{
+	char buf[32], *end;
+	long val;
+
+	if (!topo_read(cpu, file, buf, sizeof(buf)))
+		return (false);
+	val = strtol(buf, &end, 10);
+	if (end == buf || *end != '\0')
+		return (false);
+	*valp = val;
+	return (true);
+}
+
+/* Sizes are given as a number of bytes with an optional K, M or G */
+static uint64_t
+topo_parse_size(const char *buf)
+{
+	uint64_t size;
+	char *end;
+
+	size = strtoull(buf, &end, 10);
+	switch (*end) {
+	case 'G':
+		size *= 1024;
+		/* FALLTHROUGH */
+	case 'M':
+		size *= 1024;
+		/* FALLTHROUGH */
+	case 'K':
+		size *= 1024;
+		break;
+	}
+	return (size);
+}
+
+/*
+ * Find where a CPU is from its MPIDR_EL1. When MT is set Aff0 is the
+ * thread within a core, otherwise it is the core and there is one thread.
+ * The next two levels up are taken as the cluster and the package.
+ */
+static void
+topo_decode_mpidr(struct topo_cpu *tc)
+{
+	u_int aff[4];
+
+	aff[0] = tc->mpidr & 0xff;
+	aff[1] = (tc->mpidr >> 8) & 0xff;
+	aff[2] = (tc->mpidr >> 16) & 0xff;
+	aff[3] = (tc->mpidr >> 32) & 0xff;
+	if ((tc->mpidr & (1ul << 24)) != 0) {
+		tc->thread = aff[0];
+		tc->core = aff[1];
+		tc->cluster = aff[2];
+		tc->package = aff[3];
+	} else {
+		tc->thread = 0;
+		tc->core = aff[0];
+		tc->cluster = aff[1];
+		tc->package = aff[2] | aff[3] << 8;
+	}
+}
+
+/* Find where a CPU is from the kernel's topology in sysfs */
+static void
+topo_sysfs_locate(struct topo_cpu *tc)
+{
+	struct topo_set siblings;
+	char buf[256];
+
+	if (!topo_read_int(tc->cpu, "topology/physical_package_id",
+	    &tc->package))
+		tc->package = 0;
+	/* The cluster is only given by newer kernels, and may be -1 */
+	if (!topo_read_int(tc->cpu, "topology/cluster_id", &tc->cluster) ||
+	    tc->cluster < 0)
+		tc->cluster = tc->package;
+	if (!topo_read_int(tc->cpu, "topology/core_id", &tc->core))
+		tc->core = tc->cpu;
+	/* The thread is the number of siblings before this CPU */
+	tc->thread = 0;
+	if (topo_read(tc->cpu, "topology/thread_siblings_list", buf,
+	    sizeof(buf)) && topo_set_parse(&siblings, buf)) {
+		for (int cpu = 0; cpu < tc->cpu; cpu++)
+			tc->thread += topo_set_has(&siblings, cpu);
+	}
+}
+
+/*
+ * Use MPIDR_EL1 when every CPU has a different affinity, otherwise it is
+ * being emulated or wasn't readable so use sysfs.
+ */
+static void
+topo_locate(struct topo *t)
+{
+	t->have_mpidr = true;
+	for (u_int i = 0; i < t->ncpus; i++)
+		t->have_mpidr &= t->cpus[i].have_mpidr;
+	t->from_mpidr = t->have_mpidr;
+	for (u_int i = 0; i < t->ncpus && t->from_mpidr; i++) {
+		for (u_int j = 0; j < i; j++) {
+			if (((t->cpus[i].mpidr ^ t->cpus[j].mpidr) &
+			    TOPO_AFF_MASK) == 0) {
+				t->from_mpidr = false;
+				break;
+			}
+		}
+	}
+	for (u_int i = 0; i < t->ncpus; i++) {
+		if (t->from_mpidr)
+			topo_decode_mpidr(&t->cpus[i]);
+		else
+			topo_sysfs_locate(&t->cpus[i]);
+	}
+}
+
+/* Read the caches of a CPU, merging them with those already seen */
+static void
+topo_read_caches(struct topo *t, struct topo_cpu *tc)
+{
+	struct topo_cache cache;
+	char buf[256], file[64];
+	int level;
+	u_int c;
+
+	tc->ncaches = 0;
+	for (u_int i = 0; i < TOPO_MAXCACHES; i++) {
+		memset(&cache, 0, sizeof(cache));
+		snprintf(file, sizeof(file), "cache/index%u/level", i);
+		if (!topo_read_int(tc->cpu, file, &level))
+			break;
+		cache.level = level;
+		snprintf(file, sizeof(file), "cache/index%u/type", i);
+		if (!topo_read(tc->cpu, file, cache.type, sizeof(cache.type)))
+			snprintf(cache.type, sizeof(cache.type), "Unknown");
+		snprintf(file, sizeof(file), "cache/index%u/size", i);
+		if (topo_read(tc->cpu, file, buf, sizeof(buf)))
+			cache.size = topo_parse_size(buf);
+		/* Assume the cache is private if the sharing is unknown */
+		snprintf(file, sizeof(file), "cache/index%u/shared_cpu_list",
+		    i);
+		if (!topo_read(tc->cpu, file, buf, sizeof(buf)) ||
+		    !topo_set_parse(&cache.cpus, buf) ||
+		    !topo_set_has(&cache.cpus, tc->cpu)) {
+			memset(&cache.cpus, 0, sizeof(cache.cpus));
+			topo_set_add(&cache.cpus, tc->cpu);
+		}
+
+		for (c = 0; c < t->ncaches; c++) {
+			if (t->caches[c].level == cache.level &&
+			    strcmp(t->caches[c].type, cache.type) == 0 &&
+			    topo_set_equal(&t->caches[c].cpus, &cache.cpus))
+				break;
+		}
+		if (c == t->ncaches)
+			t->caches[t->ncaches++] = cache;
+		tc->caches[tc->ncaches++] = c;
+	}
+}
+
+/* The last level data or unified cache of a CPU, or -1 if unknown */
+static int
+topo_cpu_llc(const struct topo *t, const struct topo_cpu *tc)
+{
+	const struct topo_cache *cache;
+	int llc;
+
+	llc = -1;
+	for (u_int i = 0; i < tc->ncaches; i++) {
+		cache = &t->caches[tc->caches[i]];
+		if (strcmp(cache->type, "Instruction") == 0)
+			continue;
+		if (llc < 0 || cache->level > t->caches[llc].level)
+			llc = tc->caches[i];
+	}
+	return (llc);
+}
+
+static bool
+topo_same_core(const struct topo_cpu *a, const struct topo_cpu *b)
+{
+	return (a->package == b->package && a->cluster == b->cluster &&
+	    a->core == b->core);
+}
+
+/* Check if a CPU belongs to a group, tc has cache as its LLC */
+static bool
+topo_llc_match(const struct topo *t, const struct topo_llc *llc,
+    const struct topo_cpu *tc, int cache)
+{
+	const struct topo_cpu *first;
+
+	if (cache >= 0 || llc->cache >= 0)
+		return (llc->cache == cache);
+	first = &t->cpus[llc->first];
+	return (first->package == tc->package && first->cluster == tc->cluster);
+}
+
+/*
+ * Group the CPUs by their last level cache. CPUs with no cache information
+ * are grouped by cluster instead.
+ */
+static void
+topo_group_llcs(struct topo *t)
+{
+	struct topo_cpu *tc;
+	struct topo_llc *llc;
+	int cache;
+	u_int l;
+
+	for (u_int i = 0; i < t->ncpus; i++) {
+		tc = &t->cpus[i];
+		cache = topo_cpu_llc(t, tc);
+		for (l = 0; l < t->nllcs; l++) {
+			if (topo_llc_match(t, &t->llcs[l], tc, cache))
+				break;
+		}
+		if (l == t->nllcs) {
+			llc = &t->llcs[t->nllcs++];
+			memset(llc, 0, sizeof(*llc));
+			llc->cache = cache;
+			llc->first = i;
+		}
+		tc->llc = l;
+		topo_set_add(&t->llcs[l].cpus, tc->cpu);
+	}
+
+	/* Count the cores, SMT threads of a core share its LLC */
+	for (u_int i = 0; i < t->ncpus; i++) {
+		u_int j;
+
+		tc = &t->cpus[i];
+		for (j = 0; j < i; j++) {
+			if (t->cpus[j].llc == tc->llc &&
+			    topo_same_core(&t->cpus[j], tc))
+				break;
+		}
+		if (j == i)
+			t->llcs[tc->llc].ncores++;
+	}
+}
+
+/* Order CPUs by where they are so the threads of a core are together */
+static int
+topo_cmp_cpu(const void *a, const void *b)
+{
+	const struct topo_cpu *ca, *cb;
+
+	ca = *(const struct topo_cpu * const *)a;
+	cb = *(const struct topo_cpu * const *)b;
+	if (ca->package != cb->package)
+		return (ca->package < cb->package ? -1 : 1);
+	if (ca->cluster != cb->cluster)
+		return (ca->cluster < cb->cluster ? -1 : 1);
+	if (ca->core != cb->core)
+		return (ca->core < cb->core ? -1 : 1);
+	if (ca->thread != cb->thread)
+		return (ca->thread < cb->thread ? -1 : 1);
+	return (ca->cpu < cb->cpu ? -1 : ca->cpu > cb->cpu);
+}
+
+/*
+ * Plan where to pin nworkers threads. Each worker goes to the LLC with the
+ * fewest workers per core so far, then the cores of each LLC are split
+ * into one contiguous set per worker. Workers only share a core when an
+ * LLC has more workers than cores.
+ */
+static void
+topo_plan(struct topo *t, struct topo_set *workers, u_int nworkers)
+{
+	const struct topo_cpu **sorted;
+	struct topo_llc *llc;
+	u_int *llc_of, *unit, best, first, last, j, n, nunits, w;
+
+	llc_of = calloc(nworkers, sizeof(*llc_of));
+	sorted = calloc(t->ncpus, sizeof(*sorted));
+	unit = calloc(t->ncpus + 1, sizeof(*unit));
+	if (llc_of == NULL || sorted == NULL || unit == NULL)
+		err(1, "calloc");
+
+	for (w = 0; w < nworkers; w++) {
+		best = 0;
+		for (u_int l = 1; l < t->nllcs; l++) {
+			uint64_t lhs, rhs;
+
+			lhs = (uint64_t)t->llcs[l].nworkers *
+			    t->llcs[best].ncores;
+			rhs = (uint64_t)t->llcs[best].nworkers *
+			    t->llcs[l].ncores;
+			if (lhs < rhs)
+				best = l;
+		}
+		llc_of[w] = best;
+		t->llcs[best].nworkers++;
+	}
+
+	for (u_int l = 0; l < t->nllcs; l++) {
+		llc = &t->llcs[l];
+		if (llc->nworkers == 0)
+			continue;
+		n = 0;
+		for (u_int i = 0; i < t->ncpus; i++) {
+			if (t->cpus[i].llc == l)
+				sorted[n++] = &t->cpus[i];
+		}
+		qsort(sorted, n, sizeof(*sorted), topo_cmp_cpu);
+		/* unit[u] is the index in sorted of the first CPU of core u */
+		nunits = 0;
+		for (u_int i = 0; i < n; i++) {
+			if (i == 0 || !topo_same_core(sorted[i - 1], sorted[i]))
+				unit[nunits++] = i;
+		}
+		unit[nunits] = n;
+
+		j = 0;
+		for (w = 0; w < nworkers; w++) {
+			if (llc_of[w] != l)
+				continue;
+			if (llc->nworkers <= nunits) {
+				first = j * nunits / llc->nworkers;
+				last = (j + 1) * nunits / llc->nworkers;
+			} else {
+				first = j % nunits;
+				last = first + 1;
+			}
+			memset(&workers[w], 0, sizeof(workers[w]));
+			for (u_int i = unit[first]; i < unit[last]; i++)
+				topo_set_add(&workers[w], sorted[i]->cpu);
+			j++;
+		}
+	}
+
+	free(unit);
+	free(sorted);
+	free(llc_of);
+}
+
+static const char *
+topo_size(char *buf, size_t len, uint64_t size)
+{
+	if (size == 0)
+		snprintf(buf, len, "?");
+	else if (size >= 1024 * 1024 && size % (1024 * 1024) == 0)
+		snprintf(buf, len, "%"PRIu64"MiB", size / (1024 * 1024));
+	else if (size % 1024 == 0)
+		snprintf(buf, len, "%"PRIu64"KiB", size / 1024);
+	else
+		snprintf(buf, len, "%"PRIu64"B", size);
+	return (buf);
+}
+
+/* The LLC a worker was planned on, the LLC of its first CPU */
+static u_int
+topo_worker_llc(const struct topo *t, const struct topo_set *worker)
+{
+	for (u_int i = 0; i < t->ncpus; i++) {
+		if (topo_set_has(worker, t->cpus[i].cpu))
+			return (t->cpus[i].llc);
+	}
+	return (0);
+}
+
+static void
+topo_print_cpus(const struct topo *t)
+{
+	const struct topo_cpu *tc;
+
+	printf("%4s %5s %-18s %-15s %2s %7s %7s %5s %6s %4s\n", "cpu",
+	    "class", "mpidr_el1", "aff3.2.1.0", "mt", "package", "cluster",
+	    "core", "thread", "llc");
+	for (u_int i = 0; i < t->ncpus; i++) {
+		tc = &t->cpus[i];
+		printf("%4d ", tc->cpu);
+		if (tc->cpu_class == UINT_MAX)
+			printf("%5s ", "-");
+		else
+			printf("%5u ", tc->cpu_class);
+		if (tc->have_mpidr) {
+			char aff[16];
+
+			snprintf(aff, sizeof(aff), "%u.%u.%u.%u",
+			    (u_int)(tc->mpidr >> 32) & 0xff,
+			    (u_int)(tc->mpidr >> 16) & 0xff,
+			    (u_int)(tc->mpidr >> 8) & 0xff,
+			    (u_int)tc->mpidr & 0xff);
+			printf("0x%016"PRIx64" %-15s %2u ", tc->mpidr, aff,
+			    (u_int)(tc->mpidr >> 24) & 1);
+		} else {
+			printf("%-18s %-15s %2s ", "-", "-", "-");
+		}
+		printf("%7d %7d %5d %6d %4u\n", tc->package, tc->cluster,
+		    tc->core, tc->thread, tc->llc);
+	}
+}
+
+static void
+topo_print_clusters(const struct topo *t)
+{
+	const struct topo_cpu *tc, *tj;
+	struct topo_set set;
+	u_int cores, cpu_class;
+	bool mixed, seen;
+
+	printf("\nclusters:\n");
+	for (u_int i = 0; i < t->ncpus; i++) {
+		tc = &t->cpus[i];
+		seen = false;
+		for (u_int j = 0; j < i && !seen; j++) {
+			seen = t->cpus[j].package == tc->package &&
+			    t->cpus[j].cluster == tc->cluster;
+		}
+		if (seen)
+			continue;
+
+		memset(&set, 0, sizeof(set));
+		cores = 0;
+		cpu_class = tc->cpu_class;
+		mixed = false;
+		for (u_int j = i; j < t->ncpus; j++) {
+			tj = &t->cpus[j];
+			if (tj->package != tc->package ||
+			    tj->cluster != tc->cluster)
+				continue;
+			topo_set_add(&set, tj->cpu);
+			mixed |= tj->cpu_class != cpu_class;
+			if (tj->thread == 0)
+				cores++;
+		}
+		printf("  package %d cluster %d: %u core%s, cpus ",
+		    tc->package, tc->cluster, cores, cores == 1 ? "" : "s");
+		topo_set_print(stdout, &set);
+		if (mixed)
+			printf(", mixed classes");
+		else if (cpu_class != UINT_MAX)
+			printf(", class %u", cpu_class);
+		printf("\n");
+	}
+}
+
+/* Caches of the same kind that are each shared by the same number of CPUs */
+static bool
+topo_same_kind(const struct topo_cache *a, const struct topo_cache *b)
+{
+	return (a->level == b->level && strcmp(a->type, b->type) == 0 &&
+	    a->size == b->size &&
+	    topo_set_count(&a->cpus) == topo_set_count(&b->cpus));
+}
+
+/* Print each kind of cache once, with how many there are */
+static void
+topo_print_caches(const struct topo *t)
+{
+	const struct topo_cache *cache;
+	char buf[32];
+	u_int count, shared;
+	bool seen;
+
+	printf("\ncaches:\n");
+	if (t->ncaches == 0)
+		printf("  no cache information in " TOPO_SYSFS "\n");
+	for (u_int c = 0; c < t->ncaches; c++) {
+		cache = &t->caches[c];
+		count = 0;
+		seen = false;
+		for (u_int o = 0; o < t->ncaches; o++) {
+			if (!topo_same_kind(cache, &t->caches[o]))
+				continue;
+			seen |= o < c;
+			count++;
+		}
+		if (seen)
+			continue;
+
+		printf("  L%u %-11s %8s ", cache->level, cache->type,
+		    topo_size(buf, sizeof(buf), cache->size));
+		shared = topo_set_count(&cache->cpus);
+		if (count == 1 && shared > 1) {
+			printf("shared by cpus ");
+			topo_set_print(stdout, &cache->cpus);
+			printf("\n");
+		} else if (shared == 1) {
+			printf("private, %u cpu%s\n", count,
+			    count == 1 ? "" : "s");
+		} else {
+			printf("%u of them, each shared by %u cpus\n", count,
+			    shared);
+		}
+	}
+}
+
+static void
+topo_print_plan(const struct topo *t, const struct topo_set *workers,
+    u_int nworkers)
+{
+	const struct topo_cache *cache;
+	const struct topo_llc *llc;
+	char buf[32];
+
+	printf("\nlast level caches:\n");
+	for (u_int l = 0; l < t->nllcs; l++) {
+		llc = &t->llcs[l];
+		printf("  llc %u: ", l);
+		if (llc->cache >= 0) {
+			cache = &t->caches[llc->cache];
+			printf("L%u %s %s", cache->level, cache->type,
+			    topo_size(buf, sizeof(buf), cache->size));
+		} else {
+			printf("cluster, no cache information");
+		}
+		printf(", %u core%s, cpus ", llc->ncores,
+		    llc->ncores == 1 ? "" : "s");
+		topo_set_print(stdout, &llc->cpus);
+		printf("\n");
+	}
+
+	printf("\npinning plan for %u worker%s:\n", nworkers,
+	    nworkers == 1 ? "" : "s");
+	for (u_int w = 0; w < nworkers; w++) {
+		printf("  worker %u: llc %u, cpus ", w,
+		    topo_worker_llc(t, &workers[w]));
+		topo_set_print(stdout, &workers[w]);
+		printf("\n");
+	}
+}
+
+/*
+ * The machine readable form. Each line is a record type and number, then
+ * name value pairs. Unknown values are "-".
+ */
+static void
+topo_write(FILE *fp, const struct topo *t, const struct topo_set *workers,
+    u_int nworkers)
+{
+	const struct topo_cache *cache;
+	const struct topo_cpu *tc;
+
+	fprintf(fp, "topology source %s cpus %u llcs %u workers %u\n",
+	    t->from_mpidr ? "mpidr" : "sysfs", t->ncpus, t->nllcs, nworkers);
+	for (u_int i = 0; i < t->ncpus; i++) {
+		tc = &t->cpus[i];
+		fprintf(fp, "cpu %d class ", tc->cpu);
+		if (tc->cpu_class == UINT_MAX)
+			fprintf(fp, "-");
+		else
+			fprintf(fp, "%u", tc->cpu_class);
+		if (tc->have_mpidr)
+			fprintf(fp, " mpidr 0x%"PRIx64, tc->mpidr);
+		else
+			fprintf(fp, " mpidr -");
+		fprintf(fp, " package %d cluster %d core %d thread %d llc %u\n",
+		    tc->package, tc->cluster, tc->core, tc->thread, tc->llc);
+	}
+	for (u_int c = 0; c < t->ncaches; c++) {
+		cache = &t->caches[c];
+		fprintf(fp, "cache %u level %u type %s size %"PRIu64" cpus ", c,
+		    cache->level, cache->type, cache->size);
+		topo_set_print(fp, &cache->cpus);
+		fprintf(fp, "\n");
+	}
+	for (u_int l = 0; l < t->nllcs; l++) {
+		fprintf(fp, "llc %u cache ", l);
+		if (t->llcs[l].cache >= 0)
+			fprintf(fp, "%d", t->llcs[l].cache);
+		else
+			fprintf(fp, "-");
+		fprintf(fp, " cores %u cpus ", t->llcs[l].ncores);
+		topo_set_print(fp, &t->llcs[l].cpus);
+		fprintf(fp, "\n");
+	}
+	for (u_int w = 0; w < nworkers; w++) {
+		fprintf(fp, "worker %u llc %u cpus ", w,
+		    topo_worker_llc(t, &workers[w]));
+		topo_set_print(fp, &workers[w]);
+		fprintf(fp, "\n");
+	}
+}
+
+/* Probe MPIDR_EL1 on every CPU in parallel and read the caches from sysfs */
+static void
+topo_collect(struct topo *t, int flags)
+{
+	struct arm64id_cpu *cpus;
+	struct topo_cpu *tc;
+	u_int ncpus;
+	int error, mpidr;
+
+	error = arm64id_probe_cpus(&cpus, &ncpus, flags);
+	if (error != 0) {
+		errno = error;
+		err(1, "unable to probe all CPUs");
+	}
+
+	memset(t, 0, sizeof(*t));
+	t->ncpus = ncpus;
+	t->nclasses = arm64id_classify_cpus(cpus, ncpus);
+	t->cpus = calloc(ncpus, sizeof(*t->cpus));
+	t->caches = calloc(ncpus * TOPO_MAXCACHES, sizeof(*t->caches));
+	t->llcs = calloc(ncpus, sizeof(*t->llcs));
+	if (t->cpus == NULL || t->caches == NULL || t->llcs == NULL)
+		err(1, "calloc");
+
+	mpidr = arm64id_reg_lookup("mpidr_el1");
+	for (u_int i = 0; i < ncpus; i++) {
+		tc = &t->cpus[i];
+		tc->cpu = cpus[i].cpu;
+		tc->cpu_class = cpus[i].cpu_class;
+		if (cpus[i].error == 0 && mpidr >= 0 &&
+		    arm64id_reg_valid(&cpus[i].snap, mpidr)) {
+			tc->have_mpidr = true;
+			tc->mpidr = cpus[i].snap.regs[mpidr];
+		}
+	}
+	free(cpus);
+
+	topo_locate(t);
+	for (u_int i = 0; i < t->ncpus; i++)
+		topo_read_caches(t, &t->cpus[i]);
+	topo_group_llcs(t);
+}
+
+int
+topo_main(u_int nworkers, bool fast, const char *output)
+{
+	struct topo_set *workers;
+	struct topo t;
+	FILE *fp;
+
+	topo_collect(&t, fast ? ARM64ID_PROBE_FAST : 0);
+	workers = calloc(nworkers, sizeof(*workers));
+	if (workers == NULL)
+		err(1, "calloc");
+	topo_plan(&t, workers, nworkers);
+
+	if (output != NULL) {
+		if (strcmp(output, "-") == 0) {
+			fp = stdout;
+		} else {
+			fp = fopen(output, "we");
+			if (fp == NULL)
+				err(1, "%s", output);
+		}
+		topo_write(fp, &t, workers, nworkers);
+		if (fflush(fp) != 0 || ferror(fp))
+			err(1, "%s", output);
+		if (fp != stdout && fclose(fp) != 0)
+			err(1, "%s", output);
+	} else {
+		printf("%u cpu%s, %u class%s, ", t.ncpus,
+		    t.ncpus == 1 ? "" : "s", t.nclasses,
+		    t.nclasses == 1 ? "" : "es");
+		if (t.from_mpidr)
+			printf("topology from MPIDR_EL1\n");
+		else if (t.have_mpidr)
+			printf("MPIDR_EL1 is the same on every cpu, it is "
+			    "emulated, topology from sysfs\n");
+		else
+			printf("MPIDR_EL1 could not be read, topology from "
+			    "sysfs\n");
+		printf("\n");
+		topo_print_cpus(&t);
+		topo_print_clusters(&t);
+		topo_print_caches(&t);
+		topo_print_plan(&t, workers, nworkers);
+	}
+
+	free(workers);
+	free(t.llcs);
+	free(t.caches);
+	free(t.cpus);
+	return (0);
+}
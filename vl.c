@@ -0,0 +1,303 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * List the SVE and streaming SME vector lengths the kernel supports and
+ * time a load/FMA/store kernel at each one, to show if a longer vector
+ * helps on this core. The lengths are set with prctl, so this is Linux
+ * only. The original lengths are restored before returning. Under
+ * qemu-user the set of lengths follows its sve-max-vq and sme-max-vq
+ * CPU properties, e.g. "qemu-aarch64 -cpu max,sve-max-vq=4". This is the
+ * "vl" benchmark.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <err.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#if defined(__aarch64__) && defined(__linux__)
+#define	HAVE_VL_PRCTL
+
+#ifndef PR_SVE_SET_VL
+#define	PR_SVE_SET_VL		50
+#define	PR_SVE_GET_VL		51
+#define	PR_SVE_VL_LEN_MASK	0xffff
+#define	PR_SVE_VL_INHERIT	(1 << 17)
+#endif
+#ifndef PR_SME_SET_VL
+#define	PR_SME_SET_VL		63
+#define	PR_SME_GET_VL		64
+#define	PR_SME_VL_LEN_MASK	0xffff
+#define	PR_SME_VL_INHERIT	(1 << 17)
+#endif
+#endif
+
+/* The architectural limits, in bytes */
+#define	VL_MIN		16
+#define	VL_MAX		256
+#define	VL_COUNT	(VL_MAX / VL_MIN)
+
+/* Floats in each array, both fit in the L1 D-cache */
+#define	VL_ELEMS	4096
+#define	VL_PASSES	10000
+
+#ifdef HAVE_VL_PRCTL
+struct vl_mode {
+	const char	*name;
+	const char	*requires;	/* For arm64id_requires */
+	int		 set;
+	int		 get;
+	int		 flags;		/* Flags to keep when restoring */
+	bool		 streaming;
+};
+
+static const struct vl_mode vl_modes[] = {
+	{ "SVE", "SVE", PR_SVE_SET_VL, PR_SVE_GET_VL, PR_SVE_VL_INHERIT,
+	    false },
+	{ "SME streaming", "SME", PR_SME_SET_VL, PR_SME_GET_VL,
+	    PR_SME_VL_INHERIT, true },
+};
+
+/*
+ * The vector length in bytes as seen by the hardware. In streaming mode
+ * RDVL returns the streaming vector length.
+ */
+static u_int
+vl_rdvl(bool streaming)
+{
+	uint64_t vl;
+
+	if (streaming)
+		__asm __volatile(
+		    ".arch_extension sve\n"
+		    ".arch_extension sme\n"
+		    "	smstart	sm\n"
+		    "	rdvl	%0, #1\n"
+		    "	smstop	sm\n"
+		    : "=r"(vl) :: "v0", "v1", "v2", "v3", "v4", "v5", "v6",
+		    "v7", "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15",
+		    "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23",
+		    "v24", "v25", "v26", "v27", "v28", "v29", "v30", "v31");
+	else
+		__asm __volatile(
+		    ".arch_extension sve\n"
+		    "	rdvl	%0, #1\n"
+		    : "=r"(vl));
+	return (vl);
+}
+
+/*
+ * y[i] += 0.5 * x[i] over n floats, passes times. The loop is vector
+ * length agnostic so it is the same code at each length. smstart and
+ * smstop zero the vector registers, so all are clobbered.
+ */
+static void
+vl_kernel(bool streaming, const float *x, float *y, uint64_t n, u_int passes)
+{
+	uint64_t i;
+
+#define	VL_KERNEL_LOOP							\
+	"	fmov	z2.s, #0.5\n"					\
+	"	mov	%0, #0\n"					\
+	"	whilelo	p0.s, %0, %3\n"					\
+	"	b.none	2f\n"						\
+	"1:	ld1w	{z0.s}, p0/z, [%1, %0, lsl #2]\n"		\
+	"	ld1w	{z1.s}, p0/z, [%2, %0, lsl #2]\n"		\
+	"	fmla	z1.s, p0/m, z0.s, z2.s\n"			\
+	"	st1w	{z1.s}, p0, [%2, %0, lsl #2]\n"			\
+	"	incw	%0\n"						\
+	"	whilelo	p0.s, %0, %3\n"					\
+	"	b.first	1b\n"						\
+	"2:\n"
+
+	for (u_int pass = 0; pass < passes; pass++) {
+		if (streaming)
+			__asm __volatile(
+			    ".arch_extension sve\n"
+			    ".arch_extension sme\n"
+			    "	smstart	sm\n"
+			    VL_KERNEL_LOOP
+			    "	smstop	sm\n"
+			    : "=&r"(i) : "r"(x), "r"(y), "r"(n)
+			    : "cc", "memory", "p0", "v0", "v1", "v2", "v3",
+			    "v4", "v5", "v6", "v7", "v8", "v9", "v10", "v11",
+			    "v12", "v13", "v14", "v15", "v16", "v17", "v18",
+			    "v19", "v20", "v21", "v22", "v23", "v24", "v25",
+			    "v26", "v27", "v28", "v29", "v30", "v31");
+		else
+			__asm __volatile(
+			    ".arch_extension sve\n"
+			    VL_KERNEL_LOOP
+			    : "=&r"(i) : "r"(x), "r"(y), "r"(n)
+			    : "cc", "memory", "p0", "v0", "v1", "v2");
+	}
+#undef VL_KERNEL_LOOP
+}
+
+/*
+ * Find the supported lengths. Setting a length the kernel doesn't support
+ * picks the largest supported length below it, or the smallest supported
+ * if there are none below, so step down from the largest.
+ */
+static u_int
+vl_list(const struct vl_mode *mode, u_int *vls)
+{
+	u_int nvls, vl;
+	int ret;
+
+	nvls = 0;
+	for (vl = VL_MAX; vl >= VL_MIN; vl = ret - VL_MIN) {
+		ret = prctl(mode->set, vl, 0, 0, 0);
+		if (ret < 0)
+			break;
+		ret &= PR_SVE_VL_LEN_MASK;
+		if (nvls == 0 || vls[nvls - 1] != (u_int)ret)
+			vls[nvls++] = ret;
+		if ((u_int)ret > vl || ret < VL_MIN)
+			break;
+	}
+
+	/* Sort in increasing order */
+	for (u_int i = 0; i < nvls / 2; i++) {
+		vl = vls[i];
+		vls[i] = vls[nvls - 1 - i];
+		vls[nvls - 1 - i] = vl;
+	}
+	return (nvls);
+}
+
+static void
+vl_mode_run(const struct vl_mode *mode, float *x, float *y)
+{
+	u_int vls[VL_COUNT], nvls, hw;
+	uint64_t ns, start;
+	double base, gflops;
+	int orig;
+
+	orig = prctl(mode->get, 0, 0, 0, 0);
+	if (orig < 0) {
+		printf("%s: unable to get the vector length: %s\n", mode->name,
+		    strerror(errno));
+		return;
+	}
+
+	nvls = vl_list(mode, vls);
+	printf("%s vector lengths: ", mode->name);
+	for (u_int i = 0; i < nvls; i++)
+		printf("%s%u", i == 0 ? "" : ", ", vls[i] * 8);
+	printf(" bits, current %u\n", (orig & PR_SVE_VL_LEN_MASK) * 8);
+
+	printf("%10s %10s %10s %8s\n", "bits", "GFLOP/s", "GB/s", "speedup");
+	base = 0;
+	for (u_int i = 0; i < nvls; i++) {
+		if (prctl(mode->set, vls[i], 0, 0, 0) < 0) {
+			printf("%10u unable to set: %s\n", vls[i] * 8,
+			    strerror(errno));
+			continue;
+		}
+		hw = vl_rdvl(mode->streaming);
+		if (hw != vls[i]) {
+			printf("%10u rdvl reports %u bits\n", vls[i] * 8,
+			    hw * 8);
+			continue;
+		}
+
+		for (u_int j = 0; j < VL_ELEMS; j++) {
+			x[j] = 1.0f;
+			y[j] = 0.0f;
+		}
+		/* Warm up, then time */
+		vl_kernel(mode->streaming, x, y, VL_ELEMS, 1);
+		start = bench_nsec();
+		vl_kernel(mode->streaming, x, y, VL_ELEMS, VL_PASSES);
+		ns = bench_nsec() - start;
+		for (u_int j = 0; j < VL_ELEMS; j++) {
+			if (y[j] != 0.5f * (VL_PASSES + 1))
+				errx(1, "vl: wrong result at %u bits, "
+				    "element %u", vls[i] * 8, j);
+		}
+
+		/* Each element is a multiply-add, two loads and a store */
+		gflops = 2.0 * VL_ELEMS * VL_PASSES / ns;
+		if (base == 0)
+			base = gflops;
+		printf("%10u %10.2f %10.2f %7.2fx\n", vls[i] * 8, gflops,
+		    gflops * 6, gflops / base);
+	}
+
+	if (prctl(mode->set, orig & (PR_SVE_VL_LEN_MASK | mode->flags), 0, 0,
+	    0) < 0)
+		err(1, "unable to restore the %s vector length", mode->name);
+}
+#endif
+
+void
+bench_vl(void)
+{
+#ifdef HAVE_VL_PRCTL
+	const struct arm64id_snapshot *snap;
+	float *x, *y;
+	bool any;
+
+	snap = arm64id_snapshot_get();
+	if (snap == NULL)
+		errx(1, "unable to read the ID registers");
+	x = calloc(VL_ELEMS, sizeof(*x));
+	y = calloc(VL_ELEMS, sizeof(*y));
+	if (x == NULL || y == NULL)
+		err(1, "calloc");
+
+	any = false;
+	for (size_t i = 0; i < nitems(vl_modes); i++) {
+		if (!arm64id_requires(snap, vl_modes[i].requires))
+			continue;
+		if (any)
+			printf("\n");
+		vl_mode_run(&vl_modes[i], x, y);
+		any = true;
+	}
+	if (!any)
+		printf("vl: needs SVE or SME\n");
+	free(x);
+	free(y);
+#else
+	printf("vl: needs Linux on arm64\n");
+#endif
+}
@@ -0,0 +1,441 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Andrew Turner
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Watch for the ID registers or HWCAPs changing under a running process,
+ * e.g. after a VM is live migrated to a different host or a CPU is hot
+ * plugged. This is arm64id -W.
+ *
+ * A snapshot of every CPU is kept from a full sweep. Each interval only a
+ * small subset of the registers is read on the CPU the watcher happens to
+ * be running on and hashed. Migration changes every vCPU at once so one
+ * CPU is enough to notice it. A full sweep is only done when the hash
+ * differs from the snapshot of that CPU, or the set of online CPUs has
+ * changed, and the differences are written as one event per line.
+ *
+ * The HWCAPs come from the auxiliary vector so on Linux they are fixed
+ * for the life of the process, they are compared for completeness.
+ */
+
+#ifdef __linux__
+#define	_GNU_SOURCE	/* For sched_getaffinity and sched_getcpu */
+#endif
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arm64id.h"
+#include "extern.h"
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#define	HAVE_SCHED_AFFINITY
+#endif
+
+#define	WATCH_ONLINE	"/sys/devices/system/cpu/online"
+
+/* The registers sampled each interval */
+static const char *watch_subset[] = {
+	"midr_el1",
+	"revidr_el1",
+	"id_aa64*",
+};
+
+struct watch_cpu {
+	int		 cpu;
+	uint64_t	 hash;		/* Of the subset, 0 if not probed */
+};
+
+struct watch {
+	FILE		*fp;
+	int		 flags;
+	struct arm64id_regset subset;
+	struct arm64id_cpu *cpus;	/* The last full sweep */
+	u_int		 ncpus;
+	struct watch_cpu *hashes;
+#ifdef HAVE_SCHED_AFFINITY
+	cpu_set_t	 allowed;
+#endif
+	char		 online[256];
+};
+
+/* FNV-1a over the subset registers and the HWCAPs */
+static uint64_t
+watch_hash(const struct watch *w, const struct arm64id_snapshot *snap)
+{
+	const uint8_t *p;
+	uint64_t hash, vals[2];
+
+	hash = 0xcbf29ce484222325ULL;
+	for (u_int i = 0; i < snap->nregs + ARM64ID_NHWCAPS; i++) {
+		if (i < snap->nregs) {
+			if (!arm64id_regset_isset(&w->subset, i))
+				continue;
+			vals[0] = arm64id_reg_valid(snap, i);
+			vals[1] = vals[0] ? snap->regs[i] : 0;
+		} else {
+			vals[0] = arm64id_hwcap_valid(snap, i - snap->nregs);
+			vals[1] = snap->hwcaps[i - snap->nregs];
+		}
+		p = (const uint8_t *)vals;
+		for (size_t b = 0; b < sizeof(vals); b++) {
+			hash ^= p[b];
+			hash *= 0x100000001b3ULL;
+		}
+	}
+	/* Keep 0 for CPUs that failed to probe */
+	return (hash == 0 ? 1 : hash);
+}
+
+/*
+ * Read the CPUs the kernel has online and the CPUs we may run on. Returns
+ * true if either has changed since the last call.
+ */
+static bool
+watch_online(struct watch *w)
+{
+	char buf[sizeof(w->online)];
+	ssize_t len;
+	bool changed;
+	int fd;
+
+	changed = false;
+	buf[0] = '\0';
+	fd = open(WATCH_ONLINE, O_RDONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		len = read(fd, buf, sizeof(buf) - 1);
+		buf[len > 0 ? len : 0] = '\0';
+		close(fd);
+	}
+	if (strcmp(buf, w->online) != 0) {
+		memcpy(w->online, buf, sizeof(buf));
+		changed = true;
+	}
+
+#ifdef HAVE_SCHED_AFFINITY
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0 &&
+	    !CPU_EQUAL(&set, &w->allowed)) {
+		w->allowed = set;
+		changed = true;
+	}
+#endif
+	return (changed);
+}
+
+static int
+watch_getcpu(void)
+{
+#ifdef __linux__
+	return (sched_getcpu());
+#else
+	return (-1);
+#endif
+}
+
+static void
+watch_sweep(struct watch *w)
+{
+	int error;
+
+	error = arm64id_probe_cpus(&w->cpus, &w->ncpus, w->flags);
+	if (error != 0) {
+		errno = error;
+		err(1, "unable to probe all CPUs");
+	}
+	w->hashes = calloc(w->ncpus, sizeof(*w->hashes));
+	if (w->hashes == NULL)
+		err(1, "calloc");
+	for (u_int i = 0; i < w->ncpus; i++) {
+		w->hashes[i].cpu = w->cpus[i].cpu;
+		if (w->cpus[i].error == 0)
+			w->hashes[i].hash = watch_hash(w, &w->cpus[i].snap);
+	}
+}
+
+/*
+ * Read the subset on the current CPU and compare it with the last sweep,
+ * returning false if it has changed. If the thread moved CPU while reading
+ * it can't be compared so it is treated as unchanged, the next interval
+ * will catch it.
+ */
+static bool
+watch_sample(struct watch *w)
+{
+	struct arm64id_snapshot snap;
+	uint64_t hash;
+	int cpu;
+	bool any;
+
+	cpu = watch_getcpu();
+	if (arm64id_probe_regs(&snap, &w->subset, w->flags, NULL) != 0)
+		return (true);
+	if (watch_getcpu() != cpu)
+		return (true);
+	hash = watch_hash(w, &snap);
+
+	/*
+	 * A CPU that wasn't in the last sweep, or failed to probe, has
+	 * nothing to compare with. The online check will catch new CPUs.
+	 */
+	any = false;
+	for (u_int i = 0; i < w->ncpus; i++) {
+		if ((cpu >= 0 && w->hashes[i].cpu != cpu) ||
+		    w->hashes[i].hash == 0)
+			continue;
+		if (w->hashes[i].hash == hash)
+			return (true);
+		any = true;
+	}
+	return (!any);
+}
+
+static void
+watch_event(struct watch *w, time_t now, int cpu, const char *fmt, ...)
+    __attribute__((__format__(__printf__, 4, 5)));
+
+static void
+watch_event(struct watch *w, time_t now, int cpu, const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(w->fp, "%jd", (intmax_t)now);
+	if (cpu >= 0)
+		fprintf(w->fp, " cpu %d", cpu);
+	fputc(' ', w->fp);
+	va_start(ap, fmt);
+	vfprintf(w->fp, fmt, ap);
+	va_end(ap);
+	fputc('\n', w->fp);
+}
+
+/* Format a register in hex or a signed field value, or "-" if not valid */
+static void
+watch_value(char *buf, size_t len, bool valid, bool hex, uint64_t val)
+{
+	if (!valid)
+		snprintf(buf, len, "-");
+	else if (hex)
+		snprintf(buf, len, "0x%"PRIx64, val);
+	else
+		snprintf(buf, len, "%"PRId64, (int64_t)val);
+}
+
+/* Write an event for each register, and each field in it, that changed */
+static void
+watch_diff_regs(struct watch *w, time_t now, int cpu,
+    const struct arm64id_snapshot *old, const struct arm64id_snapshot *new)
+{
+	const struct arm64id_field_desc *desc;
+	char ob[24], nb[24];
+	int64_t ov, nv;
+	uint32_t enc;
+	bool ovalid, nvalid;
+
+	for (u_int i = 0; i < old->nregs; i++) {
+		if (arm64id_reg_volatile(i))
+			continue;
+		ovalid = arm64id_reg_valid(old, i);
+		nvalid = arm64id_reg_valid(new, i);
+		if (ovalid == nvalid &&
+		    (!ovalid || old->regs[i] == new->regs[i]))
+			continue;
+
+		watch_value(ob, sizeof(ob), ovalid, true, old->regs[i]);
+		watch_value(nb, sizeof(nb), nvalid, true, new->regs[i]);
+		watch_event(w, now, cpu, "reg %s old %s new %s",
+		    arm64id_reg_name(i), ob, nb);
+
+		enc = arm64id_reg_encoding(i);
+		for (u_int f = 0; f < ARM64ID_NFIELDS; f++) {
+			desc = arm64id_field_desc(f);
+			if (desc->enc != enc)
+				continue;
+			ovalid = arm64id_field_get(old, f, &ov);
+			nvalid = arm64id_field_get(new, f, &nv);
+			if (ovalid == nvalid && (!ovalid || ov == nv))
+				continue;
+			watch_value(ob, sizeof(ob), ovalid, false, ov);
+			watch_value(nb, sizeof(nb), nvalid, false, nv);
+			watch_event(w, now, cpu, "field %s.%s old %s new %s",
+			    desc->reg, desc->name, ob, nb);
+		}
+	}
+}
+
+/* Write an event for each HWCAP bit that changed */
+static void
+watch_diff_hwcaps(struct watch *w, time_t now,
+    const struct arm64id_snapshot *old, const struct arm64id_snapshot *new)
+{
+	const struct arm64id_hwcap *caps;
+	size_t ncaps;
+	uint64_t ov, nv, changed, bit;
+
+	for (u_int word = 0; word < ARM64ID_NHWCAPS; word++) {
+		ov = arm64id_hwcap_valid(old, word) ? old->hwcaps[word] : 0;
+		nv = arm64id_hwcap_valid(new, word) ? new->hwcaps[word] : 0;
+		changed = ov ^ nv;
+		caps = arm64id_hwcap_list(word, &ncaps);
+		for (size_t i = 0; i < ncaps; i++) {
+			if ((changed & caps[i].cap) == 0)
+				continue;
+			watch_event(w, now, -1, "hwcap %s old %d new %d",
+			    caps[i].name, (ov & caps[i].cap) != 0,
+			    (nv & caps[i].cap) != 0);
+			changed &= ~caps[i].cap;
+		}
+		for (u_int b = 0; changed != 0; b++) {
+			bit = (uint64_t)1 << b;
+			if ((changed & bit) == 0)
+				continue;
+			watch_event(w, now, -1, "hwcap %u:%u old %d new %d",
+			    word, b, (ov & bit) != 0, (nv & bit) != 0);
+			changed &= ~bit;
+		}
+	}
+}
+
+static const struct arm64id_snapshot *
+watch_first(const struct arm64id_cpu *cpus, u_int ncpus)
+{
+	for (u_int i = 0; i < ncpus; i++) {
+		if (cpus[i].error == 0)
+			return (&cpus[i].snap);
+	}
+	return (NULL);
+}
+
+/*
+ * Sweep every CPU again and write the differences from the last sweep.
+ * Both sweeps list the CPUs in ascending order.
+ */
+static void
+watch_resweep(struct watch *w, const char *reason)
+{
+	const struct arm64id_snapshot *os, *ns;
+	struct arm64id_cpu *old;
+	struct watch_cpu *ohashes;
+	u_int i, j, nold;
+	time_t now;
+	int cpu;
+
+	old = w->cpus;
+	nold = w->ncpus;
+	ohashes = w->hashes;
+	watch_sweep(w);
+
+	now = time(NULL);
+	watch_event(w, now, -1, "sweep %s", reason);
+	for (i = j = 0; i < nold || j < w->ncpus;) {
+		if (j == w->ncpus ||
+		    (i < nold && old[i].cpu < w->cpus[j].cpu)) {
+			watch_event(w, now, old[i++].cpu, "offline");
+			continue;
+		}
+		if (i == nold || w->cpus[j].cpu < old[i].cpu) {
+			watch_event(w, now, w->cpus[j++].cpu, "online");
+			continue;
+		}
+		cpu = old[i].cpu;
+		if (old[i].error == 0 && w->cpus[j].error == 0)
+			watch_diff_regs(w, now, cpu, &old[i].snap,
+			    &w->cpus[j].snap);
+		else if ((old[i].error == 0) != (w->cpus[j].error == 0))
+			watch_event(w, now, cpu, "probe old %s new %s",
+			    old[i].error == 0 ? "ok" : "failed",
+			    w->cpus[j].error == 0 ? "ok" : "failed");
+		i++;
+		j++;
+	}
+
+	os = watch_first(old, nold);
+	ns = watch_first(w->cpus, w->ncpus);
+	if (os != NULL && ns != NULL)
+		watch_diff_hwcaps(w, now, os, ns);
+	fflush(w->fp);
+
+	free(ohashes);
+	free(old);
+}
+
+int
+watch_main(double interval, bool fast, const char *output)
+{
+	struct timespec ts, rem;
+	struct watch w;
+
+	memset(&w, 0, sizeof(w));
+	w.flags = fast ? ARM64ID_PROBE_FAST : 0;
+	for (size_t i = 0; i < nitems(watch_subset); i++)
+		arm64id_regset_add(&w.subset, watch_subset[i]);
+
+	if (output == NULL || strcmp(output, "-") == 0) {
+		w.fp = stdout;
+	} else {
+		w.fp = fopen(output, "ae");
+		if (w.fp == NULL)
+			err(1, "%s", output);
+	}
+	setvbuf(w.fp, NULL, _IOLBF, 0);
+
+	watch_online(&w);
+	watch_sweep(&w);
+	watch_event(&w, time(NULL), -1, "start cpus %u interval %g",
+	    w.ncpus, interval);
+
+	ts.tv_sec = (time_t)interval;
+	ts.tv_nsec = (long)((interval - ts.tv_sec) * 1e9);
+	for (;;) {
+		rem = ts;
+		while (nanosleep(&rem, &rem) != 0) {
+			if (errno != EINTR)
+				err(1, "nanosleep");
+		}
+		if (watch_online(&w))
+			watch_resweep(&w, "cpus");
+		else if (!watch_sample(&w))
+			watch_resweep(&w, "registers");
+		if (ferror(w.fp))
+			err(1, "%s", output);
+	}
+}